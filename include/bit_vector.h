@@ -51,6 +51,8 @@ void 		BitVecClear(struct bitVec* bvec, const u64 clear_bit);
 uint8_t 	BitVecGetBit(const struct bitVec* bvec, const u64 bit);
 /* set the bit value of the given bit */
 void 		BitVecSetBit(const struct bitVec* bvec, const u64 bit, const u64 bit_value);
+/* atomically set the given bit to 1; thread-safe against concurrent BitVecSetBitAtomic calls */
+void 		BitVecSetBitAtomic(const struct bitVec* bvec, const u64 bit);
 
 #ifdef __cplusplus
 } 
@@ -43,6 +43,7 @@ struct bvhNode
 {
 	BT_SLOT_STATE;
 	struct aabb	bbox;
+	u32		asleep;	/* dbvh: leaf proxy is not moving, or every leaf in subtree is asleep */
 };
 
 struct bvh
@@ -73,9 +74,18 @@ struct bvh		DbvhAlloc(struct arena *mem, const u32 initial_length, const u32 gro
 void 			DbvhFlush(struct bvh *bvh);
 /* id is an integer identifier from the outside, return index of added value */
 u32 			DbvhInsert(struct bvh *bvh, const u32 id, const struct aabb *bbox);
+/* Insert count leaves at once: a subtree is built top-down using binned SAH and grafted into the hierarchy as a
+ * single node. Leaf i gets external id[i], box bbox[i] and asleep state asleep[i] (awake if asleep == NULL), and
+ * its index is written to index[i]. */
+void 			DbvhInsertBatch(struct arena *tmp, struct bvh *bvh, u32 *index, const u32 *id, const struct aabb *bbox, const u32 *asleep, const u32 count);
 /* remove leaf corresponding to index from tree */
 void 			DbvhRemove(struct bvh *bvh, const u32 index);
-/* Return overlapping ids ptr, set to NULL if no overlap. if overlap, count is set */
+/* remove the given leaves from tree; ancestors are refit once at the end, and no rotations are made */
+void 			DbvhRemoveBatch(struct arena *tmp, struct bvh *bvh, const u32 *index, const u32 count);
+/* set the asleep state of the leaf at index and propagate it to its ancestors */
+void 			DbvhSetAsleep(struct bvh *bvh, const u32 index, const u32 asleep);
+/* Return overlapping ids ptr, set to NULL if no overlap. if overlap, count is set. Pairs of two 
+ * sleeping leaves are not reported, and subtrees containing only sleeping leaves are skipped. */
 struct dbvhOverlap *	DbvhPushOverlapPairs(struct arena *mem, u32 *count, const struct bvh *bvh);
 /* push	id:s of leaves hit by raycast. returns number of hits. -1 == out of memory */
 
@@ -0,0 +1,94 @@
+/*
+==========================================================================
+    Copyright (C) 2026 Axel Sandstedt 
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+==========================================================================
+*/
+
+#ifndef __DEQUE_WS_H__
+#define __DEQUE_WS_H__
+
+#ifdef __cplusplus
+extern "C" { 
+#endif
+
+#include "ds_allocator.h"
+
+/*
+ * dequeWs - growable Chase-Lev work-stealing deque.
+ *
+ * The owning thread pushes and pops at the bottom (LIFO, hot in cache), while any other thread may steal
+ * from the top (FIFO, oldest work). Owner operations only touch a_top when the deque is nearly empty, so
+ * an owner working through its own entries never contends with thieves.
+ *
+ * A push to a full deque grows it: the owner copies the valid entries into a buffer of at least twice the 
+ * size and publishes it. The first growth takes a 1MB block from the thread block allocator, later ones
+ * double through ds_Alloc. Thieves may still be reading a replaced buffer, so replaced buffers are kept until
+ * DequeWsFree.
+ *
+ * Invariant:	(1) entries [a_top, a_bottom) are valid 
+ * 		(2) a_top only ever increases, and only through a compare-exchange, so that an entry is taken 
+ * 		    by exactly one thread
+ * 		(3) a_bottom and a_buffer are only written by the owner
+ */
+#define DEQUE_WS_BUFFER_MAX	24
+
+struct dequeWsBuffer
+{
+	void **			entries;
+	u64			mask;		/* entry count - 1, entry count is a power of 2 */
+	struct ds_MemSlot	slot;		/* set if ds_Alloc'd */
+	u32			block;		/* set if a 1MB thread block */
+};
+
+struct dequeWs
+{
+	/* pads for 64 and 128 cachelines */
+	u8				pad1[DS_CACHE_LINE_UB];
+	ds_Align(DS_CACHE_LINE_UB) u64	a_top;		/* thief owned */
+	u8				pad2[DS_CACHE_LINE_UB];
+	ds_Align(DS_CACHE_LINE_UB) u64	a_bottom;	/* owner owned */
+	u8				pad3[DS_CACHE_LINE_UB];
+	struct dequeWsBuffer *		a_buffer;	/* current buffer */
+	u64				a_peak;		/* peak entry count, written by owner */
+	u32				buffer_count;	/* buffers allocated, the last being current */
+	struct dequeWsBuffer		buffer[DEQUE_WS_BUFFER_MAX];
+};
+
+/* initial_entry_count must be a power of 2 */
+struct dequeWs *	DequeWsInit(struct arena *mem_persistent, const u32 initial_entry_count);
+/* release any buffers allocated by growing the deque */
+void			DequeWsFree(struct dequeWs *q);
+/* owner: push data and return 1, growing the deque if full; returns 0 only if growing the deque failed */
+u32			DequeWsPush(struct dequeWs *q, void *data);
+/* owner: returns NULL if the deque is empty, otherwise the most recently pushed data */
+void *			DequeWsPop(struct dequeWs *q);
+/* thief: returns NULL if the deque is empty or the race for the top entry was lost, otherwise the oldest data */
+void *			DequeWsSteal(struct dequeWs *q);
+/* thief: return the oldest data without taking it, or NULL if the deque is empty. A following steal may 
+ * return other data, so the result is only a hint */
+void *			DequeWsPeek(const struct dequeWs *q);
+/* return a snapshot of the number of entries; exact only if the deque is not concurrently modified */
+u32			DequeWsCount(const struct dequeWs *q);
+/* return the peak number of entries held at once */
+u64			DequeWsPeak(const struct dequeWs *q);
+/* return the current entry capacity */
+u64			DequeWsCapacity(const struct dequeWs *q);
+
+#ifdef __cplusplus
+} 
+#endif
+
+#endif
@@ -312,6 +312,8 @@ struct ds_Pool 	ds_PoolAllocInternal(struct arena *mem, const u32 length, const
 void		ds_PoolDealloc(struct ds_Pool *pool);
 /* dealloc all slot allocations */
 void		ds_PoolFlush(struct ds_Pool *pool);
+/* grow the pool until it can hold length slots. Return 1 on success, 0 if the pool is too small and not growable */
+u32		ds_PoolReserve(struct ds_Pool *pool, const u32 length);
 /* alloc new slot; on error return (NULL, U32_MAX) */
 struct slot	ds_PoolAdd(struct ds_Pool *pool);
 /* remove slot given index */
@@ -371,7 +373,8 @@ u32			    ds_PoolExternalIndex(const struct ds_ds_PoolExternal *pool, const void
 TPool
 =====
 A thread-safe pool allocator where every operation can be called by any thread, at any time;
-based on Treiber stack free-lists.
+based on Treiber stack free-lists. A non-growable TPool never allocates after
+ds_StructTPoolAlloc; once every slot is in use, ds_StructTPoolAdd returns (NULL, POOL_NULL).
 
 ::: Usage and Documentation :::
 
@@ -395,7 +398,7 @@ the ds_StructTPool*** functions, and TPOOL_DEFINE generates the implementations
 of each function. The functions generated are the following:
 
     // Allocation of pool.
-    void        ds_StructTPoolAlloc(struct ds_StructTPool *pool, const u32 initial_count, const u64 slot_size);
+    void        ds_StructTPoolAlloc(struct ds_StructTPool *pool, const u32 logical_core_count, const u32 initial_count, const u32 growable);
     
     // Deallocation of pool (passing ptr here since pool contains sync-point)
     void        ds_StructTPoolDealloc(struct ds_StructTPool *pool);
@@ -403,7 +406,7 @@ of each function. The functions generated are the following:
     // Dealloc all slot allocations, resetting the pool's count_max to 0
     void        ds_StructTPoolFlush(struct ds_StructTPool *pool);
     
-    // Alloc new slot 
+    // Alloc new slot; on a full non-growable pool return (NULL, POOL_NULL)
     struct slot ds_StructTPoolAdd(struct ds_StructTPool *pool);
     
     // Remove slot given index 
@@ -414,7 +417,8 @@ of each function. The functions generated are the following:
 
     // Allocate a previously untouched slot by increment the global TPool a_count_max
     // counter. If additional memory is needed, the thread synchronizes with other 
-    // threads to allocate the needed memory.
+    // threads to allocate the needed memory. A non-growable pool instead returns 
+    // (NULL, POOL_NULL) once a_count_max reaches a_length.
     struct slot ds_TPoolIncrement(struct ds_TPool *pool);
 
 
@@ -495,6 +499,7 @@ struct struct_name ## TPool
                                                                                                             \
     u32                 initial_length;                                                                     \
     u32                 shift;                                                                              \
+    u32                 growable;                                                                           \
                                                                                                             \
     /* indexed by thread's unique index */                                                                  \
     u32                 steal_max_iterations;                                                               \
@@ -509,7 +514,8 @@ struct struct_name ## TPool
 #define TPOOL_ALLOC_DECLARE(struct_name)                                                                    \
 void                struct_name ## TPoolAlloc(struct struct_name ## TPool *pool,                            \
                                               const u32 logical_core_count,                                 \
-                                              const u32 initial_count)
+                                              const u32 initial_count,                                      \
+                                              const u32 growable)
 
 #define TPOOL_DEALLOC_DECLARE(struct_name)                                                                  \
 void                struct_name ## TPoolDealloc(struct struct_name ## TPool *pool)
@@ -539,6 +545,7 @@ TPOOL_ALLOC_DECLARE(struct_name)
     pool->block_length_next = PowerOfTwoCeil(initial_count);                                                \
     pool->initial_length = pool->block_length_next;                                                         \
     pool->shift = Ctz32(pool->initial_length);                                                              \
+    pool->growable = growable;                                                                              \
                                                                                                             \
     ds_StaticAssert(sizeof(pool->t_free_list[0]) % 64 == 0, "Size of TStacks should be multiple of 64");    \
     pool->free_list_count = logical_core_count;                                                             \
@@ -596,6 +603,24 @@ TPOOL_FLUSH_DECLARE(struct_name)
 TPOOL_INCREMENT_DECLARE(struct_name)                                                                        \
 {                                                                                                           \
     struct slot slot;                                                                                       \
+    if (!pool->growable)                                                                                    \
+    {                                                                                                       \
+        /* never move a_count_max past a_length, so a full pool stays consistent */                         \
+        slot.index = AtomicLoadAcq32(&pool->a_count_max);                                                   \
+        do                                                                                                  \
+        {                                                                                                   \
+            if (slot.index >= pool->a_length)                                                               \
+            {                                                                                               \
+                slot.index = POOL_NULL;                                                                     \
+                slot.address = NULL;                                                                        \
+                return slot;                                                                                \
+            }                                                                                               \
+        } while (!AtomicCompareExchangeAcqRlx32(&pool->a_count_max, &slot.index, slot.index + 1));          \
+                                                                                                            \
+        slot.address = struct_name ## TPoolAddress(pool, slot.index);                                       \
+        return slot;                                                                                        \
+    }                                                                                                       \
+                                                                                                            \
     slot.index = AtomicFetchAddRlx32(&pool->a_count_max, 1);                                                \
     while (slot.index >= AtomicLoadAcq32(&pool->a_length))                                                  \
     {                                                                                                       \
@@ -655,7 +680,22 @@ TPOOL_ADD_DECLARE(struct_name)
         }                                                                                                   \
     }                                                                                                       \
                                                                                                             \
-    return struct_name ## TPoolIncrement(pool);                                                             \
+    slot = struct_name ## TPoolIncrement(pool);                                                             \
+    if (!slot.address)                                                                                      \
+    {                                                                                                       \
+        /* full non-growable pool, sweep every free list before giving up */                                \
+        for (u32 t = 0; t < pool->free_list_count; ++t)                                                     \
+        {                                                                                                   \
+            slot = struct_name ## FreeListTStackPop(pool->t_free_list + t);                                 \
+            if (slot.address)                                                                               \
+            {                                                                                               \
+                return slot;                                                                                \
+            }                                                                                               \
+        }                                                                                                   \
+        slot.index = POOL_NULL;                                                                             \
+    }                                                                                                       \
+                                                                                                            \
+    return slot;                                                                                            \
 }
 
 #define TPOOL_REMOVE_DEFINE(struct_name)                                                                    \
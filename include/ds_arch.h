@@ -53,6 +53,17 @@ struct dsArchConfig
 	u32		logical_core_count;
 	pid		pid;
 
+	/* 
+	 * Topology: every logical cpu maps to a physical core and to a group of cpus sharing its last level 
+	 * cache. Cores and cache groups are indexed densely from 0. If the topology cannot be queried, every
+	 * logical cpu is its own core and all cpus share one cache group.
+	 */
+	u32		physical_core_count;
+	u32		cache_group_count;
+	u32 *		cpu_core;		/* cpu_core[cpu] = physical core of cpu */
+	u32 *		cpu_cache_group;	/* cpu_cache_group[cpu] = last level cache group of cpu */
+	u32 *		cpu_order;		/* cpus ordered one per physical core first, SMT siblings last */
+
 	u64		pagesize;	/* bytes */
 	u64		cacheline;	/* bytes */
 
@@ -63,6 +63,12 @@ extern "C" {
 	#define AtomicFetchSubAcq64(fetch_addr, val)	__atomic_fetch_sub(fetch_addr, val, ATOMIC_ACQUIRE)
 	#define AtomicFetchSubRel64(fetch_addr, val)	__atomic_fetch_sub(fetch_addr, val, ATOMIC_RELAXED)
 	#define AtomicFetchSubSeqCst64(fetch_addr, val)	__atomic_fetch_sub(fetch_addr, val, ATOMIC_SEQ_CST)
+
+	#define AtomicFetchOrRlx64(fetch_addr, val)	__atomic_fetch_or(fetch_addr, val, ATOMIC_RELAXED)
+	#define AtomicFetchOrSeqCst32(fetch_addr, val)	__atomic_fetch_or(fetch_addr, val, ATOMIC_SEQ_CST)
+	#define AtomicFetchAndSeqCst32(fetch_addr, val)	__atomic_fetch_and(fetch_addr, val, ATOMIC_SEQ_CST)
+	#define AtomicFetchOrSeqCst64(fetch_addr, val)	__atomic_fetch_or(fetch_addr, val, ATOMIC_SEQ_CST)
+	#define AtomicFetchAndSeqCst64(fetch_addr, val)	__atomic_fetch_and(fetch_addr, val, ATOMIC_SEQ_CST)
 	
 	#define AtomicCompareExchangeRlxRlx32(dst_addr, cmp_addr, exch_val)	    __atomic_compare_exchange_n(dst_addr, cmp_addr, exch_val, 0, ATOMIC_RELAXED, ATOMIC_RELAXED)
 	#define AtomicCompareExchangeAcqRlx32(dst_addr, cmp_addr, exch_val)	    __atomic_compare_exchange_n(dst_addr, cmp_addr, exch_val, 0, ATOMIC_ACQUIRE, ATOMIC_RELAXED)
@@ -133,6 +139,17 @@ extern "C" {
 	#define AtomicStoreFromAddrRlx64(dst_addr, src_addr)	__atomic_store(dst_addr, src_addr, ATOMIC_RELAXED)
 	#define AtomicStoreFromAddrRel64(dst_addr, src_addr)	__atomic_store(dst_addr, src_addr, ATOMIC_ACQUIRE)
 	#define AtomicStoreFromAddrSeqCst64(dst_addr, src_addr)	__atomic_store(dst_addr, src_addr, ATOMIC_SEQ_CST)
+
+	/* full memory barrier, no load or store may be reordered across it */
+	#define AtomicThreadFenceSeqCst()	__atomic_thread_fence(ATOMIC_SEQ_CST)
+	/* spin-wait hint, lets the core's hyperthread sibling run while we spin */
+	#if defined(__x86_64__) || defined(__i386__)
+		#define AtomicSpinPause()	__builtin_ia32_pause()
+	#elif defined(__aarch64__) || defined(__arm__)
+		#define AtomicSpinPause()	__asm__ __volatile__("yield")
+	#else
+		#define AtomicSpinPause()	
+	#endif
 	
 	/********************  Overflow Checking ********************/
 	
@@ -179,6 +196,12 @@ extern "C" {
 	#define AtomicFetchSubAcq64(fetch_addr, val)	_InterlockedExchangeAdd64((__int64 volatile *) (fetch_addr), -(__int64) (val))
 	#define AtomicFetchSubRel64(fetch_addr, val)	_InterlockedExchangeAdd64((__int64 volatile *) (fetch_addr), -(__int64) (val))
 	#define AtomicFetchSubSeqCst64(fetch_addr, val)	_InterlockedExchangeAdd64((__int64 volatile *) (fetch_addr), -(__int64) (val))
+
+	#define AtomicFetchOrRlx64(fetch_addr, val)	_InterlockedOr64((__int64 volatile *) (fetch_addr), (__int64) (val))
+	#define AtomicFetchOrSeqCst32(fetch_addr, val)	_InterlockedOr((long volatile *) (fetch_addr), (long) (val))
+	#define AtomicFetchAndSeqCst32(fetch_addr, val)	_InterlockedAnd((long volatile *) (fetch_addr), (long) (val))
+	#define AtomicFetchOrSeqCst64(fetch_addr, val)	_InterlockedOr64((__int64 volatile *) (fetch_addr), (__int64) (val))
+	#define AtomicFetchAndSeqCst64(fetch_addr, val)	_InterlockedAnd64((__int64 volatile *) (fetch_addr), (__int64) (val))
 	
 	__forceinline u32 ds_InterlockedCompareExchange(long volatile* dst_addr, long exch_val, long* cmp_addr)
 	{
@@ -272,6 +295,11 @@ extern "C" {
 	#define AtomicStoreFromAddrRlx64(dst_addr, src_addr)	AtomicStoreRlx64(dst_addr, *(src_addr))
 	#define AtomicStoreFromAddrRel64(dst_addr, src_addr)	AtomicStoreRel64(dst_addr, *(src_addr))
 	#define AtomicStoreFromAddrSeqCst64(dst_addr, src_addr)	AtomicStoreSeqCst64(dst_addr, *(src_addr))
+
+	/* full memory barrier, no load or store may be reordered across it */
+	#define AtomicThreadFenceSeqCst()	_mm_mfence()
+	/* spin-wait hint, lets the core's hyperthread sibling run while we spin */
+	#define AtomicSpinPause()		_mm_pause()
 	
 	/******************************************** Overflow Checking ********************************************/
 	
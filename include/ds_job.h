@@ -25,7 +25,8 @@ extern "C" {
 #endif
 
 #include "ds_base.h"
-#include "fifo_spmc.h"
+#include "ds_semaphore.h"
+#include "deque_ws.h"
 
 /* NOTE: WE ASSUME MASTER THREAD/WORKER HAS ID AND INDEX 0. */
 
@@ -33,21 +34,45 @@ extern struct task_context *g_task_ctx;
 
 typedef void (*TASK)(void *);
 
+/* 
+ * Task priority: every worker has a deque per priority, and workers drain every high priority deque, their own
+ * and other workers', before taking normal priority work. Tasks dispatched from a running task inherit its 
+ * priority, tasks dispatched from outside any task are normal priority unless tagged.
+ */
+enum task_priority
+{
+	TASK_PRIORITY_NORMAL,	/* background and throughput work */
+	TASK_PRIORITY_HIGH,	/* work the frame is waiting on */
+	TASK_PRIORITY_COUNT
+};
+
+/*
+ * Workers are laid out in an array, so every worker starts on its own cacheline pair, and the state other 
+ * threads write (the frame clear flag, the stream semaphore) is kept off the lines of the read-mostly state 
+ * that thieves read on every steal.
+ */
 struct worker
 {
-	//TODO Cacheline alignment 
-	struct arena	mem_frame;		/* Cleared at start of every frame */	
+	/* pads for 64 and 128 cachelines */
+	ds_Align(DS_CACHE_LINE_UB) struct arena	mem_frame;	/* Cleared at start of every frame */	
 	dsThread *	thr;
-	u32 		a_mem_frame_clear;	/* atomic sync-point: if set, on next task run flush mem_frame. */
+	struct dequeWs *tasks[TASK_PRIORITY_COUNT];	/* tasks dispatched by the worker's thread, stolen by idle workers */
+	u32		cache_group;		/* last level cache group of the pinned cpu, or TASK_LOCALITY_ANY */
+	u8		pad1[DS_CACHE_LINE_UB];
+	ds_Align(DS_CACHE_LINE_UB) u32 	a_mem_frame_clear;	/* atomic sync-point: if set, on next task run flush mem_frame. */
+	u64		a_inline_count;		/* tasks run at dispatch since the deque could not grow */
+	u8		pad2[DS_CACHE_LINE_UB];
+	ds_Align(DS_CACHE_LINE_UB) semaphore wait_wake;	/* posted when a stream, bundle, graph or counter the worker is blocked on may have made progress */
+	u8		pad3[DS_CACHE_LINE_UB];
 };
 
-/* Task bundle: set of tasks commited at the same time. */
+/* Task bundle: set of tasks commited at the same time. Bundles live in the memory they are split in, so any
+ * number of bundles, from any thread, may be in flight at once. */
 struct task_bundle 
 {
-	semaphore 	bundle_completed;
 	struct task *	tasks;
 	u32 		task_count;
-	u32 		a_tasks_left;
+	u32 		a_tasks_left;	/* bundle is complete once zero */
 };
 
 struct task_range 
@@ -60,8 +85,14 @@ enum task_batch_type
 {
 	TASK_BATCH_BUNDLE,
 	TASK_BATCH_STREAM,
+	TASK_BATCH_GRAPH,
+	TASK_BATCH_FIBER,
+	TASK_BATCH_NONE,
 };
 
+/* task locality hint: no preferred cache group */
+#define TASK_LOCALITY_ANY	U32_MAX
+
 struct task
 {
 	struct worker *executor;
@@ -72,63 +103,226 @@ struct task
 					 * 	interval of range input.
 					 */
 
+	enum task_priority priority;
+	u32 locality;			/* cache group (g_arch_config->cpu_cache_group) the task prefers to run 
+					 * in, or TASK_LOCALITY_ANY. Workers of other groups only steal the task 
+					 * once their own group has run out of work. */
 	enum task_batch_type batch_type;
-	void *batch;			/* pointer to bundle or stream.
+	void *batch;			/* pointer to bundle, stream or graph node.
 					 * If task_bundle, if set, we keep track of when it is done.
 					 * If task_stream, increment stream->a_completed at end.
+					 * If task_graph_node, the node or one of its forks finished.
+					 * If task_counter, the task runs on a fiber and decrements the
+					 * counter once finished.
 					 * */
 };
 
-/* TODO Beware: Make sure to not false-share data between threads here, pad any structs if needed. */
+/* 
+ * The read-only configuration is read on every steal, while a_sleeping and a_blocked are written whenever a 
+ * worker goes to sleep or blocks, or a dispatch or completion wakes one, so the two are kept on separate cachelines.
+ */
 struct task_context
 {
-	struct task_bundle bundle; /* TODO: Temporary */
-	struct fifoSpmc *tasks;
-	struct worker *workers;
+	/* pads for 64 and 128 cachelines */
+	ds_Align(DS_CACHE_LINE_UB) struct worker *workers;
 	u32 worker_count;
+	u32 pinned;		/* workers are pinned to cpus, one per physical core first */
+	struct task_fiberTPool *fibers;		/* pool of fibers for fiber tasks, or NULL if unsupported */
+	u64 *a_blocked;		/* bitmap, bit i%64 of word i/64 set: worker i is blocked waiting on a bundle, 
+				 * graph or counter. The words are cacheline aligned, apart from this configuration. */
+	u32 blocked_word_count;
+	u8 pad1[DS_CACHE_LINE_UB];
+	ds_Align(DS_CACHE_LINE_UB) u32 a_sleeping;	/* workers going to sleep which no dispatch has woken yet */
+	u8 pad2[DS_CACHE_LINE_UB];
+	ds_Align(DS_CACHE_LINE_UB) semaphore wake;	/* posted once for every sleeping worker woken by a dispatch */
 };
 
-/* Init task_context, setup threads inside task_main */
-void 	task_context_init(struct arena *mem_persistent, const u32 thread_count);
+/* Task queue statistics over all workers */
+struct task_queue_stats
+{
+	u64 peak;		/* most tasks queued at once on a single worker */
+	u64 capacity;		/* largest worker deque capacity */
+	u64 inline_count;	/* tasks run at dispatch since a deque could not grow */
+	u64 fiber_count;	/* fibers allocated by the fiber pool */
+};
+
+/* Init task_context, setup threads inside task_main. If pin_workers, worker i > 0 is pinned to 
+ * g_arch_config->cpu_order[i], so workers fill every physical core before sharing one. The master (worker 0) is 
+ * never pinned, since every thread it creates afterwards would inherit its affinity. */
+void 	task_context_init(struct arena *mem_persistent, const u32 thread_count, const u32 pin_workers);
 /* Destory resources */
 void 	task_context_destroy(struct task_context *ctx);
+/* return the cache group of the calling worker, or TASK_LOCALITY_ANY if workers are not pinned */
+u32	task_locality(void);
+/* return the index of the calling worker, in [0, worker_count); the main thread is worker 0 */
+u32	task_worker_index(void);
+/* return a snapshot of the task queue statistics */
+struct task_queue_stats	task_context_queue_stats(void);
 /* Clear any frame resources held by the task context and it's workers */
 void	task_context_frame_clear(void);
 /* main loop for slave workers */
 void  	task_main(dsThread *thr);
-/* master worker runs any available work */
+/* Calling worker runs any available work, its own tasks first and then tasks stolen from other workers. The
+ * master and any running task may dispatch work; tasks are pushed onto the dispatching worker's own deque. */
 void 	task_main_master_run_available_jobs(void);
 
 /*********************** Task Streams ***********************/ 
 
 /*
  * Simple lock-free data structure for continuously dispatching and keeping track of work. Every task dispatched
- * using api will increment a_completed on completion. 
+ * using api will increment a_completed on completion. A stream is owned by the thread dispatching into it, which
+ * may be a task spawning subtasks.
  */
+#define TASK_STREAM_WAITING	0x80000000u	/* a_completed flag: the owner is blocked waiting on the stream */
 struct task_stream
 {
-	u32 a_completed;	/* atomic completed tasks counter */
-	u32 task_count;		/* owned by main-thread 	  */
+	struct worker *	owner;		/* dispatching and waiting worker */
+	enum task_priority priority;	/* priority of dispatched tasks */
+	u32 		a_completed;	/* atomic completed tasks counter and TASK_STREAM_WAITING */
+	u32 		task_count;	/* owned by dispatching thread	  */
 };
 
-/* acquire resources (if any) */
+/* acquire resources (if any); tasks are dispatched with the calling task's priority */
 struct task_stream *	task_stream_init(struct arena *mem);
+/* set the priority of tasks dispatched into the stream from now on */
+void			task_stream_priority_set(struct task_stream *stream, const enum task_priority priority);
 /* Dispatch task for workers to immediately pick up */
 void 			task_stream_dispatch(struct arena *mem, struct task_stream *stream, TASK func, void *args);
-/* spin inside method until  a_completed == total */
+/* Dispatch task with a locality hint, see struct task */
+void 			task_stream_dispatch_local(struct arena *mem, struct task_stream *stream, TASK func, void *args, const u32 locality);
+/* Wait until a_completed == total. The owner runs available tasks while there are any, then spins with a pause
+ * hint for a short while, and finally blocks until a task of the stream completes. */
 void			task_stream_spin_wait(struct task_stream *stream);	
 /* cleanup resources (if any) */
 void			task_stream_cleanup(struct task_stream *stream);
 
+/*********************** Task Graphs ***********************/ 
+
+/*
+ * Task graph: every node declares the nodes it depends on, and is dispatched as soon as its last dependency 
+ * completes, so independent chains of work overlap instead of meeting at serial barriers. A running node may 
+ * fork subtasks; the node completes, and releases its successors, only when the node task and all of its forks 
+ * (and their forks) have finished, so work created at runtime is joined without an extra node.
+ *
+ * The graph is built by a single thread and is immutable once dispatched, apart from forks.
+ */
+struct task_graph_edge
+{
+	struct task_graph_node *node;
+	struct task_graph_edge *next;
+};
+
+struct task_graph_node
+{
+	struct task 		task;			/* node task, task.batch points to the node */
+	struct task_graph *	graph;
+	struct task_graph_node *next;			/* next node in graph */
+	struct task_graph_edge *successor;		/* nodes depending on this node */
+	u32 			dependency_count;
+	u32 			a_pending;		/* dependencies not yet completed */
+	u32 			a_unfinished;		/* node task and forks not yet completed */
+};
+
+struct task_graph
+{
+	struct task_graph_node *first;
+	struct task_graph_node *last;
+	u32 			node_count;
+	u32 			a_nodes_left;		/* nodes not yet completed */
+	u32 			dispatched;
+};
+
+/* acquire resources; the graph and its nodes live in mem until the graph has completed */
+struct task_graph *	task_graph_init(struct arena *mem);
+/* add a node running func(task) with task->input = args */
+struct task_graph_node *task_graph_add(struct arena *mem, struct task_graph *graph, TASK func, void *args);
+/* set the node's priority, its forks inherit it; nodes are added with the calling task's priority */
+void			task_graph_node_priority_set(struct task_graph_node *node, const enum task_priority priority);
+/* node may not start before dependency has completed */
+void			task_graph_depend(struct arena *mem, struct task_graph_node *node, struct task_graph_node *dependency);
+/* dispatch every node without dependencies; the remaining nodes are dispatched as their dependencies complete */
+void			task_graph_dispatch(struct task_graph *graph);
+/* Called from within a running graph task: dispatch a subtask which the task's node joins before completing. 
+ * mem must outlive the subtask, and may not be used concurrently by other threads. */
+void			task_graph_fork(struct arena *mem, struct task *running, TASK func, void *args);
+/* task_graph_fork with a locality hint, see struct task */
+void			task_graph_fork_local(struct arena *mem, struct task *running, TASK func, void *args, const u32 locality);
+/* run available tasks, including stolen ones, until every node of the graph has completed; once out of tasks, 
+ * back off and block as streams do */
+void			task_graph_wait(struct task_graph *graph);
+
 /*********************** Task Bundles ***********************/ 
 
-/* Split input range into split_count iterable intervals. task is then run iterably, and TODO: what do we return? */
+/* Split input range into split_count iterable intervals and dispatch a task per interval. The bundle is allocated
+ * in mem_task_lifetime, which must outlive the bundle. Returns NULL if there is nothing to split. */
 struct task_bundle *	task_bundle_split_range(struct arena *mem_task_lifetime, TASK task, const u32 split_count, void *inputs, const u64 input_count, const u64 input_element_size, void *shared_arguments);
-/* Blocked wait on bundle complete */
+/* return 1 if every task of the bundle has completed */
+u32			task_bundle_completed(const struct task_bundle *bundle);
+/* run available tasks until the bundle has completed; once out of tasks, back off and block as streams do */
 void			task_bundle_wait(struct task_bundle *bundle);
-/* Clear and release task bundle for reallocation */
+/* task_bundle_wait on all of the bundles; NULL bundles are skipped */
+void			task_bundle_wait_all(struct task_bundle **bundles, const u32 count);
+/* task_bundle_wait until any of the bundles has completed and return its index; NULL bundles count as 
+ * completed */
+u32			task_bundle_wait_any(struct task_bundle **bundles, const u32 count);
+/* release a completed task bundle; its memory is released with mem_task_lifetime */
 void			task_bundle_release(struct task_bundle *bundle);
 
+/*********************** Parallel For ***********************/ 
+
+/*
+ * Parallel for: instead of splitting the range into fixed slices up front, participating threads repeatedly claim
+ * the next chunk of the range from a shared counter. Chunks are guided; a claim takes a share of the remaining 
+ * elements proportional to 1/worker_count, but never less than min_chunk, so early chunks are large and the tail 
+ * is balanced over small chunks. The calling thread claims chunks itself and helps with other tasks until 
+ * every chunk has completed.
+ */
+struct task_parallel_for
+{
+	struct task_bundle	bundle;		/* helper tasks claiming chunks on other workers */
+	TASK			task;
+	void *			shared_arguments;
+	u8 *			inputs;
+	u64			input_count;
+	u64			input_element_size;
+	u64			min_chunk;
+	u64			a_next;		/* first unclaimed input element */
+};
+
+/* Run task over the input range, task->range being the claimed chunk and task->input = shared_arguments. 
+ * Blocks until the whole range has been processed; helper state is allocated in mem_tmp. */
+void			task_parallel_for(struct arena *mem_tmp, TASK task, void *inputs, const u64 input_count, const u64 input_element_size, const u64 min_chunk, void *shared_arguments);
+
+/*********************** Fiber Tasks ***********************/ 
+
+/*
+ * Fiber tasks run on small pooled stacks instead of the worker's own stack, so a fiber task waiting on a counter
+ * does not hold on to its worker: the fiber is switched out, the worker goes on with other tasks, and whichever 
+ * worker picks up the fiber once the counter reaches zero resumes it. Fiber tasks may dispatch and wait on fiber
+ * tasks of their own to any depth; the pool grows whenever every fiber is in use, rather than nesting tasks on a
+ * worker's stack.
+ *
+ * A fiber may continue on another thread after a wait, so thread local state (including profiling zones and task
+ * streams, which belong to the dispatching thread) may not be carried over a wait. Waits from outside fiber tasks,
+ * or from plain tasks run by a fiber task, run available tasks until the count is zero. On platforms without 
+ * fibers, fiber tasks run as plain tasks.
+ */
+#define TASK_COUNTER_LOCKED	0x80000000u	/* a_state flag: the waiter list is being modified */
+struct task_counter
+{
+	u32 			a_state;	/* unfinished fiber tasks and TASK_COUNTER_LOCKED */
+	struct task_fiber *	waiter;		/* fibers suspended until the count reaches zero */
+};
+
+/* init counter to zero; the counter must outlive every task dispatched on it */
+void			task_counter_init(struct task_counter *counter);
+/* return 1 if every task dispatched on the counter has completed */
+u32			task_counter_completed(const struct task_counter *counter);
+/* wait until every task dispatched on the counter has completed; from a fiber task, suspend the fiber */
+void			task_counter_wait(struct task_counter *counter);
+/* Dispatch a task running func(task) on a fiber, with task->input = args, and count it on counter */
+void			task_fiber_dispatch(struct arena *mem, struct task_counter *counter, TASK func, void *args);
+
 #ifdef __cplusplus
 }
 #endif
@@ -63,6 +63,56 @@ tid 		ds_ThreadSelfTid(void);
 u32		    ds_ThreadIndex(const dsThread *thr);
 /* Return index of caller */ 
 u32		    ds_ThreadSelfIndex(void);
+/* Pin the calling thread to the given logical cpu; returns 1 on success, 0 otherwise */
+u32		    ds_ThreadSelfAffinitySet(const u32 cpu);
+
+/*
+ * Fibers: execution contexts with their own stack, switched to explicitly by the running thread. A fiber that
+ * has been switched out may be switched to again from any thread.
+ */
+#if __DS_PLATFORM__ == __DS_LINUX__
+
+#include <ucontext.h>
+struct dsFiber
+{
+	ucontext_t	context;
+	void		(*start)(void *);	/* beginning of execution for fiber */
+	void *		args;			/* fiber function arguments */
+};
+
+#elif __DS_PLATFORM__ == __DS_WEB__
+
+struct dsFiber
+{
+	void		(*start)(void *);	/* fibers are unsupported */
+	void *		args;
+};
+
+#elif __DS_PLATFORM__ == __DS_WIN64__
+
+/* fiber stacks are allocated by the platform; ds_FiberInit takes no stack */
+#define DS_FIBER_NATIVE_STACK
+struct dsFiber
+{
+	LPVOID		native;			/* native fiber handle */
+	void		(*start)(void *);	/* beginning of execution for fiber */
+	void *		args;			/* fiber function arguments */
+};
+
+#endif
+
+typedef struct dsFiber dsFiber;
+
+/* Prepare the calling thread for fiber switches; must be called by a thread before its first ds_FiberSwitch */
+void		ds_FiberThreadInit(void);
+/* Init fiber, running start(args) on the given stack once first switched to; start may never return. If
+ * DS_FIBER_NATIVE_STACK is defined, the platform allocates a stack of stack_size itself and stack must be NULL. 
+ * Returns 1 on success, 0 on failure or if fibers are unsupported on the platform. */
+u32		ds_FiberInit(dsFiber *fiber, void *stack, const u64 stack_size, void (*start)(void *), void *args);
+/* Release fiber resources; the fiber may not be running */
+void		ds_FiberDestroy(dsFiber *fiber);
+/* Save the running context in from and continue running to */
+void		ds_FiberSwitch(dsFiber *from, dsFiber *to);
 
 #ifdef __cplusplus
 } 
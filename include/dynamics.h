@@ -30,6 +30,7 @@ extern "C" {
 #include "collision.h"
 #include "ds_hash_map.h"
 #include "bit_vector.h"
+#include "ds_vector.h"
 
 //TODO 
 struct ds_RigidBodyPipeline;
@@ -130,7 +131,7 @@ struct ds_Shape
 	ds_Transform	t_local;	        /* local body frame transform 			            */
 
 	/* DYNAMIC STATE */
-	u32			    proxy;		        /* BVH index 					                    */
+	u32			    proxy;		        /* BVH index, U32_MAX if not (yet) in the BVH       */
 };
 
 /*
@@ -184,6 +185,15 @@ struct ds_ShapePrefabInstance
  * an identifier to the shape is returned. On failure, U64 is return. 
  */
 ds_ShapeId  ds_ShapeAdd(struct ds_RigidBodyPipeline *pipeline, const struct ds_ShapePrefab *prefab, const ds_Transform *t, const ds_RigidBodyId body);
+/*
+ * Allocate and initiate a shape on the body without inserting its proxy into the shape BVH; used by bulk
+ * body creation. On failure, an empty slot is returned.
+ */
+struct slot ds_ShapeAlloc(struct ds_RigidBodyPipeline *pipeline, const struct ds_ShapePrefab *prefab, const ds_Transform *t, const ds_RigidBodyId body);
+/*
+ * Return the bounding box of the shape's BVH proxy, i.e. its world bounding box extended by its margin.
+ */
+struct aabb ds_ShapeProxyBbox(const struct ds_RigidBodyPipeline *pipeline, const struct ds_Shape *shape);
 /* 
  * Remove the specified shape of a DYNAMIC body and update the island database and contact database state.  
  */
@@ -277,6 +287,9 @@ struct ds_RigidBody
 	mat3 		    inv_inertia_tensor;
 	f32 		    mass;			        /* total body mass */
 
+	u32		        awake_index;	        /* index in pipeline->body_awake_list, or U32_MAX if the
+                                               body's proxies are asleep (sleeping or static body)  */
+
     //TODO Why do we store this here ...
 	u32 	        entity;
 };
@@ -307,10 +320,41 @@ struct ds_RigidBodyPrefab
 ds_RigidBodyId  ds_RigidBodyAdd(struct ds_RigidBodyPipeline *pipeline, const struct ds_RigidBodyPrefab *prefab, const ds_Transform *t_world, const u32 entity);
 /* Free the given body */
 void            ds_RigidBodyRemove(struct arena *mem_tmp, struct ds_RigidBodyPipeline *pipeline, const ds_RigidBodyId id);
+
+/* Bulk body creation input: body i is created from body_prefab[i] at t_world[i] with entity[i], and is given a 
+ * single shape from shape_prefab[i] at local transform t_local[i]. */
+struct ds_RigidBodyBatch
+{
+	const struct ds_RigidBodyPrefab **  body_prefab;
+	const struct ds_ShapePrefab **      shape_prefab;
+	const ds_Transform *                t_world;
+	const ds_Transform *                t_local;
+	const u32 *                         entity;
+	u32                                 count;
+};
+
+/* 
+ * Add batch->count bodies at once. World bounding boxes are computed in parallel, and the new proxies are built 
+ * into a single binned SAH subtree which is grafted into the shape BVH, instead of being inserted one by one.
+ * Body and shape ids are written to body_id[i] and, if non-NULL, shape_id[i]. Must not be called while ticks
+ * are in flight.
+ */
+void            ds_RigidBodyAddBatch(struct arena *mem_tmp, struct ds_RigidBodyPipeline *pipeline, ds_RigidBodyId *body_id, ds_ShapeId *shape_id, const struct ds_RigidBodyBatch *batch);
+/* Free the given bodies; their proxies are removed from the shape BVH in one pass without rebalancing. Stale 
+ * ids are skipped. */
+void            ds_RigidBodyRemoveBatch(struct arena *mem_tmp, struct ds_RigidBodyPipeline *pipeline, const ds_RigidBodyId *id, const u32 count);
 /* Lookup the given body and return it. If it does not exist, return DS_ID_NULL.  */
 struct slot	    ds_RigidBodyLookup(const struct ds_RigidBodyPipeline *pipeline, const ds_RigidBodyId id);
+/* Move the body to the given transform. The body's island is not woken, but a sleeping body's proxies are 
+ * woken so that the broadphase refits them and finds the body's new contacts; static proxies are refit at 
+ * once. Stale ids are skipped. */
+void            ds_RigidBodySetTransform(struct ds_RigidBodyPipeline *pipeline, const ds_RigidBodyId id, const ds_Transform *t_world);
 /* Process the body's shape list and set its internal mass properties accordingly. */
 void		    ds_RigidBodyUpdateMassProperties(struct ds_RigidBodyPipeline *pipeline, const ds_RigidBodyId id);
+/* Add the dynamic body to the awake body list and wake its broadphase proxies */
+void            ds_RigidBodyProxyWake(struct ds_RigidBodyPipeline *pipeline, const u32 index);
+/* Remove the body from the awake body list and put its broadphase proxies to sleep */
+void            ds_RigidBodyProxySleep(struct ds_RigidBodyPipeline *pipeline, const u32 index);
 
 /*
 ds_ContactKey
@@ -335,6 +379,8 @@ struct ds_ContactKey    ds_ContactKeyCanonical(const u32 bodyA, const u32 shapeA
 u32                     ds_ContactKeyHash(const struct ds_ContactKey *key);
 /* Return 1 if the two keys are equivalent, otherwise return  0. */
 u32                     ds_ContactKeyEquivalence(const struct ds_ContactKey *keyA, const struct ds_ContactKey *keyB);
+/* Return 1 if keyA is lexicographically (body0, shape0, body1, shape1) ordered before keyB, otherwise return 0. */
+u32                     ds_ContactKeyLess(const struct ds_ContactKey *keyA, const struct ds_ContactKey *keyB);
 
 /*
 ds_Contact
@@ -359,6 +405,7 @@ struct ds_Contact
 	f32 			        normal_impulse_cache[4];	/* contact_solver solution to contact 
                                                            constraint, or 0.0f                  */
 	u32 			        cached_count;			    /* number of vertices in cache          */
+	u64 			        frame_touched;			    /* last frame the contact was found     */
 };
 
 /* Add and return new contact with unique key and update pipeline state */
@@ -367,7 +414,8 @@ struct slot ds_ContactAdd(struct ds_RigidBodyPipeline *pipeline, const struct c_
 void 	    ds_ContactRemove(struct ds_RigidBodyPipeline *pipeline, const u32 index);
 /* Return the contact associated with the given id. If no such contact is found, return (NULL, NLL_NULL) */
 struct slot ds_ContactLookup(const struct ds_RigidBodyPipeline *pipeline, const ds_ContactId id);
-/* Update contact at the given slot and update pipeline state. */
+/* Update contact at the given slot and update pipeline state. Thread-safe for distinct contacts, given that
+ * no contacts are added or removed concurrently. */
 void        ds_ContactUpdate(struct ds_RigidBodyPipeline *pipeline, const struct slot slot, const struct c_Manifold *cm);
 /* Return the contact associated with the given key. If no such contact is found, return (NULL, NLL_NULL) */
 struct slot ds_ContactKeyLookup(const struct ds_RigidBodyPipeline *pipeline, const struct ds_ContactKey *key);
@@ -427,6 +475,7 @@ struct sat_Cache
 
 	struct sat_CacheKey key;
 	enum sat_CacheType	type;
+	u64                 frame_touched;  /* last frame the cache was used */
 	union
 	{
 		struct
@@ -452,7 +501,7 @@ struct sat_Cache
 TPOOL_DECLARE(sat_Cache)
 THASH_DECLARE(sat_Cache, struct sat_CacheKey)
 
-/* Alloc sat_Cache in pipeline. */
+/* Alloc sat_Cache in pipeline. If the non-growable sat_Cache pool is full, return (U32_MAX, NULL). */
 struct slot sat_CacheAdd(struct cdb *cdb, const struct sat_CacheKey *key);
 /* Dealloc sat_Cache in pipeline. */
 void        sat_CacheRemove(struct cdb *cdb, const u32 index);
@@ -481,20 +530,17 @@ struct cdb
 	struct sat_CacheTPool       sat_cache_pool;
 	struct sat_CacheTHashMap    sat_cache_map;		
 
-	/* PERSISTENT DATA, GROWABLE, keeps track of which slots in contact_net/sat_cache
-     * from last frame that are still being used. At the end of every frame, it is
-     * set to ***_frame_usage, after which and any new contacts/sat_Caches outside
-     * of the slots covered by ***_frame_usage is appended.  
-     */
-	struct bitVec 	contact_persistent_usage; 
-	struct bitVec 	sat_cache_persistent_usage; 
-
-	/* FRAME DATA, NOT GROWABLE, keeps track of which slots in contact_net/sat_cache
-     * in previous frame that are currently being used. Thus, all links in the current
-     * frame are the ones in the bit array + any appended contacts/sat_caches which 
-     * resulted in growing the array. */
-	struct bitVec 	contact_frame_usage;	
-	struct bitVec 	sat_cache_frame_usage;	
+	/* PERSISTENT DATA, GROWABLE, slots in contact_net/sat_cache alive at the end of the last frame. 
+	 * Any entry whose frame_touched stamp was not set during the current frame is stale and removed, 
+	 * after which the list is swapped with the ***_touched list. Contact entries may refer to slots 
+	 * freed outside of the frame; such entries are skipped. */
+	stack_u32 	contact_live; 
+	stack_u32 	sat_cache_live; 
+
+	/* PERSISTENT DATA, GROWABLE, flushed every frame, slots in contact_net/sat_cache touched in the 
+	 * current frame, i.e. found by the narrowphase or kept as is. */
+	stack_u32 	contact_touched;	
+	stack_u32 	sat_cache_touched;	
 
     /* FRAME DATA */
     u32     sat_cache_count;        /* Caches in the current frame              */
@@ -503,8 +549,9 @@ struct cdb
 	u32 *   contact_new;
 };
 
-/* Allocate cdb resources */
-struct cdb *cdb_Alloc(struct arena *mem_persistent, const u32 initial_size);
+/* Allocate cdb resources; a non-growable cdb never holds more than contact_length contacts and sat_cache_length
+ * sat caches */
+struct cdb *cdb_Alloc(struct arena *mem_persistent, const u32 contact_length, const u32 sat_cache_length, const u32 growable);
 /* Deallocate cdb resources */
 void 		cdb_Free(struct cdb *cdb);
 /* Flush cdb resources */
@@ -620,8 +667,8 @@ struct ds_Island
 	POOL_SLOT_STATE;
 	DLL_SLOT_STATE;
 
-	struct ds_RigidBody **	bodies;	
-	struct ds_Contact 	**	contacts;
+	struct ds_RigidBody **	bodies;		/* frame-local contiguous copies of island bodies while solving */
+	struct ds_Contact 	**	contacts;	/* frame-local contiguous copies of island contacts while solving */
 	u32 *			body_index_map; /* body_index -> local indices of bodies in island:
 						 * is->bodies[i] = pipeline->bodies[b] => 
 						 * is->body_index_map[b] = i 
@@ -642,9 +689,9 @@ struct isdb
 	/* PERSISTENT DATA */
 	struct ds_Pool 	island_pool;	/* GROWABLE, list nodes of contacts and bodies	*/
 	struct dll	island_list;
-	/* FRAME DATA */
-	u32 *		possible_splits;				/* Islands in which a contact has been broken during frame */
-	u32 		possible_splits_count;
+	stack_u32	possible_splits;	/* Islands in which a contact has been broken, pending split. Entries may
+						 * be stale (island removed or already split); an entry is valid iff the
+						 * island is allocated and has ISLAND_SPLIT set. */
 };
 
 #ifdef DS_PHYSICS_DEBUG
@@ -656,13 +703,11 @@ struct isdb
 struct ds_RigidBodyPipeline;
 
 /* Setup and allocate memory for new database */
-struct isdb	isdb_Alloc(struct arena *mem_persistent, const u32 initial_size);
+struct isdb	isdb_Alloc(struct arena *mem_persistent, const u32 initial_size, const u32 growable);
 /* Free any heap memory */
 void	   	isdb_Dealloc(struct isdb *is_db);
 /* Flush / reset the island database */
 void		isdb_Flush(struct isdb *is_db);
-/* Clear any frame related data */
-void		isdb_ClearFrame(struct isdb *is_db);
 /* remove island resources from database */
 void 		isdb_IslandRemove(struct ds_RigidBodyPipeline *pipeline, struct ds_Island *is);
 /* Debug printing of island */
@@ -679,6 +724,19 @@ struct ds_Island *	isdb_BodyToIsland(struct ds_RigidBodyPipeline *pipeline, cons
 void 		isdb_MergeIslands(struct ds_RigidBodyPipeline *pipeline, const u32 ci, const u32 b0, const u32 b1);
 /* Split island, or remake if no split happens: TODO: Make thread-safe  */
 void 		isdb_SplitIsland(struct arena *mem_tmp, struct ds_RigidBodyPipeline *pipeline, const u32 island_to_split);
+/* Flag island for splitting and push it onto the pending split stack (if not already flagged) */
+void 		isdb_SplitIslandDefer(struct isdb *is_db, const u32 island);
+/* Split pending islands. If pipeline->config.split_deferred, only split islands about to fall asleep and
+ * islands within the frame's split_body_budget; the remaining islands are solved as single units until
+ * a later frame. */
+void 		isdb_SplitPendingIslands(struct ds_RigidBodyPipeline *pipeline);
+/* 
+ * Rebuild all awake islands from the awake contact set (including new contacts) using a parallel lock-free 
+ * union-find over body indices. Bodies and contacts are compacted into contiguous per-island ranges stored 
+ * in the frame data of the database, and persistent islands are reused whenever possible. Replaces 
+ * isdb_MergeIslands and isdb_SplitIsland when pipeline->config.island_builder == ISLAND_BUILDER_UNION_FIND.
+ */
+void 		isdb_RebuildIslands(struct ds_RigidBodyPipeline *pipeline);
 
 /********* Threaded Island API *********/
 
@@ -703,13 +761,14 @@ struct ds_IslandSolveInput
  * Input: struct ds_Island_solve_in 
  * Output: struct ds_IslandSolveOutput
  *
- * Solves the given island using the global solver config. Since no island shares any contacts or bodies, and every
+ * Solves the given island using the solver config of its pipeline. Since no island shares any contacts or bodies, and every
  * island is a unique task, no shared variables are being written to.
  *
  * - reads pipeline, solver config, cdb, is_db (basically everything)
  * - writes to island,		(unique to thread, memory in cdb)
  * - writes to island->contacts (unique to thread, memory in cdb)
  * - writes to island->bodies	(unique to thread, memory in pipeline)
+ * - appends orientation events of the island's bodies to pipeline->body_event (buffer unique to worker)
  */
 void	ThreadIslandSolve(void *task_input);
 
@@ -723,6 +782,13 @@ contact_solver_config
 Mumerical parameters configuration for solving islands.
 */
 
+enum islandBuilder
+{
+	ISLAND_BUILDER_INCREMENTAL,	/* persistent islands updated by merging on new contacts and splitting on lost contacts */
+	ISLAND_BUILDER_UNION_FIND,	/* awake islands rebuilt every frame using union-find over the awake contact set */
+	ISLAND_BUILDER_COUNT
+};
+
 struct solverConfig
 {
 	u32 	pgs_iteration_count;	/* velocity solver iteration count */
@@ -745,6 +811,15 @@ struct solverConfig
 	f32 	sleep_linear_velocity_sq_limit; /* Range (0.0f, inf] : maximum linear velocity squared that a body falling asleep may have */
 	f32 	sleep_angular_velocity_sq_limit; /* Range (0.0f, inf] : maximum angular velocity squared that a body falling asleep may have */
 
+	u32 	split_deferred;		/* bool : defer island splits until island is about to sleep or budget allows */
+	u32 	split_body_budget;	/* Range [0, U32_MAX] : max number of bodies in deferred islands to split per frame */
+	u32 	island_builder;		/* enum islandBuilder : island management strategy */
+	u32 	substep_count;		/* Range [1, inf) : 1 => single solver step with position correction. N > 1 =>
+					   N velocity/position sub-steps with relaxation per tick (TGS style); 
+					   collision detection still runs once per tick */
+	u32 	deterministic;		/* bool : insert new contacts in ds_ContactKey order and compute a state hash
+					   every frame, see PhysicsPipelineStateHash */
+
 	/* Pending updates */
 	u32 	pending_warmup_solver;		
 	u32 	pending_sleep_enabled;		
@@ -755,11 +830,15 @@ struct solverConfig
 	f32 	pending_restitution_threshold;
 	f32 	pending_linear_dampening;
 	f32 	pending_angular_dampening;
+	u32 	pending_split_deferred;
+	u32 	pending_split_body_budget;
+	u32 	pending_island_builder;
+	u32 	pending_substep_count;
+	u32 	pending_deterministic;
 };
 
-extern struct solverConfig *g_solver_config;
-
-void    SolverConfigInit(const u32 pgs_iteration_count, const u32 ngs_iteration_count, const u32 warmup_solver, const vec3 gravity, const f32 baumgarte_constant, const f32 max_linear_correction, const f32 max_linear_velocity_magnitude, const f32 max_angular_velocity_magnitude, const f32 linear_dampening, const f32 angular_dampening, const f32 linear_slop, const f32 restitution_threshold, const u32 sleep_enabled, const f32 sleep_time_threshold, const f32 sleep_linear_velocity_sq_limit, const f32 sleep_angular_velocity_sq_limit);
+/* Initialize config and its pending values; every pipeline owns its own config, see PhysicsPipelineAlloc */
+void    SolverConfigInit(struct solverConfig *config, const u32 pgs_iteration_count, const u32 ngs_iteration_count, const u32 warmup_solver, const vec3 gravity, const f32 baumgarte_constant, const f32 max_linear_correction, const f32 max_linear_velocity_magnitude, const f32 max_angular_velocity_magnitude, const f32 linear_dampening, const f32 angular_dampening, const f32 linear_slop, const f32 restitution_threshold, const u32 sleep_enabled, const f32 sleep_time_threshold, const f32 sleep_linear_velocity_sq_limit, const f32 sleep_angular_velocity_sq_limit, const u32 split_deferred, const u32 split_body_budget, const u32 island_builder, const u32 substep_count, const u32 deterministic);
 
 
 /*
@@ -781,6 +860,8 @@ struct velocityConstraintPoint
     vec3    contact_point;  /* contact point                                */
 	vec3 	r1;		        /* vector from body 1's center to contact point */
 	vec3 	r2;		        /* vector from body 2's center to contact point */
+	vec3 	local_r1;	        /* r1 in body 1's frame (sub-stepping)          */
+	vec3 	local_r2;	        /* r2 in body 2's frame (sub-stepping)          */
 	f32 	normal_impulse;	/* Normal impulse produced by the contact       */
 	f32	    velocity_bias;	/* scale of velocity_bias along contact normal */
 	f32	    normal_mass;	/* 1.0f / row(J,i)*Inv(M)*J^T entry for point */
@@ -808,6 +889,7 @@ struct velocityConstraint
 
 struct solver
 {
+	const struct solverConfig *	config;		/* config of the pipeline owning the island */
 	f32 			timestep;
 	u32			body_count;
 	u32			contact_count;
@@ -823,7 +905,7 @@ struct solver
     quatptr         rotation;
 };
 
-struct solver *	SolverInitBodyData(struct arena *mem, struct ds_Island *is, const f32 timestep);
+struct solver *	SolverInitBodyData(struct arena *mem, const struct solverConfig *config, struct ds_Island *is, const f32 timestep);
 void 		SolverInitVelocityConstraints(struct arena *mem, struct solver *solver, const struct ds_RigidBodyPipeline *pipeline, const struct ds_Island *is);
 void 		SolverIterateVelocityConstraints(struct solver *solver);
 void        SolverInitPositionConstraints(struct solver *solver, const struct ds_Island *island);
@@ -831,6 +913,19 @@ u32 		SolverIteratePositionConstraints(struct solver *solver);
 void 		SolverWarmup(struct solver *solver, const struct ds_Island *is);
 void 		SolverCacheImpulse(struct solver *solver, const struct ds_Island *is);
 
+/* Sub-stepping (TGS style) solver: the solver is initiated with the sub-step as timestep */
+void        SolverInitSubstepConstraints(struct solver *solver);
+/* integrate external forces and dampening over one sub-step */
+void        SolverIntegrateVelocities(struct solver *solver);
+/* apply the constraint impulses of the previous sub-step */
+void        SolverWarmupSubstep(struct solver *solver);
+/* one iteration over contact constraints using the current separation. use_bias => push out penetration */
+void        SolverIterateSubstepConstraints(struct solver *solver, const u32 use_bias);
+/* integrate world center of mass and rotation over one sub-step */
+void        SolverIntegratePositions(struct solver *solver);
+/* rotate contact levers to the sub-stepped rotations and recompute effective masses from the new world inertia */
+void        SolverUpdateSubstepConstraints(struct solver *solver);
+
 /*
 =================================================================================================================
 |						Physics Pipeline			  	      	    	|
@@ -918,11 +1013,8 @@ enum physicsEventType
 	PHYSICS_EVENT_COUNT
 };
 
-struct physicsEvent
+typedef struct physicsEvent
 {
-	POOL_SLOT_STATE;
-	DLL_SLOT_STATE;
-
 	u64			ns;	/* time of event */
 	enum physicsEventType type;
 	union
@@ -938,6 +1030,161 @@ struct physicsEvent
             ds_ShapeId          contact_removed_shapes[2];
         };
 	};
+} physicsEvent;
+DECLARE_STACK(physicsEvent);
+
+/* Per-thread append-only buffer of PHYSICS_EVENT_BODY_ORIENTATION events, written by island solve tasks
+ * without synchronization. Buffers are cacheline aligned to keep workers from false sharing stack headers. */
+struct physicsEventBuffer
+{
+	ds_Align(DS_CACHE_LINE_UB) stack_physicsEvent	events;
+};
+
+/* Render state of a body with a PHYSICS_EVENT_BODY_ORIENTATION event, taken at the end of the ticks */
+struct ds_BodySnapshot
+{
+	u64			    ns;	                /* time of event */
+	ds_RigidBodyId  body;
+	u32			    entity;
+	vec3		    position;
+	quat		    rotation;
+	vec3		    linear_velocity;
+	vec3		    angular_velocity;
+};
+
+/*
+ * Output of a batch of asynchronous ticks. Orientation events are stored as body snapshots, any other
+ * events are copied as is. Snapshots are double-buffered: the in-flight ticks write one snapshot while
+ * the caller reads the one published at the last PhysicsPipelineFence. In deterministic mode the body 
+ * snapshots are sorted on body index and time, independent of the worker count.
+ */
+struct ds_PhysicsSnapshot
+{
+	struct arena		    mem;	        /* owns bodies and events */
+	struct ds_BodySnapshot *bodies;
+	struct physicsEvent *   events;
+	u32			            body_count;
+	u32			            event_count;
+	u64			            frames_completed;   /* pipeline frames_completed at end of ticks */
+	u64			            state_hash;         /* pipeline state_hash at end of ticks */
+};
+
+/*
+ * Rollback ring: saves of the full pipeline state (bodies, shapes, bvh, contacts with their warm-start 
+ * impulses, sat caches and islands) into preallocated slots, restorable in O(bytes). Pools, maps and lists 
+ * are saved as raw byte regions of their used range; since the pipeline's containers never shrink, a save
+ * can always be copied back into the containers it was taken from.
+ *
+ * In delta mode, the state of the most recent save is kept in full outside of the ring (the shadow state),
+ * and each slot only stores the pages of the shadow state that changed with its save, i.e. an undo log. 
+ * Restoring frame k applies the undo logs of all later saves to the shadow state and copies it back.
+ */
+#define PHYSICS_STATE_REGION_MAX	64
+
+struct ds_PhysicsStateSlot
+{
+	struct arena	mem;		        /* full state, or undo pages in delta mode */
+	u64		        frames_completed;	/* pipeline frames_completed at save */
+};
+
+struct ds_PhysicsRollback
+{
+	struct ds_PhysicsStateSlot *slot;
+	struct ds_MemSlot	        mem_slot;
+	u32			                slot_count;
+	u32			                slot_next;	    /* slot written by the next save */
+	u32			                save_count;	    /* number of valid saves ending at slot_next-1 */
+	u32			                delta;		    /* bool : store changed pages only */
+	u64			                page_size;      /* delta granularity in bytes */
+
+	/* delta mode: state of the most recent save */
+	struct ds_MemSlot	        shadow[PHYSICS_STATE_REGION_MAX];
+	u64			                shadow_size[PHYSICS_STATE_REGION_MAX];
+};
+
+/*
+ * Input log: per-frame record of the inputs applied to a pipeline between ticks (body and shape additions, 
+ * body removals and solver config changes). Inputs are applied and recorded through the PhysicsInput 
+ * functions; replaying the log on a pipeline in the same initial state, with deterministic mode enabled,
+ * reproduces the recorded run, so the state hashes of every frame match. Generation based ids are 
+ * recorded as well, and replay fails if a replayed input is given another id, i.e. the runs diverged.
+ */
+enum physicsInputType
+{
+	PHYSICS_INPUT_BODY_ADD,
+	PHYSICS_INPUT_SHAPE_ADD,
+	PHYSICS_INPUT_BODY_REMOVE,
+	PHYSICS_INPUT_CONFIG,
+	PHYSICS_INPUT_COUNT
+};
+
+struct ds_PhysicsInput
+{
+	u64			frame;		/* pipeline frames_completed when the input was applied */
+	enum physicsInputType	type;
+	union
+	{
+		struct
+		{
+			ds_Transform	t_world;
+			u32		entity;
+			u32		dynamic;
+			ds_RigidBodyId	id;	/* body given by the add */
+		} body_add;
+
+		struct
+		{
+			ds_Transform	t_local;
+			ds_RigidBodyId	body;
+			u32		cshape;
+			f32		density;
+			f32		restitution;
+			f32		friction;
+			f32		margin;
+			ds_ShapeId	id;	/* shape given by the add */
+		} shape_add;
+
+		ds_RigidBodyId		body_remove;
+		struct solverConfig	config;	/* config, including pending values, set on the pipeline */
+	};
+};
+
+struct ds_PhysicsInputLog
+{
+	struct vector	input;	/* struct ds_PhysicsInput, in application order */
+	u32		next;	/* next input to replay */
+};
+
+/*
+ * Physics Capacity: declared maxima of a fixed capacity pipeline, see PhysicsPipelineAllocFixed.
+ */
+struct ds_PhysicsCapacity
+{
+	u32	body_max;
+	u32	shape_max;
+	u32	contact_max;	/* persistent contacts; new contacts beyond the limit are dropped until slots free up,
+				 * so the dropped pairs do not collide. Unlike the other limits this is not fatal; the
+				 * first drop is logged and high_water.contact_dropped counts them. */
+	u32	sat_cache_max;	/* persistent separating axis caches; pairs beyond the limit run uncached */
+	u32	event_max;	/* pending events per event buffer, between event flushes */
+};
+
+/*
+ * Physics High Water: peak resource usage over the lifetime of the pipeline, updated at the end of each frame.
+ */
+struct ds_PhysicsHighWater
+{
+	u32	body;
+	u32	shape;
+	u32	bvh_node;
+	u32	contact;
+	u32	sat_cache;
+	u32	island;
+	u32	awake;
+	u32	event;
+	u32	body_event;		/* largest per worker orientation event buffer */
+	u32	contact_dropped;	/* total new contacts dropped due to a full contact pool */
+	u32	sat_cache_dropped;	/* total pairs run without a sat cache due to a full sat cache pool */
 };
 
 enum rigidBodyColorMode
@@ -960,6 +1207,8 @@ struct ds_RigidBodyPipeline
 	u64				ns_elapsed;		        /* actual ns elasped in pipeline (= 0 at start) */
 	u64				ns_tick;		        /* ns per game tick */
 	u64 			frames_completed;	    /* number of completed physics frames */ 
+	u64 			state_hash;		        /* hash of the body state at the end of the last frame, 
+                                               0 unless config.deterministic */
 
 	struct strdb *	cshape_db;		        /* externally owned */
 	struct strdb *	body_prefab_db;		    /* externally owned */
@@ -967,12 +1216,20 @@ struct ds_RigidBodyPipeline
 	struct ds_Pool	body_pool;
 	struct dll		body_marked_list;	    /* bodies marked for removal */
 	struct dll		body_non_marked_list;	/* bodies alive and non-marked  */
+	stack_u32		body_awake_list;	    /* dynamic bodies with moving proxies, see awake_index */
 
 	struct ds_Pool	shape_pool;
 	struct bvh 		shape_bvh;              /* dynamic bvh of shapes */
 
-	struct ds_Pool	event_pool;
-	struct dll		event_list;
+	stack_physicsEvent	        event;		            /* events in push order, pushed by the thread running the tick */
+	struct physicsEventBuffer * body_event;	            /* orientation events, one buffer per task worker */
+	u32			                body_event_count;
+
+	struct solverConfig	config;		/* solver config, pending values are applied at the start of each frame */
+
+	u32				            fixed;		    /* bool : structures are never reallocated, see PhysicsPipelineAllocFixed */
+	struct ds_PhysicsCapacity	capacity;	    /* allocated capacity, rounded up to powers of two */
+	struct ds_PhysicsHighWater	high_water;
 
 	struct cdb *	cdb;
 	struct isdb 	is_db;
@@ -980,23 +1237,75 @@ struct ds_RigidBodyPipeline
 	struct collisionDebug *	debug;
 	u32			debug_count;
 
+	/* tasks of the current frame, see PhysicsPipelineFrameBegin; allocated in frame memory */
+	struct tcc_Input **		contact_input;		/* narrowphase tasks */
+	struct tcc_Output *		contact_output;		/* narrowphase outputs in broadphase order */
+	u32				contact_input_count;
+	struct ds_IslandSolveInput **	island_input;		/* island solve tasks */
+	struct ds_IslandSolveOutput *	island_output;		/* island solve outputs in island list order */
+	u32				island_input_count;
+
 	//TODO temporary, move somewhere else.
 	vec3 			gravity;	/* gravity constant */
 
 	u32			    margin_on;
 	f32			    margin;
+
+	/* asynchronous ticking, see PhysicsPipelineTickAsync */
+	struct ds_PhysicsSnapshot   snapshot[2];
+	struct arena 	            async_mem;          /* task memory of in-flight ticks */
+	struct task_stream *        async_stream;       /* in-flight ticks, or NULL */
+	u64                         async_frame_count;  /* number of ticks to run in flight */
+	u32                         snapshot_read;      /* snapshot published at the last fence */
+	u32                         async_enabled;
+};
+
+/*
+ * Physics Scheduler: ticks many independent pipelines on the shared task system, see PhysicsSchedulerTick.
+ */
+struct ds_PhysicsScheduler
+{
+	struct arena 			mem;		/* task memory of the current tick */
+	struct ds_RigidBodyPipeline **	pipeline;	/* externally owned pipelines */
+	struct ds_MemSlot		mem_pipeline;
+	u32				pipeline_count;
+	u32				pipeline_max;
 };
 
 /**************** PHYISCS PIPELINE API ****************/
 
 /* Initialize a new growable physics pipeline; ns_tick is the duration of a physics frame. */
 struct ds_RigidBodyPipeline	PhysicsPipelineAlloc(struct arena *mem, const u32 initial_size, const u64 ns_tick, const u64 frame_memory, struct strdb *cshape_db, struct strdb *prefab_db);
+/* Initialize a new fixed capacity physics pipeline. Every structure is sized from the given maxima up front, and
+ * is never reallocated while ticking, so tick latency has no allocation tail. Exceeding body_max or event_max is
+ * fatal, ds_ShapeAdd returns DS_ID_NULL beyond shape_max; see ds_PhysicsCapacity for contacts and sat caches. */
+struct ds_RigidBodyPipeline	PhysicsPipelineAllocFixed(struct arena *mem, const struct ds_PhysicsCapacity *capacity, const u64 ns_tick, const u64 frame_memory, struct strdb *cshape_db, struct strdb *prefab_db);
 /* free pipeline resources */
 void 			PhysicsPipelineFree(struct ds_RigidBodyPipeline *physics_pipeline);
 /* flush pipeline resources */
 void			PhysicsPipelineFlush(struct ds_RigidBodyPipeline *physics_pipeline);
+/* discard all pending events; events accumulate over ticks until flushed or captured into a snapshot */
+void			PhysicsPipelineEventFlush(struct ds_RigidBodyPipeline *pipeline);
 /* pipeline main method: simulate a single physics frame and update internal state  */
 void 			PhysicsPipelineTick(struct ds_RigidBodyPipeline *pipeline);
+/* Return a hash of the pipeline's body state (transforms, velocities, flags, island indices) taken in body
+ * index order. Given identical inputs each frame, deterministic runs produce identical hashes independent of
+ * the number of workers, so lockstep peers can compare hashes to detect desyncs. */
+u64			PhysicsPipelineStateHash(const struct ds_RigidBodyPipeline *pipeline);
+/* enable asynchronous ticking; each of the two snapshots is given snapshot_memory bytes */
+void 			PhysicsPipelineAsyncEnable(struct ds_RigidBodyPipeline *pipeline, const u64 snapshot_memory);
+/* fence any in-flight ticks and disable asynchronous ticking */
+void 			PhysicsPipelineAsyncDisable(struct ds_RigidBodyPipeline *pipeline);
+/* Run frame_count ticks on a worker and return immediately. The tick task dispatches the pipeline tasks 
+ * onto its own deque. Until the next PhysicsPipelineFence, the caller may not access the pipeline nor 
+ * dispatch any tasks. If no workers exist, tick synchronously. */
+void 			PhysicsPipelineTickAsync(struct ds_RigidBodyPipeline *pipeline, const u64 frame_count);
+/* Wait for in-flight ticks to complete and publish their snapshot. Does nothing if no ticks are in flight. */
+void 			PhysicsPipelineFence(struct ds_RigidBodyPipeline *pipeline);
+/* return the snapshot published at the last fence, valid until the next fence */
+const struct ds_PhysicsSnapshot *PhysicsPipelineSnapshot(const struct ds_RigidBodyPipeline *pipeline);
+/* release the published snapshot after it has been consumed */
+void 			PhysicsPipelineSnapshotRelease(struct ds_RigidBodyPipeline *pipeline);
 /* allocate new rigid body in pipeline and return its slot */
 struct slot		PhysicsPipelineRigidBodyAlloc(struct ds_RigidBodyPipeline *pipeline, struct ds_RigidBodyPrefab *prefab, const vec3 position, const quat rotation, const u32 entity);
 /* deallocate a collision shape associated with the given handle. If no shape is found, do nothing */
@@ -1009,9 +1318,73 @@ u32f32 			PhysicsPipelineRaycastParameter(struct arena *mem_tmp1, struct arena *
 void 			PhysicsPipelineSleepEnable(struct ds_RigidBodyPipeline *pipeline);
 /* disable sleeping in pipeline */
 void 			PhysicsPipelineSleepDisable(struct ds_RigidBodyPipeline *pipeline);
-/* Print resource usage */
+/* Print resource usage and high-water marks */
 void            PhysicsPipelinePrintUsage(const struct ds_RigidBodyPipeline *pipeline);
 
+/**************** PHYISCS SCHEDULER API ****************/
+
+/* Allocate a scheduler for up to pipeline_max pipelines; task_memory bytes hold the tasks of a tick */
+struct ds_PhysicsScheduler	PhysicsSchedulerAlloc(const u32 pipeline_max, const u64 task_memory);
+/* free scheduler resources; the pipelines are externally owned */
+void 			PhysicsSchedulerFree(struct ds_PhysicsScheduler *scheduler);
+/* add pipeline to the scheduler; asynchronous ticking may not be enabled on the pipeline */
+void 			PhysicsSchedulerAdd(struct ds_PhysicsScheduler *scheduler, struct ds_RigidBodyPipeline *pipeline);
+/* remove pipeline from the scheduler, if it exists */
+void 			PhysicsSchedulerRemove(struct ds_PhysicsScheduler *scheduler, struct ds_RigidBodyPipeline *pipeline);
+/* Tick every pipeline a single frame. The frame stages of every pipeline form one task graph, in which each
+ * pipeline is an independent chain of stage nodes and the narrowphase and island solve tasks are forks of their
+ * nodes, so pipelines overlap freely and workers balance many small pipelines as well as one large. Results 
+ * equal ticking each pipeline with PhysicsPipelineTick. */
+void 			PhysicsSchedulerTick(struct ds_PhysicsScheduler *scheduler);
+
+/**************** PHYISCS ROLLBACK API ****************/
+
+/* Allocate a ring of slot_count slots with slot_memory bytes each. In delta mode, slots store the pages 
+ * changed since the previous save. */
+struct ds_PhysicsRollback	PhysicsRollbackAlloc(const u32 slot_count, const u64 slot_memory, const u32 delta);
+/* free rollback resources */
+void 			PhysicsRollbackFree(struct ds_PhysicsRollback *rollback);
+/* discard all saves */
+void 			PhysicsRollbackFlush(struct ds_PhysicsRollback *rollback);
+/* Save the pipeline state into the next slot, overwriting the oldest save if the ring is full. Saves must 
+ * be taken in increasing frame order, and never while ticks are in flight. */
+void 			PhysicsPipelineSave(struct ds_PhysicsRollback *rollback, struct ds_RigidBodyPipeline *pipeline);
+/* Restore the pipeline to its saved state at the given frame and discard any saves of later frames. Pending
+ * events are flushed. Returns 1 on success, 0 if no save of the frame exists in the ring. */
+u32 			PhysicsPipelineRestore(struct ds_RigidBodyPipeline *pipeline, struct ds_PhysicsRollback *rollback, const u64 frame);
+
+/**************** PHYISCS INPUT LOG API ****************/
+
+/* Allocate an empty input log */
+struct ds_PhysicsInputLog	PhysicsInputLogAlloc(const u32 initial_count);
+/* free input log resources */
+void 			PhysicsInputLogFree(struct ds_PhysicsInputLog *log);
+/* discard all inputs */
+void 			PhysicsInputLogFlush(struct ds_PhysicsInputLog *log);
+/* Apply the input to the pipeline and record it for the current frame, discarding any recorded inputs after
+ * the replay cursor. Inputs may not be applied while ticks are in flight. */
+ds_RigidBodyId		PhysicsInputBodyAdd(struct ds_PhysicsInputLog *log, struct ds_RigidBodyPipeline *pipeline, const struct ds_RigidBodyPrefab *prefab, const ds_Transform *t_world, const u32 entity);
+ds_ShapeId		PhysicsInputShapeAdd(struct ds_PhysicsInputLog *log, struct ds_RigidBodyPipeline *pipeline, const struct ds_ShapePrefab *prefab, const ds_Transform *t_local, const ds_RigidBodyId body);
+void			PhysicsInputBodyRemove(struct ds_PhysicsInputLog *log, struct arena *mem_tmp, struct ds_RigidBodyPipeline *pipeline, const ds_RigidBodyId id);
+void			PhysicsInputConfig(struct ds_PhysicsInputLog *log, struct ds_RigidBodyPipeline *pipeline, const struct solverConfig *config);
+/* Apply the recorded inputs of the pipeline's current frame, advancing the replay cursor. Returns 1 on
+ * success, 0 if a replayed add was given another id than the recorded one. */
+u32 			PhysicsInputLogReplay(struct arena *mem_tmp, struct ds_RigidBodyPipeline *pipeline, struct ds_PhysicsInputLog *log);
+/* Move the replay cursor to the first input of the given frame or later, e.g. after PhysicsPipelineRestore */
+void 			PhysicsInputLogSeek(struct ds_PhysicsInputLog *log, const u64 frame);
+
+/* Serialized pipelines (physics_serialize.c): pools and the shape bvh are written as raw slot arrays, so loading 
+ * is a handful of bulk reads with no per-body insertion or bvh rebuild. Collision shapes are referenced by their 
+ * cshape handles, so the loading pipeline must use the same cshape_db. */
+
+/* Return the number of bytes needed to serialize the pipeline */
+u64 			PhysicsPipelineSerializeSize(const struct ds_RigidBodyPipeline *pipeline);
+/* Serialize the pipeline. Returns 1 on success, 0 if the stream is too small. */
+u32 			PhysicsPipelineSerialize(struct ss *ss, const struct ds_RigidBodyPipeline *pipeline);
+/* Replace the pipeline state with a serialized state. Pending events are flushed. Returns 1 on success, 0 if 
+ * the stream is malformed or incompatible, in which case the pipeline is left flushed. */
+u32 			PhysicsPipelineDeserialize(struct ds_RigidBodyPipeline *pipeline, struct ss *ss);
+
 #ifdef DS_PHYSICS_DEBUG
 #define PHYSICS_PIPELINE_VALIDATE(pipeline)	PhysicsPipelineValidate(pipeline)
 #else
@@ -1022,6 +1395,35 @@ void            PhysicsPipelinePrintUsage(const struct ds_RigidBodyPipeline *pip
 
 /* push physics event into pipeline memory and return pointer to allocated event */
 struct physicsEvent *	PhysicsPipelineEventPush(struct ds_RigidBodyPipeline *pipeline);
+/* push body orientation event into the calling thread's event buffer; safe to call from concurrent tasks */
+void 			PhysicsPipelineBodyEventPush(struct ds_RigidBodyPipeline *pipeline, const ds_RigidBodyId body);
+
+struct task;
+
+/*
+ * Frame stages: a tick is 
+ *
+ * 	PhysicsPipelineFrameBegin => contact tasks => PhysicsPipelineFrameIslands => island tasks => PhysicsPipelineFrameEnd
+ *
+ * The stages themselves never dispatch tasks (except the union find island builder) and only touch their own 
+ * pipeline, so stages of different pipelines may run concurrently. Tasks must be dispatched by the thread 
+ * driving the frame, either into a stream or as forks of the running graph task driving the frame.
+ */
+
+/* clear the last frame, remove marked bodies, apply pending config, update the bvh and set up the contact tasks */
+void 			PhysicsPipelineFrameBegin(struct ds_RigidBodyPipeline *pipeline);
+/* dispatch contact tasks [first, first + count) of the frame, clamped to contact_input_count */
+void 			PhysicsPipelineContactDispatch(struct arena *mem, struct task_stream *stream, struct ds_RigidBodyPipeline *pipeline, const u32 first, const u32 count);
+/* fork every contact task of the frame from the running graph task */
+void 			PhysicsPipelineContactFork(struct arena *mem, struct task *running, struct ds_RigidBodyPipeline *pipeline);
+/* insert new contacts, update islands and set up the island solve tasks */
+void 			PhysicsPipelineFrameIslands(struct ds_RigidBodyPipeline *pipeline);
+/* dispatch island solve tasks [first, first + count) of the frame, clamped to island_input_count */
+void 			PhysicsPipelineIslandDispatch(struct arena *mem, struct task_stream *stream, struct ds_RigidBodyPipeline *pipeline, const u32 first, const u32 count);
+/* fork every island solve task of the frame from the running graph task */
+void 			PhysicsPipelineIslandFork(struct arena *mem, struct task *running, struct ds_RigidBodyPipeline *pipeline);
+/* update proxies of islands falling asleep or waking up and compute the state hash */
+void 			PhysicsPipelineFrameEnd(struct ds_RigidBodyPipeline *pipeline);
 
 #ifdef __cplusplus
 } 
@@ -889,6 +889,21 @@ static void ds_PoolReallocInternal(struct ds_Pool *pool)
 	PoisonAddress(pool->buf + old_length*pool->slot_size, (pool->length-old_length)*pool->slot_size);
 }
 
+u32 ds_PoolReserve(struct ds_Pool *pool, const u32 length)
+{
+	if (pool->length < length && !pool->growable)
+	{
+		return 0;
+	}
+
+	while (pool->length < length)
+	{
+		ds_PoolReallocInternal(pool);
+	}
+
+	return 1;
+}
+
 struct slot ds_PoolAdd(struct ds_Pool *pool)
 {
 	ds_Assert(pool->slot_generation_offset == U64_MAX);
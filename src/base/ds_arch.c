@@ -36,6 +36,9 @@ const struct dsArchConfig *g_arch_config = &config;
 #endif
 
 #include <unistd.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <sys/sysinfo.h>
 
 void ds_Cpuid(u32 *eax, u32 *ebx, u32 *ecx, u32 *edx, const u32 function)
@@ -86,9 +89,61 @@ pid ds_Pid(void)
 	return getpid();
 }
 
+/* read the leading integer of a sysfs file, e.g. the first cpu of a cpu list "0-3,8-11" */
+static u32 internal_sysfs_read_u32(const char *path, u32 *val)
+{
+	const int fd = open(path, O_RDONLY);
+	if (fd == -1)
+	{
+		return 0;
+	}
+
+	char buf[32];
+	const ssize_t len = read(fd, buf, sizeof(buf) - 1);
+	close(fd);
+	if (len <= 0 || buf[0] < '0' || buf[0] > '9')
+	{
+		return 0;
+	}
+
+	buf[len] = '\0';
+	*val = (u32) strtoul(buf, NULL, 10);
+	return 1;
+}
+
+/* key cpus by the first cpu of their core siblings and of the cpus sharing their last level cache */
+static void internal_topology_query(u32 *core_key, u32 *cache_key, const u32 cpu_count)
+{
+	char path[128];
+	for (u32 cpu = 0; cpu < cpu_count; ++cpu)
+	{
+		snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/topology/thread_siblings_list", cpu);
+		internal_sysfs_read_u32(path, core_key + cpu);
+
+		u32 level_max = 0;
+		for (u32 index = 0; index < 8; ++index)
+		{
+			u32 level, first;
+			snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/cache/index%u/level", cpu, index);
+			if (!internal_sysfs_read_u32(path, &level))
+			{
+				break;
+			}
+
+			snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/cache/index%u/shared_cpu_list", cpu, index);
+			if (level >= level_max && internal_sysfs_read_u32(path, &first))
+			{
+				level_max = level;
+				cache_key[cpu] = first;
+			}
+		}
+	}
+}
+
 #elif __DS_PLATFORM__ == __DS_WIN64__
 
 #include <intrin.h>
+#include <stdlib.h>
 
 void ds_Cpuid(u32 *eax, u32 *ebx, u32 *ecx, u32 *edx, const u32 function)
 {
@@ -129,6 +184,45 @@ pid ds_Pid(void)
 	return GetCurrentProcessId();
 }
 
+/* key cpus by the index of their core relation and by the mask of their last level cache relation */
+static void internal_topology_query(u32 *core_key, u32 *cache_key, const u32 cpu_count)
+{
+	DWORD size = 0;
+	GetLogicalProcessorInformation(NULL, &size);
+	SYSTEM_LOGICAL_PROCESSOR_INFORMATION *info = malloc(size);
+	if (!info || !GetLogicalProcessorInformation(info, &size))
+	{
+		free(info);
+		return;
+	}
+
+	const u32 count = size / sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION);
+	u32 level_max = 0;
+	for (u32 i = 0; i < count; ++i)
+	{
+		if (info[i].Relationship == RelationCache && info[i].Cache.Level > level_max)
+		{
+			level_max = info[i].Cache.Level;
+		}
+	}
+
+	for (u32 i = 0; i < count; ++i)
+	{
+		const u32 core = (info[i].Relationship == RelationProcessorCore);
+		const u32 cache = (info[i].Relationship == RelationCache && info[i].Cache.Level == level_max);
+		for (u32 cpu = 0; cpu < cpu_count && cpu < 64; ++cpu)
+		{
+			if (info[i].ProcessorMask & ((ULONG_PTR) 1 << cpu))
+			{
+				core_key[cpu] = (core) ? i : core_key[cpu];
+				cache_key[cpu] = (cache) ? i : cache_key[cpu];
+			}
+		}
+	}
+
+	free(info);
+}
+
 #endif
 
 /**
@@ -151,6 +245,8 @@ static void dsArchConfig_log(void)
 	Log(T_SYSTEM, S_NOTE, "cpu signature - %k", &config.vendor_string);
 	Log(T_SYSTEM, S_NOTE, "cpu - %k", &config.processor_string);
 	Log(T_SYSTEM, S_NOTE, "logical core count - %u", config.logical_core_count);
+	Log(T_SYSTEM, S_NOTE, "physical core count - %u", config.physical_core_count);
+	Log(T_SYSTEM, S_NOTE, "last level cache group count - %u", config.cache_group_count);
 	Log(T_SYSTEM, S_NOTE, "cacheline size - %luB", config.cacheline);
 
 	Log(T_SYSTEM, S_NOTE, "sse : Supported(%s)", (config.sse) ? yes : no);
@@ -484,12 +580,85 @@ static u32 internal_get_intel_arch_config(struct arena *mem)
 	return 1;
 }
 
+/* map per cpu keys to dense indices, in order of first appearance */
+static u32 internal_topology_densify(u32 *index, const u32 *key, const u32 cpu_count)
+{
+	u32 count = 0;
+	for (u32 cpu = 0; cpu < cpu_count; ++cpu)
+	{
+		index[cpu] = count;
+		for (u32 prev = 0; prev < cpu; ++prev)
+		{
+			if (key[prev] == key[cpu])
+			{
+				index[cpu] = index[prev];
+				break;
+			}
+		}
+		count += (index[cpu] == count);
+	}
+
+	return count;
+}
+
+static void internal_topology_init(struct arena *mem)
+{
+	const u32 n = config.logical_core_count;
+	config.cpu_core = ArenaPush(mem, n*sizeof(u32));
+	config.cpu_cache_group = ArenaPush(mem, n*sizeof(u32));
+	config.cpu_order = ArenaPush(mem, n*sizeof(u32));
+
+	ArenaPushRecord(mem);
+	u32 *core_key = ArenaPush(mem, n*sizeof(u32));
+	u32 *cache_key = ArenaPush(mem, n*sizeof(u32));
+	if (!config.cpu_core || !config.cpu_cache_group || !config.cpu_order || !core_key || !cache_key)
+	{
+		LogString(T_SYSTEM, S_FATAL, "Failed to allocate cpu topology, exiting.");
+		FatalCleanupAndExit();
+	}
+
+	for (u32 cpu = 0; cpu < n; ++cpu)
+	{
+		core_key[cpu] = cpu;
+		cache_key[cpu] = 0;
+	}
+	internal_topology_query(core_key, cache_key, n);
+
+	config.physical_core_count = internal_topology_densify(config.cpu_core, core_key, n);
+	config.cache_group_count = internal_topology_densify(config.cpu_cache_group, cache_key, n);
+	ArenaPopRecord(mem);
+
+	/* the first cpu of every core, then the remaining SMT siblings */
+	u32 order = 0;
+	for (u32 pass = 0; pass < 2; ++pass)
+	{
+		for (u32 cpu = 0; cpu < n; ++cpu)
+		{
+			u32 first = 1;
+			for (u32 prev = 0; prev < cpu; ++prev)
+			{
+				if (config.cpu_core[prev] == config.cpu_core[cpu])
+				{
+					first = 0;
+					break;
+				}
+			}
+
+			if (first == (pass == 0))
+			{
+				config.cpu_order[order++] = cpu;
+			}
+		}
+	}
+}
+
 u32 ds_ArchConfigInit(struct arena *mem)
 {
 	config.logical_core_count = ds_LogicalCoreCount();
 	config.pagesize = ds_Pagesize(); 
 	config.pid = ds_Pid();
 	config.cacheline = 64; //TODO
+	internal_topology_init(mem);
 
 	u32 requirements_fullfilled = 1;
 #if __DS_PLATFORM__ == __DS_WEB__
@@ -156,6 +156,23 @@ void ds_ThreadExit(void)
 	pthread_exit(0);
 }
 
+u32 ds_ThreadSelfAffinitySet(const u32 cpu)
+{
+#if __DS_PLATFORM__ == __DS_WEB__
+	return 0;
+#else
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+	{
+		Log(T_SYSTEM, S_WARNING, "Failed to pin thread to cpu %u", cpu);
+		return 0;
+	}
+	return 1;
+#endif
+}
+
 void ds_ThreadWait(const dsThread *thr)
 {
 	void *garbage;
@@ -168,6 +185,78 @@ void ds_ThreadWait(const dsThread *thr)
 	}
 }
 
+#if __DS_PLATFORM__ == __DS_WEB__
+
+void ds_FiberThreadInit(void)
+{
+}
+
+u32 ds_FiberInit(dsFiber *fiber, void *stack, const u64 stack_size, void (*start)(void *), void *args)
+{
+	fiber->start = NULL;
+	fiber->args = NULL;
+	return 0;
+}
+
+void ds_FiberDestroy(dsFiber *fiber)
+{
+}
+
+void ds_FiberSwitch(dsFiber *from, dsFiber *to)
+{
+	ds_AssertString(0, "Fibers are unsupported on the web platform");
+}
+
+#else
+
+/* makecontext only passes int arguments, so the fiber address is split into two halves */
+static void ds_FiberStart(const u32 fiber_lo, const u32 fiber_hi)
+{
+	dsFiber *fiber = (dsFiber *) (((u64) fiber_hi << 32) | (u64) fiber_lo);
+	fiber->start(fiber->args);
+	ds_AssertString(0, "Fiber start function returned");
+}
+
+void ds_FiberThreadInit(void)
+{
+}
+
+u32 ds_FiberInit(dsFiber *fiber, void *stack, const u64 stack_size, void (*start)(void *), void *args)
+{
+	ds_Assert(stack && stack_size > 0);
+
+	fiber->start = start;
+	fiber->args = args;
+	if (getcontext(&fiber->context) != 0)
+	{
+		LogSystemError(S_ERROR);
+		return 0;
+	}
+
+	fiber->context.uc_stack.ss_sp = stack;
+	fiber->context.uc_stack.ss_size = stack_size;
+	fiber->context.uc_link = NULL;
+	makecontext(&fiber->context, (void (*)(void)) ds_FiberStart, 2, (u32) (u64) fiber, (u32) ((u64) fiber >> 32));
+	return 1;
+}
+
+void ds_FiberDestroy(dsFiber *fiber)
+{
+	fiber->start = NULL;
+	fiber->args = NULL;
+}
+
+void ds_FiberSwitch(dsFiber *from, dsFiber *to)
+{
+	if (swapcontext(&from->context, &to->context) != 0)
+	{
+		LogSystemError(S_FATAL);
+		FatalCleanupAndExit();
+	}
+}
+
+#endif
+
 #elif __DS_PLATFORM__ == __DS_WIN64__
 
 struct dsThread
@@ -248,6 +337,16 @@ void ds_ThreadExit(void)
 	ExitThread(0);
 }
 
+u32 ds_ThreadSelfAffinitySet(const u32 cpu)
+{
+	if (cpu >= 64 || !SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR) 1 << cpu))
+	{
+		Log(T_SYSTEM, S_WARNING, "Failed to pin thread to cpu %u", cpu);
+		return 0;
+	}
+	return 1;
+}
+
 void ds_ThreadWait(const dsThread *thr)
 {
 	u32 waited = 1;
@@ -281,6 +380,50 @@ void ds_ThreadWait(const dsThread *thr)
 	return;
 }
 
+static VOID CALLBACK ds_FiberStart(LPVOID void_fiber)
+{
+	dsFiber *fiber = void_fiber;
+	fiber->start(fiber->args);
+	ds_AssertString(0, "Fiber start function returned");
+}
+
+void ds_FiberThreadInit(void)
+{
+	if (!IsThreadAFiber() && !ConvertThreadToFiber(NULL))
+	{
+		LogSystemError(S_FATAL);
+		FatalCleanupAndExit();
+	}
+}
+
+u32 ds_FiberInit(dsFiber *fiber, void *stack, const u64 stack_size, void (*start)(void *), void *args)
+{
+	ds_Assert(!stack && stack_size > 0);
+
+	fiber->start = start;
+	fiber->args = args;
+	fiber->native = CreateFiber(stack_size, ds_FiberStart, fiber);
+	if (!fiber->native)
+	{
+		LogSystemError(S_ERROR);
+		return 0;
+	}
+
+	return 1;
+}
+
+void ds_FiberDestroy(dsFiber *fiber)
+{
+	DeleteFiber(fiber->native);
+	fiber->native = NULL;
+}
+
+void ds_FiberSwitch(dsFiber *from, dsFiber *to)
+{
+	from->native = GetCurrentFiber();
+	SwitchToFiber(to->native);
+}
+
 #endif
 
 void *ds_ThreadReturnValue(const dsThread *thr)
@@ -124,6 +124,15 @@ void BitVecSetBit(const struct bitVec* bvec, const u64 bit, const u64 bit_value)
 	bvec->bits[block] = (bvec->bits[block] & mask) | (bit_value << block_bit);
 }
 
+void BitVecSetBitAtomic(const struct bitVec* bvec, const u64 bit)
+{
+	ds_Assert(bit < bvec->bit_count);
+
+	const u64 block = bit / BIT_VEC_BLOCK_SIZE;
+	const u64 block_bit = bit % BIT_VEC_BLOCK_SIZE;
+	AtomicFetchOrRlx64(bvec->bits + block, (u64) 0x1 << block_bit);
+}
+
 void BitVecClear(struct bitVec* bvec, const u64 clear_bit)
 {
 	for (u64 block = 0; block < bvec->block_count; ++block) 
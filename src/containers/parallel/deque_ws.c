@@ -0,0 +1,212 @@
+/*
+==========================================================================
+    Copyright (C) 2026 Axel Sandstedt 
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+==========================================================================
+*/
+
+#include "ds_base.h"
+#include "deque_ws.h"
+
+#define DEQUE_WS_BLOCK_SIZE	(1024*1024)
+
+struct dequeWs *DequeWsInit(struct arena *mem_persistent, const u32 initial_entry_count)
+{
+	ds_Assert(initial_entry_count > 0 && PowerOfTwoCheck(initial_entry_count));
+
+	struct dequeWs *q = ArenaPushAligned(mem_persistent, sizeof(struct dequeWs), DS_CACHE_LINE_UB);
+	void **entries = ArenaPush(mem_persistent, initial_entry_count * sizeof(void *));
+	if (!q || !entries)
+	{
+		LogString(T_SYSTEM, S_FATAL, "Failed to allocate work-stealing deque, exiting.");
+		FatalCleanupAndExit();
+	}
+
+	q->buffer[0] = (struct dequeWsBuffer) { .entries = entries, .mask = initial_entry_count - 1 };
+	q->buffer_count = 1;
+	AtomicStoreRel64(&q->a_buffer, q->buffer + 0);
+	AtomicStoreRlx64(&q->a_peak, 0);
+	AtomicStoreRel64(&q->a_top, 0);
+	AtomicStoreRel64(&q->a_bottom, 0);
+
+	return q;
+}
+
+void DequeWsFree(struct dequeWs *q)
+{
+	for (u32 i = 1; i < q->buffer_count; ++i)
+	{
+		if (q->buffer[i].block)
+		{
+			ThreadFree1MB(q->buffer[i].entries);
+		}
+		else
+		{
+			ds_Free(&q->buffer[i].slot);
+		}
+	}
+
+	q->buffer_count = 1;
+	AtomicStoreRel64(&q->a_buffer, q->buffer + 0);
+}
+
+/* owner: move entries [t, b) into a buffer of at least twice the size, returns NULL on out-of-memory */
+static struct dequeWsBuffer *DequeWsGrow(struct dequeWs *q, const struct dequeWsBuffer *old, const u64 t, const u64 b)
+{
+	if (q->buffer_count == DEQUE_WS_BUFFER_MAX)
+	{
+		return NULL;
+	}
+
+	struct dequeWsBuffer *buf = q->buffer + q->buffer_count;
+	u64 size = 2*(old->mask + 1)*sizeof(void *);
+	buf->block = 0;
+	buf->entries = NULL;
+	if (size <= DEQUE_WS_BLOCK_SIZE)
+	{
+		size = DEQUE_WS_BLOCK_SIZE;
+		buf->entries = ThreadAlloc1MB();
+		buf->block = (buf->entries != NULL);
+	}
+
+	if (!buf->entries)
+	{
+		buf->entries = ds_Alloc(&buf->slot, size, NO_HUGE_PAGES);
+		if (!buf->entries)
+		{
+			return NULL;
+		}
+	}
+
+	buf->mask = size / sizeof(void *) - 1;
+	for (u64 i = t; i < b; ++i)
+	{
+		buf->entries[i & buf->mask] = (void *) AtomicLoadRlx64(old->entries + (i & old->mask));
+	}
+
+	q->buffer_count += 1;
+	/* a thief acquiring a_bottom after our next push sees the new buffer */
+	AtomicStoreRel64(&q->a_buffer, buf);
+	return buf;
+}
+
+u32 DequeWsPush(struct dequeWs *q, void *data)
+{
+	const u64 b = AtomicLoadRlx64(&q->a_bottom);
+	const u64 t = AtomicLoadAcq64(&q->a_top);
+	struct dequeWsBuffer *buf = (struct dequeWsBuffer *) AtomicLoadRlx64(&q->a_buffer);
+	if (b - t > buf->mask)
+	{
+		buf = DequeWsGrow(q, buf, t, b);
+		if (!buf)
+		{
+			return 0;
+		}
+	}
+
+	AtomicStoreRlx64(buf->entries + (b & buf->mask), data);
+	/* release the entry (and everything the task refers to) to any thief acquiring a_bottom */
+	AtomicStoreRel64(&q->a_bottom, b + 1);
+
+	if (b + 1 - t > AtomicLoadRlx64(&q->a_peak))
+	{
+		AtomicStoreRlx64(&q->a_peak, b + 1 - t);
+	}
+	return 1;
+}
+
+void *DequeWsPop(struct dequeWs *q)
+{
+	const struct dequeWsBuffer *buf = (struct dequeWsBuffer *) AtomicLoadRlx64(&q->a_buffer);
+	const u64 b = AtomicLoadRlx64(&q->a_bottom) - 1;
+	/* 
+	 * Reserve the bottom entry before reading a_top; the sequentially consistent store and load 
+	 * guarantee that we and a concurrent thief cannot both miss each other's reservation. 
+	 */
+	AtomicStoreSeqCst64(&q->a_bottom, b);
+	u64 t = AtomicLoadSeqCst64(&q->a_top);
+
+	void *data = NULL;
+	if ((i64) (b - t) >= 0)
+	{
+		data = (void *) AtomicLoadRlx64(buf->entries + (b & buf->mask));
+		if (b == t)
+		{
+			/* last entry, race any thieves for it */
+			if (!AtomicCompareExchangeSeqCst64(&q->a_top, &t, t + 1))
+			{
+				data = NULL;
+			}
+			AtomicStoreRlx64(&q->a_bottom, b + 1);
+		}
+	}
+	else
+	{
+		AtomicStoreRlx64(&q->a_bottom, b + 1);
+	}
+
+	return data;
+}
+
+void *DequeWsSteal(struct dequeWs *q)
+{
+	u64 t = AtomicLoadSeqCst64(&q->a_top);
+	const u64 b = AtomicLoadSeqCst64(&q->a_bottom);
+
+	void *data = NULL;
+	if ((i64) (b - t) > 0)
+	{
+		/* the buffer is read after a_bottom, so it holds entry t; replaced buffers stay valid */
+		const struct dequeWsBuffer *buf = (struct dequeWsBuffer *) AtomicLoadAcq64(&q->a_buffer);
+		data = (void *) AtomicLoadRlx64(buf->entries + (t & buf->mask));
+		if (!AtomicCompareExchangeSeqCst64(&q->a_top, &t, t + 1))
+		{
+			data = NULL;
+		}
+	}
+
+	return data;
+}
+
+void *DequeWsPeek(const struct dequeWs *q)
+{
+	const u64 t = AtomicLoadSeqCst64(&q->a_top);
+	const u64 b = AtomicLoadSeqCst64(&q->a_bottom);
+	if ((i64) (b - t) <= 0)
+	{
+		return NULL;
+	}
+
+	const struct dequeWsBuffer *buf = (struct dequeWsBuffer *) AtomicLoadAcq64(&q->a_buffer);
+	return (void *) AtomicLoadRlx64(buf->entries + (t & buf->mask));
+}
+
+u32 DequeWsCount(const struct dequeWs *q)
+{
+	const u64 t = AtomicLoadAcq64(&q->a_top);
+	const u64 b = AtomicLoadAcq64(&q->a_bottom);
+	return ((i64) (b - t) > 0) ? (u32) (b - t) : 0;
+}
+
+u64 DequeWsPeak(const struct dequeWs *q)
+{
+	return AtomicLoadRlx64(&q->a_peak);
+}
+
+u64 DequeWsCapacity(const struct dequeWs *q)
+{
+	const struct dequeWsBuffer *buf = (struct dequeWsBuffer *) AtomicLoadAcq64(&q->a_buffer);
+	return buf->mask + 1;
+}
@@ -1534,30 +1534,14 @@ static void led_ColorIsland(struct led *led, const u32 island, const vec4 color)
 
 static void led_EngineRun(struct led *led)
 {
+	/* The physics frames launched in the last call ran while the previous frame was built and rendered */
+	PhysicsPipelineFence(&led->physics);
+
 	led->physics.ns_elapsed += led->ns_delta;
 
 	//const u64 game_frames_to_run = (game->ns_elapsed - (game->frames_completed * game->ns_tick)) / game->ns_tick;
 	const u64 physics_frames_to_run = (led->physics.ns_elapsed - (led->physics.frames_completed * led->physics.ns_tick)) / led->physics.ns_tick;
 
-	//u64 ns_next_game_frame = game->frames_completed * game->ns_tick;
-	u64 ns_next_physics_frame = (led->physics.frames_completed+1) * led->physics.ns_tick;
-
-	for (u64 i = 0; i < /* game_frames_to_run + */ physics_frames_to_run; ++i)
-	{
-		//if (ns_next_game_frame <= ns_next_physics_frame)
-		//{
-		//	ArenaFlush(&game->frame);
-		//	game_tick(game);
-		//	game->frames_completed += 1;
-		//	ns_next_game_frame += game->ns_tick;
-		//}
-		//else
-		//{
-			PhysicsPipelineTick(&led->physics);
-			ns_next_physics_frame += led->physics.ns_tick;
-		//}
-	}
-
 	if (led->pending_body_color_mode != led->body_color_mode)
 	{
 		switch (led->pending_body_color_mode)
@@ -1637,11 +1621,11 @@ static void led_EngineRun(struct led *led)
 	}
 	led->body_color_mode = led->pending_body_color_mode;
 
-	struct physicsEvent *event = NULL;
-	for (u32 i = led->physics.event_list.first; i != DLL_NULL; )
+	/* Events may read pipeline state, so they are processed before the next physics frames are launched */
+	const struct ds_PhysicsSnapshot *snapshot = PhysicsPipelineSnapshot(&led->physics);
+	for (u32 i = 0; i < snapshot->event_count; ++i)
 	{
-		event = ds_PoolAddress(&led->physics.event_pool, i);
-		const u32 next = dll_Next(event);
+		const struct physicsEvent *event = snapshot->events + i;
 		switch (event->type)
 		{
 			case PHYSICS_EVENT_CONTACT_NEW:
@@ -1771,31 +1755,39 @@ static void led_EngineRun(struct led *led)
 
 			case PHYSICS_EVENT_BODY_ORIENTATION:
 			{
-				const struct ds_RigidBody *body = ds_PoolAddress(&led->physics.body_pool, event->body);
-				const struct led_Node *node = hi_Address(&led->node_hierarchy, body->entity);
-
-				vec3 linear_velocity;
-				Vec3Scale(linear_velocity, body->linear_momentum, 1.0f / body->mass);
-                
-				r_Proxy3dLinearSpeculationSet(body->t_world.position
-						, body->t_world.rotation
-						, linear_velocity
-						, body->angular_velocity
-						, event->ns
-						, node->proxy);
+				/* stored as body snapshots */
 			} break;
 		}
-		ds_PoolRemove(&led->physics.event_pool, i);
-		i = next;
 	}
-	
-	dll_Flush(&led->physics.event_list);
+
+	PhysicsPipelineTickAsync(&led->physics, physics_frames_to_run);
+
+	/* Body snapshots are self-contained and are consumed while the physics frames run */
+	for (u32 i = 0; i < snapshot->body_count; ++i)
+	{
+		const struct ds_BodySnapshot *body = snapshot->bodies + i;
+		const struct led_Node *node = hi_Address(&led->node_hierarchy, body->entity);
+		r_Proxy3dLinearSpeculationSet(body->position
+				, body->rotation
+				, body->linear_velocity
+				, body->angular_velocity
+				, body->ns
+				, node->proxy);
+	}
+	PhysicsPipelineSnapshotRelease(&led->physics);
+
+	/* Debug drawing reads pipeline state */
+	if (led->draw_bounding_box || led->draw_dbvh || led->draw_sbvh || led->draw_manifold || led->draw_lines)
+	{
+		PhysicsPipelineFence(&led->physics);
+	}
 
     //PhysicsPipelinePrintUsage(&led->physics);
 }
 
 static void led_EngineFlush(struct led *led)
 {
+	PhysicsPipelineFence(&led->physics);
 	PhysicsPipelineFlush(&led->physics);
     ArenaPushRecord(&led->frame);
 	struct hi_Iterator it = hi_IteratorAlloc(&led->frame, &led->node_hierarchy, LED_NODE_ROOT);
@@ -1827,6 +1819,7 @@ static void led_EngineFlush(struct led *led)
 static void led_EngineInit(struct led *led)
 {
 	//TODO move this into engine flush
+	PhysicsPipelineFence(&led->physics);
 	PhysicsPipelineFlush(&led->physics);		
 	led->physics.ns_start = led->ns;
 	led->physics.ns_elapsed = -led->ns_delta;
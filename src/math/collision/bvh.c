@@ -34,7 +34,8 @@ struct bvh DbvhAlloc(struct arena *mem, const u32 initial_length, const u32 grow
 	struct bvh bvh =
 	{
 		.tree = bt_Alloc(mem, initial_length, struct bvhNode, growable),
-		.cost_queue = MinQueueAlloc(NULL, COST_QUEUE_INITIAL_COUNT, growable),
+		/* the cost queue can never hold more than every node of the tree */
+		.cost_queue = MinQueueAlloc(NULL, (growable) ? COST_QUEUE_INITIAL_COUNT : initial_length, growable),
 		.heap_allocated = !mem,	
 	};
 
@@ -155,11 +156,13 @@ static void DbvhInternalBalanceNode(struct bvh *bvh, const u32 node)
 			if (best_rotation == nodes[right].bt_left)
 			{
 				nodes[right].bbox = BboxUnion(nodes[nodes[right].bt_right].bbox, nodes[upper_rotation].bbox);
+				nodes[right].asleep = nodes[nodes[right].bt_right].asleep & nodes[upper_rotation].asleep;
 				nodes[right].bt_left = upper_rotation;
 			}
 			else
 			{
 				nodes[right].bbox = BboxUnion(nodes[nodes[right].bt_left].bbox, nodes[upper_rotation].bbox);
+				nodes[right].asleep = nodes[nodes[right].bt_left].asleep & nodes[upper_rotation].asleep;
 				nodes[right].bt_right = upper_rotation;
 			}
 			left = best_rotation;
@@ -171,11 +174,13 @@ static void DbvhInternalBalanceNode(struct bvh *bvh, const u32 node)
 			if (best_rotation == nodes[left].bt_left)
 			{
 				nodes[left].bbox = BboxUnion(nodes[nodes[left].bt_right].bbox, nodes[upper_rotation].bbox);
+				nodes[left].asleep = nodes[nodes[left].bt_right].asleep & nodes[upper_rotation].asleep;
 				nodes[left].bt_left = upper_rotation;
 			}
 			else
 			{
 				nodes[left].bbox = BboxUnion(nodes[nodes[left].bt_left].bbox, nodes[upper_rotation].bbox);
+				nodes[left].asleep = nodes[nodes[left].bt_left].asleep & nodes[upper_rotation].asleep;
 				nodes[left].bt_right = upper_rotation;
 			}
 			right = best_rotation;
@@ -184,114 +189,334 @@ static void DbvhInternalBalanceNode(struct bvh *bvh, const u32 node)
 
 	/* (3) refit node's box */
 	nodes[node].bbox = BboxUnion(nodes[left].bbox, nodes[right].bbox);
+	nodes[node].asleep = nodes[left].asleep & nodes[right].asleep;
 }
 
-u32 DbvhInsert(struct bvh *bvh, const u32 id, const struct aabb *bbox)
+/*
+ * Graft the detached subtree into the hierarchy. The new node internal becomes the parent of the subtree and
+ * of its best sibling, after which all ancestors are refit and rotated up to the root.
+ */
+static void DbvhInternalGraft(struct bvh *bvh, const u32 subtree, const u32 internal)
 {
 	struct bvhNode *nodes = (struct bvhNode *) bvh->tree.pool.buf;
+	nodes[subtree].bt_parent = (nodes[subtree].bt_parent & BT_PARENT_LEAF_MASK) | internal;
+
+	/**
+	 * (1) Find best sibling using the minimum surface area hueristic + branch and bound algorithm.
+	 * The idea is that every node in the hierarchy is a potential sibling to the new node, and we find
+	 * the best suitable one by continuously delve deeper into the hierarchy as long as the some 
+	 * new potential node gives a better cost than previous ones. We keep track of the best score and 
+	 * the node achieving it. When no node achieves a better score, we are done and set the best scoring
+	 * one as the sibling.
+	 */
+	u32 best_index = bvh->tree.root;
+	f32 best_cost = F32_INFINITY;
+	f32 node_cost = 0.0f; 
+
+	MinQueuePush(&bvh->cost_queue, node_cost, bvh->tree.root);
+
+	u32 node;
+	f32 inherited_cost, cost;
+
+	while (bvh->cost_queue.object_pool.count > 0)
+	{
+		/* (i) Get cost of node */
+		inherited_cost = bvh->cost_queue.elements[0].priority; 
+		node = MinQueuePop(&bvh->cost_queue);
+		const struct aabb box_union = BboxUnion(nodes[subtree].bbox, nodes[node].bbox);
+		/* Inherited area cost + expanded node area cost */
+		cost = inherited_cost + BodySah(&box_union);
+
+		if (cost < best_cost)
+		{
+			best_cost = cost;
+			best_index = node;
+		}
+
+		/**
+		 * The current difference in area produced by the node's path + the new box's area
+		 * is a lower bound on the node's descendants' cost. If the lower bound is not less
+		 * than the best cost, we can prune the children's trees. Otherwise, we must still
+		 * consider them as viable siblings. Their priorities become the increase in cost 
+		 * to node's path when adding the new box (the inherited cost).
+		 */
+		cost -= BodySah(&nodes[node].bbox);
+
+		if (!bt_LeafCheck(nodes + node) && cost + BodySah(&nodes[subtree].bbox) < best_cost)
+		{
+			MinQueuePush(&bvh->cost_queue, cost, nodes[node].bt_left);
+			MinQueuePush(&bvh->cost_queue, cost, nodes[node].bt_right);
+		}
+	}
+
+	/* (2) Setup a new parent node for the new node and its sibling */
+	const u32 best_parent = nodes[best_index].bt_parent & BT_PARENT_INDEX_MASK;
+	if (bt_RootCheck(nodes + best_index))
+	{
+		bvh->tree.root = internal;
+	}
+	else
+	{
+		if (nodes[best_parent].bt_left == best_index)
+		{
+			nodes[best_parent].bt_left = internal;
+		}
+		else
+		{
+			nodes[best_parent].bt_right = internal;
+		}
+	}
+
+	nodes[internal].bt_parent = best_parent;
+	nodes[internal].bt_left = best_index;
+	nodes[internal].bt_right = subtree;
+	nodes[internal].bbox = BboxUnion(nodes[subtree].bbox, nodes[best_index].bbox);
+	nodes[internal].asleep = nodes[subtree].asleep & nodes[best_index].asleep;
+	nodes[best_index].bt_parent = (nodes[best_index].bt_parent & BT_PARENT_LEAF_MASK) | internal;
+
+	node = nodes[internal].bt_parent;
+	/* (3) Traverse from grandparent of leaf, refitting and rotating node up to the root */
+	while (node != BT_PARENT_INDEX_MASK)
+	{
+		DbvhInternalBalanceNode(bvh, node);
+		node = nodes[node].bt_parent;
+	}
+}
+
+u32 DbvhInsert(struct bvh *bvh, const u32 id, const struct aabb *bbox)
+{
 	struct slot leaf;
 	if (bvh->tree.root == BT_PARENT_INDEX_MASK)
 	{
 		leaf = bt_NodeAddRoot(&bvh->tree);
+		struct bvhNode *nodes = (struct bvhNode *) bvh->tree.pool.buf;
 		bt_LeafSet(nodes + leaf.index);
 		/* Store external id's in bt_left of leaves */
 		nodes[leaf.index].bt_left = id;
 		nodes[leaf.index].bbox = *bbox;
+		nodes[leaf.index].asleep = 0;
 	}
 	else
 	{
 		struct slot internal = bt_NodeAdd(&bvh->tree);
 		leaf = bt_NodeAdd(&bvh->tree);
+		struct bvhNode *nodes = (struct bvhNode *) bvh->tree.pool.buf;
 		nodes[leaf.index].bbox = *bbox;
-		nodes[leaf.index].bt_parent = BT_PARENT_LEAF_MASK | internal.index;
+		nodes[leaf.index].bt_parent = BT_PARENT_LEAF_MASK;
 		nodes[leaf.index].bt_left = id;
+		nodes[leaf.index].asleep = 0;
+		DbvhInternalGraft(bvh, leaf.index, internal.index);
+	}
 
-		/**
-		 * (1) Find best sibling using the minimum surface area hueristic + branch and bound algorithm.
-		 * The idea is that every node in the hierarchy is a potential sibling to the new node, and we find
-		 * the best suitable one by continuously delve deeper into the hierarchy as long as the some 
-		 * new potential node gives a better cost than previous ones. We keep track of the best score and 
-		 * the node achieving it. When no node achieves a better score, we are done and set the best scoring
-		 * one as the sibling.
-		 */
-		u32 best_index = bvh->tree.root;
-		f32 best_cost = F32_INFINITY;
-		f32 node_cost = 0.0f; 
-	
-		MinQueuePush(&bvh->cost_queue, node_cost, bvh->tree.root);
+	//struct arena tmp = ArenaAlloc1MB();
+	//BvhValidate(&tmp, bvh);
+	//ArenaFree1MB(&tmp);
 
-		u32 node;
-		f32 inherited_cost, cost;
-	
-		while (bvh->cost_queue.object_pool.count > 0)
-		{
-			/* (i) Get cost of node */
-			inherited_cost = bvh->cost_queue.elements[0].priority; 
-			node = MinQueuePop(&bvh->cost_queue);
-			const struct aabb box_union = BboxUnion(nodes[leaf.index].bbox, nodes[node].bbox);
-			/* Inherited area cost + expanded node area cost */
-			cost = inherited_cost + BodySah(&box_union);
+	return leaf.index;
+}
 
-			if (cost < best_cost)
-			{
-				best_cost = cost;
-				best_index = node;
-			}
+#define DBVH_BATCH_BIN_COUNT	16
+
+struct dbvhBuildRange
+{
+	u32	node;
+	u32	first;
+	u32	count;
+};
 
-			/**
-			 * The current difference in area produced by the node's path + the new box's area
-			 * is a lower bound on the node's descendants' cost. If the lower bound is not less
-			 * than the best cost, we can prune the children's trees. Otherwise, we must still
-			 * consider them as viable siblings. Their priorities become the increase in cost 
-			 * to node's path when adding the new box (the inherited cost).
-			 */
-			cost -= BodySah(&nodes[node].bbox);
+void DbvhInsertBatch(struct arena *tmp, struct bvh *bvh, u32 *index, const u32 *id, const struct aabb *bbox, const u32 *asleep, const u32 count)
+{
+	if (count == 0)
+	{
+		return;
+	}
 
-			if (!bt_LeafCheck(nodes + node) && cost + BodySah(&nodes[leaf.index].bbox) < best_cost)
+	ProfZone;
+	ArenaPushRecord(tmp);
+
+	/* a subtree of count leaves has 2*count - 1 nodes, and grafting it requires one more */
+	if (!ds_PoolReserve(&bvh->tree.pool, bvh->tree.pool.count + 2*count))
+	{
+		LogString(T_PHYSICS, S_FATAL, "Bvh node pool too small for batch insertion, exiting.");
+		FatalCleanupAndExit();
+	}
+
+	u32 *item = ArenaPush(tmp, count*sizeof(u32));
+	u32 *internal = ArenaPush(tmp, count*sizeof(u32));
+	u8 *item_bin = ArenaPush(tmp, count*sizeof(u8));
+	struct dbvhBuildRange *stack = ArenaPush(tmp, count*sizeof(struct dbvhBuildRange));
+	if (!item || !internal || !item_bin || !stack)
+	{
+		LogString(T_PHYSICS, S_FATAL, "Arena OOM in DbvhInsertBatch, increase size!");
+		FatalCleanupAndExit();
+	}
+
+	for (u32 i = 0; i < count; ++i)
+	{
+		item[i] = i;
+	}
+
+	u32 internal_count = 0;
+	const u32 subtree = bt_NodeAdd(&bvh->tree).index;
+	struct bvhNode *nodes = (struct bvhNode *) bvh->tree.pool.buf;
+	nodes[subtree].bt_parent = BT_PARENT_LEAF_MASK | BT_PARENT_INDEX_MASK;
+
+	/*
+	 * Top-down binned SAH build over the leaves' centroids. Every range is either made into a leaf, or split
+	 * into two non-empty ranges along the best bin plane of the three axes; if the centroids are too close to
+	 * separate, the range is split at its middle.
+	 */
+	u32 sc = 1;
+	stack[0] = (struct dbvhBuildRange) { .node = subtree, .first = 0, .count = count };
+	while (sc--)
+	{
+		const struct dbvhBuildRange range = stack[sc];
+		struct bvhNode *node = nodes + range.node;
+		node->bbox = bbox[item[range.first]];
+		vec3 centroid_min, centroid_max;
+		Vec3Copy(centroid_min, node->bbox.center);
+		Vec3Copy(centroid_max, node->bbox.center);
+		for (u32 i = range.first + 1; i < range.first + range.count; ++i)
+		{
+			const struct aabb *box = bbox + item[i];
+			node->bbox = BboxUnion(node->bbox, *box);
+			for (u32 axis = 0; axis < 3; ++axis)
 			{
-				MinQueuePush(&bvh->cost_queue, cost, nodes[node].bt_left);
-				MinQueuePush(&bvh->cost_queue, cost, nodes[node].bt_right);
+				centroid_min[axis] = f32_min(centroid_min[axis], box->center[axis]);
+				centroid_max[axis] = f32_max(centroid_max[axis], box->center[axis]);
 			}
 		}
 
-		/* (2) Setup a new parent node for the new node and its sibling */
-		const u32 best_parent = nodes[best_index].bt_parent & BT_PARENT_INDEX_MASK;
-		if (bt_RootCheck(nodes + best_index))
+		if (range.count == 1)
 		{
-			bvh->tree.root = internal.index;
+			bt_LeafSet(node);
+			node->bt_left = id[item[range.first]];
+			node->asleep = (asleep) ? asleep[item[range.first]] : 0;
+			index[item[range.first]] = range.node;
+			continue;
 		}
-		else
+
+		u32 best_axis = U32_MAX;
+		u32 best_split = 0;
+		f32 best_score = F32_INFINITY;
+		for (u32 axis = 0; axis < 3; ++axis)
 		{
-			if (nodes[best_parent].bt_left == best_index)
+			const f32 extent = centroid_max[axis] - centroid_min[axis];
+			if (extent <= F32_EPSILON)
 			{
-				nodes[best_parent].bt_left = internal.index;
+				continue;
 			}
-			else
+
+			struct aabb bin_bbox[DBVH_BATCH_BIN_COUNT];
+			u32 bin_count[DBVH_BATCH_BIN_COUNT] = { 0 };
+			for (u32 i = range.first; i < range.first + range.count; ++i)
 			{
-				nodes[best_parent].bt_right = internal.index;
+				const struct aabb *box = bbox + item[i];
+				const f32 val = DBVH_BATCH_BIN_COUNT * (box->center[axis] - centroid_min[axis]) / extent;
+				const u32 bi = (u32) f32_clamp(val, 0.0f, DBVH_BATCH_BIN_COUNT - 0.01f);
+				bin_bbox[bi] = (bin_count[bi]) 
+					? BboxUnion(bin_bbox[bi], *box)
+					: *box;
+				bin_count[bi] += 1;
 			}
-		}
 
-		nodes[internal.index].bt_parent = best_parent;
-		nodes[internal.index].bt_left = best_index;
-		nodes[internal.index].bt_right = leaf.index;
-		nodes[internal.index].bbox = BboxUnion(nodes[leaf.index].bbox, nodes[best_index].bbox);
-		nodes[best_index].bt_parent = (nodes[best_index].bt_parent & BT_PARENT_LEAF_MASK) | internal.index;
+			/* sweep from the right to get the SAH of every right side, then from the left to score each plane */
+			f32 right_sah[DBVH_BATCH_BIN_COUNT];
+			u32 right_count[DBVH_BATCH_BIN_COUNT];
+			struct aabb bbox_right;
+			u32 count_right = 0;
+			for (u32 bi = DBVH_BATCH_BIN_COUNT-1; bi > 0; --bi)
+			{
+				if (bin_count[bi])
+				{
+					bbox_right = (count_right) 
+						? BboxUnion(bbox_right, bin_bbox[bi])
+						: bin_bbox[bi];
+					count_right += bin_count[bi];
+				}
+				right_sah[bi] = (count_right) ? BodySah(&bbox_right) : 0.0f;
+				right_count[bi] = count_right;
+			}
+
+			struct aabb bbox_left;
+			u32 count_left = 0;
+			for (u32 split = 0; split < DBVH_BATCH_BIN_COUNT-1; ++split)
+			{
+				if (bin_count[split])
+				{
+					bbox_left = (count_left) 
+						? BboxUnion(bbox_left, bin_bbox[split])
+						: bin_bbox[split];
+					count_left += bin_count[split];
+				}
+
+				if (count_left == 0 || right_count[split+1] == 0)
+				{
+					continue;
+				}
 
-		node = nodes[internal.index].bt_parent;
-		/* (3) Traverse from grandparent of leaf, refitting and rotating node up to the root */
-		while (node != BT_PARENT_INDEX_MASK)
+				const f32 score = count_left*BodySah(&bbox_left) + right_count[split+1]*right_sah[split+1];
+				if (score < best_score)
+				{
+					best_score = score;
+					best_axis = axis;
+					best_split = split;
+				}
+			}
+		}
+
+		u32 count_left = range.count / 2;
+		if (best_axis != U32_MAX)
 		{
-			DbvhInternalBalanceNode(bvh, node);
-			node = nodes[node].bt_parent;
+			const f32 extent = centroid_max[best_axis] - centroid_min[best_axis];
+			u32 left = range.first;
+			u32 right = range.first + range.count - 1;
+			while (left <= right)
+			{
+				const f32 val = DBVH_BATCH_BIN_COUNT * (bbox[item[left]].center[best_axis] - centroid_min[best_axis]) / extent;
+				if ((u32) f32_clamp(val, 0.0f, DBVH_BATCH_BIN_COUNT - 0.01f) <= best_split)
+				{
+					left += 1;
+				}
+				else
+				{
+					const u32 tmp_item = item[left];
+					item[left] = item[right];
+					item[right] = tmp_item;
+					right -= 1;
+				}
+			}
+			count_left = left - range.first;
 		}
+		ds_Assert(0 < count_left && count_left < range.count);
+
+		struct slot slot_left, slot_right;
+		bt_NodeAddChildren(&bvh->tree, &slot_left, &slot_right, range.node);
+		ds_Assert(slot_left.address && slot_right.address);
+		internal[internal_count++] = range.node;
+
+		stack[sc++] = (struct dbvhBuildRange) { .node = slot_right.index, .first = range.first + count_left, .count = range.count - count_left };
+		stack[sc++] = (struct dbvhBuildRange) { .node = slot_left.index, .first = range.first, .count = count_left };
 	}
 
-	//struct arena tmp = ArenaAlloc1MB();
-	//BvhValidate(&tmp, bvh);
-	//ArenaFree1MB(&tmp);
+	/* internal nodes were created before their children, so walking them backwards sets children first */
+	for (u32 i = internal_count; i > 0; --i)
+	{
+		struct bvhNode *node = nodes + internal[i-1];
+		node->asleep = nodes[node->bt_left].asleep & nodes[node->bt_right].asleep;
+	}
 
-	return leaf.index;
+	if (bvh->tree.root == BT_PARENT_INDEX_MASK)
+	{
+		bvh->tree.root = subtree;
+	}
+	else
+	{
+		DbvhInternalGraft(bvh, subtree, bt_NodeAdd(&bvh->tree).index);
+	}
+
+	ArenaPopRecord(tmp);
+	ProfZoneEnd;
 }
 
 void DbvhRemove(struct bvh *bvh, const u32 index)
@@ -334,6 +559,7 @@ void DbvhRemove(struct bvh *bvh, const u32 index)
 			}
 
 			nodes[grand_parent].bbox = BboxUnion(nodes[nodes[grand_parent].bt_left].bbox, nodes[nodes[grand_parent].bt_right].bbox);
+			nodes[grand_parent].asleep = nodes[nodes[grand_parent].bt_left].asleep & nodes[nodes[grand_parent].bt_right].asleep;
 			parent = nodes[grand_parent].bt_parent;
 			while (parent != BT_PARENT_INDEX_MASK)
 			{
@@ -348,6 +574,139 @@ void DbvhRemove(struct bvh *bvh, const u32 index)
 	//ArenaFree1MB(&tmp);
 }
 
+void DbvhRemoveBatch(struct arena *tmp, struct bvh *bvh, const u32 *index, const u32 count)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	ProfZone;
+	ArenaPushRecord(tmp);
+
+	struct bvhNode *nodes = (struct bvhNode *) bvh->tree.pool.buf;
+	u32 *refit = ArenaPush(tmp, count*sizeof(u32));
+	u8 *dirty = ArenaPush(tmp, bvh->tree.pool.count_max*sizeof(u8));
+	u32 *stack = ArenaPush(tmp, bvh->tree.pool.count_max*sizeof(u32));
+	if (!refit || !dirty || !stack)
+	{
+		LogString(T_PHYSICS, S_FATAL, "Arena OOM in DbvhRemoveBatch, increase size!");
+		FatalCleanupAndExit();
+	}
+	memset(dirty, 0, bvh->tree.pool.count_max*sizeof(u8));
+
+	/* (1) unlink every leaf by replacing its parent with its sibling, deferring any refitting */
+	u32 refit_count = 0;
+	for (u32 i = 0; i < count; ++i)
+	{
+		ds_Assert(bt_LeafCheck(nodes + index[i]));
+		const u32 parent = nodes[index[i]].bt_parent & BT_PARENT_INDEX_MASK;
+		if (parent == BT_PARENT_INDEX_MASK)
+		{
+			bvh->tree.root = BT_PARENT_INDEX_MASK;
+			bt_NodeRemove(&bvh->tree, index[i]);
+			continue;
+		}
+
+		const u32 sibling = (nodes[parent].bt_left == index[i])
+			? nodes[parent].bt_right
+			: nodes[parent].bt_left;
+
+		const u32 grand_parent = nodes[parent].bt_parent;
+		nodes[sibling].bt_parent = (nodes[sibling].bt_parent & BT_PARENT_LEAF_MASK) | grand_parent;
+
+		bt_NodeRemove(&bvh->tree, parent);
+		bt_NodeRemove(&bvh->tree, index[i]);
+
+		if (grand_parent == BT_PARENT_INDEX_MASK)
+		{
+			bvh->tree.root = sibling;
+		}
+		else
+		{
+			if (nodes[grand_parent].bt_left == parent)
+			{
+				nodes[grand_parent].bt_left = sibling;
+			}
+			else
+			{
+				nodes[grand_parent].bt_right = sibling;
+			}
+			refit[refit_count++] = grand_parent;
+		}
+	}
+
+	/* (2) mark the surviving grandparents and their ancestors; a grandparent may since have been removed */
+	for (u32 i = 0; i < refit_count; ++i)
+	{
+		u32 node = refit[i];
+		if (!PoolSlotAllocated(nodes + node))
+		{
+			continue;
+		}
+
+		while (node != BT_PARENT_INDEX_MASK && !dirty[node])
+		{
+			dirty[node] = 1;
+			node = nodes[node].bt_parent & BT_PARENT_INDEX_MASK;
+		}
+	}
+
+	/* (3) refit marked nodes in post-order, so children are refit before their parents */
+	u32 sc = 0;
+	if (bvh->tree.root != BT_PARENT_INDEX_MASK && dirty[bvh->tree.root])
+	{
+		stack[sc++] = bvh->tree.root;
+	}
+
+	while (sc)
+	{
+		const u32 node = stack[sc-1];
+		const u32 left = nodes[node].bt_left;
+		const u32 right = nodes[node].bt_right;
+		if (dirty[node] == 1)
+		{
+			dirty[node] = 2;
+			if (dirty[left] == 1)
+			{
+				stack[sc++] = left;
+			}
+			if (dirty[right] == 1)
+			{
+				stack[sc++] = right;
+			}
+		}
+		else
+		{
+			sc -= 1;
+			nodes[node].bbox = BboxUnion(nodes[left].bbox, nodes[right].bbox);
+			nodes[node].asleep = nodes[left].asleep & nodes[right].asleep;
+		}
+	}
+
+	ArenaPopRecord(tmp);
+	ProfZoneEnd;
+}
+
+void DbvhSetAsleep(struct bvh *bvh, const u32 index, const u32 asleep)
+{
+	struct bvhNode *nodes = (struct bvhNode *) bvh->tree.pool.buf;
+	ds_Assert(bt_LeafCheck(nodes + index));
+
+	nodes[index].asleep = asleep;
+	u32 node = nodes[index].bt_parent & BT_PARENT_INDEX_MASK;
+	while (node != BT_PARENT_INDEX_MASK)
+	{
+		const u32 node_asleep = nodes[nodes[node].bt_left].asleep & nodes[nodes[node].bt_right].asleep;
+		if (nodes[node].asleep == node_asleep)
+		{
+			break;
+		}
+		nodes[node].asleep = node_asleep;
+		node = nodes[node].bt_parent;
+	}
+}
+
 u32 DbvhInternalPushSubtreeOverlapPairs(struct arena *mem, struct dbvhOverlap *stack, const u64 stack_len, const struct bvh *bvh, u32 subA, u32 subB)
 {
 	struct bvhNode *nodes = (struct bvhNode *) bvh->tree.pool.buf;
@@ -357,7 +716,8 @@ u32 DbvhInternalPushSubtreeOverlapPairs(struct arena *mem, struct dbvhOverlap *s
 
 	while (1)
 	{
-		if (AabbTest(&nodes[subA].bbox, &nodes[subB].bbox))
+		/* sleeping proxies never start overlapping each other */
+		if (!(nodes[subA].asleep & nodes[subB].asleep) && AabbTest(&nodes[subA].bbox, &nodes[subB].bbox))
 		{
 			if (bt_LeafCheck(nodes + subA) && bt_LeafCheck(nodes + subB))
 			{
@@ -438,7 +798,7 @@ struct dbvhOverlap *DbvhPushOverlapPairs(struct arena *mem, u32 *count, const st
 	{
 		*count += DbvhInternalPushSubtreeOverlapPairs(mem, stack2, arr2.len, bvh, a, b);
 
-		if (!bt_LeafCheck(nodes + a))
+		if (!bt_LeafCheck(nodes + a) && !nodes[a].asleep)
 		{
 			stack1[++q].id1 = nodes[a].bt_left;
 			stack1[q].id2 = nodes[a].bt_right;	
@@ -449,7 +809,7 @@ struct dbvhOverlap *DbvhPushOverlapPairs(struct arena *mem, u32 *count, const st
 			}
 		}
 
-		if (!bt_LeafCheck(nodes + b))
+		if (!bt_LeafCheck(nodes + b) && !nodes[b].asleep)
 		{
 			 a = nodes[b].bt_left;	
 			 b = nodes[b].bt_right;	
@@ -39,6 +39,14 @@ u32 ds_ContactKeyEquivalence(const struct ds_ContactKey *keyA, const struct ds_C
     return memcmp(keyA, keyB, sizeof(struct ds_ContactKey)) == 0;
 }
 
+u32 ds_ContactKeyLess(const struct ds_ContactKey *keyA, const struct ds_ContactKey *keyB)
+{
+    if (keyA->body0 != keyB->body0) { return keyA->body0 < keyB->body0; }
+    if (keyA->shape0 != keyB->shape0) { return keyA->shape0 < keyB->shape0; }
+    if (keyA->body1 != keyB->body1) { return keyA->body1 < keyB->body1; }
+    return keyA->shape1 < keyB->shape1;
+}
+
 static u32 cdb_IndexInPreviousConctactNode(struct nll *net, void **prev_node, const void *cur_node, const u32 cur_index)
 {
 	ds_Assert(cur_index <= 1);
@@ -67,19 +75,30 @@ static u32 cdb_IndexInNextConctactNode(struct nll *net, void **next_node, const
 		: 1;
 }
 
-struct cdb *cdb_Alloc(struct arena *mem_persistent, const u32 size)
+struct cdb *cdb_Alloc(struct arena *mem_persistent, const u32 contact_length, const u32 sat_cache_length, const u32 growable)
 {
     /* Note: requires allocation in persistent memory; thread structures initalizes pointers to pool storage... */
 	struct cdb *cdb = ArenaPush(mem_persistent, sizeof(struct cdb));
-	ds_Assert(PowerOfTwoCheck(size));
+	ds_Assert(PowerOfTwoCheck(contact_length));
+	ds_Assert(PowerOfTwoCheck(sat_cache_length));
 
-	sat_CacheTPoolAlloc(&cdb->sat_cache_pool, g_arch_config->logical_core_count, size);
+	sat_CacheTPoolAlloc(&cdb->sat_cache_pool, g_arch_config->logical_core_count, sat_cache_length, growable);
 	cdb->sat_cache_map = sat_CacheTHashMapAlloc(mem_persistent, &cdb->sat_cache_pool, 4096);
 
-	cdb->contact_net = nll_Alloc(NULL, size, struct ds_Contact, cdb_IndexInPreviousConctactNode, cdb_IndexInNextConctactNode, GROWABLE);
-	cdb->contact_map = ds_HashMapAlloc(NULL, size, size, GROWABLE);
-	cdb->contact_persistent_usage = BitVecAlloc(NULL, size, 0, GROWABLE);
-	cdb->sat_cache_persistent_usage = BitVecAlloc(NULL, size, 0, GROWABLE);
+	cdb->contact_net = nll_Alloc(NULL, contact_length, struct ds_Contact, cdb_IndexInPreviousConctactNode, cdb_IndexInNextConctactNode, growable);
+	cdb->contact_map = ds_HashMapAlloc(NULL, contact_length, cdb->contact_net.pool.length, growable);
+
+	/* the lists can never outgrow their pools, so non-growable lists are sized by the actual pool lengths */
+	const u32 contact_list_length = cdb->contact_net.pool.length;
+	const u32 sat_cache_list_length = cdb->sat_cache_pool.a_length;
+	cdb->contact_live = stack_u32Alloc(NULL, contact_list_length, growable);
+	cdb->sat_cache_live = stack_u32Alloc(NULL, sat_cache_list_length, growable);
+	cdb->contact_touched = stack_u32Alloc(NULL, contact_list_length, growable);
+	cdb->sat_cache_touched = stack_u32Alloc(NULL, sat_cache_list_length, growable);
+
+	/* the arena memory is not zeroed, and the first frame reads the frame counters before any clear */
+	cdb->contact_new = NULL;
+	cdb_ClearFrame(cdb);
 
 	return cdb;
 }
@@ -90,8 +109,10 @@ void cdb_Free(struct cdb *cdb)
 	sat_CacheTHashMapDealloc(&cdb->sat_cache_map);
 	nll_Dealloc(&cdb->contact_net);
 	ds_HashMapDealloc(&cdb->contact_map);
-	BitVecFree(&cdb->contact_persistent_usage);
-	BitVecFree(&cdb->sat_cache_persistent_usage);
+	stack_u32Free(&cdb->contact_live);
+	stack_u32Free(&cdb->sat_cache_live);
+	stack_u32Free(&cdb->contact_touched);
+	stack_u32Free(&cdb->sat_cache_touched);
 }
 
 void cdb_Flush(struct cdb *cdb)
@@ -101,103 +122,99 @@ void cdb_Flush(struct cdb *cdb)
 	sat_CacheTHashMapFlush(&cdb->sat_cache_map);
 	nll_Flush(&cdb->contact_net);
 	ds_HashMapFlush(&cdb->contact_map);
-	BitVecClear(&cdb->contact_persistent_usage, 0);
-	BitVecClear(&cdb->sat_cache_persistent_usage, 0);
+	stack_u32Flush(&cdb->contact_live);
+	stack_u32Flush(&cdb->sat_cache_live);
 }
 
 void cdb_Validate(const struct ds_RigidBodyPipeline *pipeline)
 {
-	for (u64 i = 0; i < pipeline->cdb->contact_persistent_usage.bit_count; ++i)
+	/* contact_net reserves slot NLL_NULL */
+	ds_Assert(pipeline->cdb->contact_live.next + 1 == pipeline->cdb->contact_net.pool.count);
+	for (u32 li = 0; li < pipeline->cdb->contact_live.next; ++li)
 	{
-		if (BitVecGetBit(&pipeline->cdb->contact_persistent_usage, i))
+		const u32 i = pipeline->cdb->contact_live.arr[li];
+		const struct ds_Contact *c = nll_Address(&pipeline->cdb->contact_net, i);
+		ds_Assert(PoolSlotAllocated(c));
+
+		//fprintf(stderr, "contact[%lu] (next[0], next[1], prev[0], prev[1]) : (%u,%u,%u,%u)\n",
+		//	       i,
+		//	       c->nll_next[0],	
+		//	       c->nll_next[1],	
+		//	       c->nll_prev[0],	
+		//	       c->nll_prev[1]);
+
+		const struct ds_RigidBody *b0 = ds_PoolAddress(&pipeline->body_pool, c->key.body0);
+		const struct ds_RigidBody *b1 = ds_PoolAddress(&pipeline->body_pool, c->key.body1);
+		const struct ds_Shape *s0 = ds_PoolAddress(&pipeline->shape_pool, c->key.shape0);
+		const struct ds_Shape *s1 = ds_PoolAddress(&pipeline->shape_pool, c->key.shape1);
+
+		u32 prev, k, found; 
+		prev = NLL_NULL;
+		k = s0->contact_first;
+		found = 0;
+		while (k != NLL_NULL)
 		{
-			const struct ds_Contact *c = nll_Address(&pipeline->cdb->contact_net, (u32) i);
-			ds_Assert(PoolSlotAllocated(c));
-
-			//fprintf(stderr, "contact[%lu] (next[0], next[1], prev[0], prev[1]) : (%u,%u,%u,%u)\n",
-			//	       i,
-			//	       c->nll_next[0],	
-			//	       c->nll_next[1],	
-			//	       c->nll_prev[0],	
-			//	       c->nll_prev[1]);
-
-			const struct ds_RigidBody *b0 = ds_PoolAddress(&pipeline->body_pool, c->key.body0);
-			const struct ds_RigidBody *b1 = ds_PoolAddress(&pipeline->body_pool, c->key.body1);
-			const struct ds_Shape *s0 = ds_PoolAddress(&pipeline->shape_pool, c->key.shape0);
-			const struct ds_Shape *s1 = ds_PoolAddress(&pipeline->shape_pool, c->key.shape1);
-
-			u32 prev, k, found; 
-			prev = NLL_NULL;
-			k = s0->contact_first;
-			found = 0;
-			while (k != NLL_NULL)
+			if (k == i)
+			{
+				found = 1;
+				break;
+			}
+
+			const struct ds_Contact *tmp = nll_Address(&pipeline->cdb->contact_net, k);
+			ds_Assert(PoolSlotAllocated(tmp));
+			if (tmp->key.shape0 == c->key.shape0)
+			{
+				ds_Assert(prev == tmp->nll_prev[0]);
+				prev = k;
+				k = tmp->nll_next[0];
+			}
+			else
 			{
-				if (k == i)
-				{
-					found = 1;
-					break;
-				}
-
-				const struct ds_Contact *tmp = nll_Address(&pipeline->cdb->contact_net, k);
-				ds_Assert(PoolSlotAllocated(tmp));
-				if (tmp->key.shape0 == c->key.shape0)
-				{
-					ds_Assert(prev == tmp->nll_prev[0]);
-					prev = k;
-					k = tmp->nll_next[0];
-				}
-				else
-				{
-					ds_Assert(tmp->key.shape1 == c->key.shape0);
-					ds_Assert(prev == tmp->nll_prev[1]);
-					prev = k;
-					k = tmp->nll_next[1];
-				}
+				ds_Assert(tmp->key.shape1 == c->key.shape0);
+				ds_Assert(prev == tmp->nll_prev[1]);
+				prev = k;
+				k = tmp->nll_next[1];
 			}
-			ds_Assert(found);
+		}
+		ds_Assert(found);
  
-			prev = NLL_NULL;
-			k = s1->contact_first;
-			found = 0;
-			while (k != NLL_NULL)
+		prev = NLL_NULL;
+		k = s1->contact_first;
+		found = 0;
+		while (k != NLL_NULL)
+		{
+			if (k == i)
+			{
+				found = 1;
+				break;
+			}
+
+			const struct ds_Contact *tmp = nll_Address(&pipeline->cdb->contact_net, k);
+			ds_Assert(PoolSlotAllocated(tmp));
+			if (tmp->key.shape0 == c->key.shape1)
 			{
-				if (k == i)
-				{
-					found = 1;
-					break;
-				}
-
-				const struct ds_Contact *tmp = nll_Address(&pipeline->cdb->contact_net, k);
-				ds_Assert(PoolSlotAllocated(tmp));
-				if (tmp->key.shape0 == c->key.shape1)
-				{
-					ds_Assert(prev == tmp->nll_prev[0]);
-					prev = k;
-					k = tmp->nll_next[0];
-				}
-				else
-				{
-					ds_Assert(prev == tmp->nll_prev[1]);
-					ds_Assert(tmp->key.shape1 == c->key.shape1);
-					prev = k;
-					k = tmp->nll_next[1];
-				}
+				ds_Assert(prev == tmp->nll_prev[0]);
+				prev = k;
+				k = tmp->nll_next[0];
+			}
+			else
+			{
+				ds_Assert(prev == tmp->nll_prev[1]);
+				ds_Assert(tmp->key.shape1 == c->key.shape1);
+				prev = k;
+				k = tmp->nll_next[1];
 			}
-			ds_Assert(found);
 		}
+		ds_Assert(found);
 	}
 }
 
 void cdb_ClearFrame(struct cdb *cdb)
 {
-	cdb->sat_cache_frame_usage.bits = NULL;
-	cdb->sat_cache_frame_usage.bit_count = 0;
-	cdb->sat_cache_frame_usage.block_count = 0;	
+	stack_u32Flush(&cdb->sat_cache_touched);
     cdb->sat_cache_count = 0;
 
-	cdb->contact_frame_usage.bits = NULL;
-	cdb->contact_frame_usage.bit_count = 0;
-	cdb->contact_frame_usage.block_count = 0;	
+	stack_u32Flush(&cdb->contact_touched);
     cdb->contact_count = 0;
     cdb->contact_new_count = 0;
 }
@@ -223,10 +240,8 @@ struct slot ds_ContactAdd(struct ds_RigidBodyPipeline *pipeline, const struct c_
 	shape0->contact_first = slot.index;
 	shape1->contact_first = slot.index;
 
-	if (slot.index < pipeline->cdb->contact_frame_usage.bit_count)
-	{
-		BitVecSetBit(&pipeline->cdb->contact_frame_usage, slot.index, 1);
-	}
+	c->frame_touched = pipeline->frames_completed;
+	stack_u32Push(&pipeline->cdb->contact_touched, slot.index);
 	PhysicsEventContactNew(pipeline, id);
 
     return slot;
@@ -235,7 +250,7 @@ struct slot ds_ContactAdd(struct ds_RigidBodyPipeline *pipeline, const struct c_
 void ds_ContactUpdate(struct ds_RigidBodyPipeline *pipeline, const struct slot slot, const struct c_Manifold *cm)
 {
 	struct ds_Contact *c = slot.address;
-	BitVecSetBit(&pipeline->cdb->contact_frame_usage, slot.index, 1);
+	c->frame_touched = pipeline->frames_completed;
 	c->cm = *cm;
 }
 
@@ -322,9 +337,12 @@ struct slot sat_CacheAdd(struct cdb *cdb, const struct sat_CacheKey *key)
 
 	struct slot slot = sat_CacheTPoolAdd(&cdb->sat_cache_pool);
 	struct sat_Cache *sat = slot.address;
-    sat->key = *key;
-    sat->type = SAT_CACHE_NOT_SET;
-	sat_CacheTHashMapAdd(&cdb->sat_cache_map, sat, slot.index);
+	if (sat)
+	{
+    	sat->key = *key;
+    	sat->type = SAT_CACHE_NOT_SET;
+		sat_CacheTHashMapAdd(&cdb->sat_cache_map, sat, slot.index);
+	}
     return slot;
 }
 
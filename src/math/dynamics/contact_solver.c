@@ -25,54 +25,91 @@
 /* used in contact solver to cleanup the code from if-statements */
 struct ds_RigidBody static_body = { 0 };
 
-
-struct solverConfig config_storage = { 0 };
-struct solverConfig *g_solver_config = &config_storage;
-
-void SolverConfigInit(const u32 pgs_iteration_count, const u32 ngs_iteration_count, const u32 warmup_solver, const vec3 gravity, const f32 baumgarte_constant, const f32 max_linear_correction, const f32 max_linear_velocity_magnitude, const f32 max_angular_velocity_magnitude, const f32 linear_dampening, const f32 angular_dampening, const f32 linear_slop, const f32 restitution_threshold, const u32 sleep_enabled, const f32 sleep_time_threshold, const f32 sleep_linear_velocity_sq_limit, const f32 sleep_angular_velocity_sq_limit)
+void SolverConfigInit(struct solverConfig *config, const u32 pgs_iteration_count, const u32 ngs_iteration_count, const u32 warmup_solver, const vec3 gravity, const f32 baumgarte_constant, const f32 max_linear_correction, const f32 max_linear_velocity_magnitude, const f32 max_angular_velocity_magnitude, const f32 linear_dampening, const f32 angular_dampening, const f32 linear_slop, const f32 restitution_threshold, const u32 sleep_enabled, const f32 sleep_time_threshold, const f32 sleep_linear_velocity_sq_limit, const f32 sleep_angular_velocity_sq_limit, const u32 split_deferred, const u32 split_body_budget, const u32 island_builder, const u32 substep_count, const u32 deterministic)
 {
 	ds_Assert(pgs_iteration_count >= 1);
 	ds_Assert(ngs_iteration_count >= 1);
-
-	g_solver_config->pgs_iteration_count = pgs_iteration_count;
-	g_solver_config->ngs_iteration_count = ngs_iteration_count;
-	g_solver_config->warmup_solver = warmup_solver;
-	Vec3Copy(g_solver_config->gravity, gravity);
-	g_solver_config->baumgarte_constant = baumgarte_constant;
-	g_solver_config->max_linear_correction = max_linear_correction;
-    g_solver_config->max_linear_velocity_magnitude_inv = (0.0f == max_linear_velocity_magnitude)
+	ds_Assert(island_builder < ISLAND_BUILDER_COUNT);
+	ds_Assert(substep_count >= 1);
+
+	config->pgs_iteration_count = pgs_iteration_count;
+	config->ngs_iteration_count = ngs_iteration_count;
+	config->warmup_solver = warmup_solver;
+	Vec3Copy(config->gravity, gravity);
+	config->baumgarte_constant = baumgarte_constant;
+	config->max_linear_correction = max_linear_correction;
+    config->max_linear_velocity_magnitude_inv = (0.0f == max_linear_velocity_magnitude)
                                                         ? F32_INFINITY
                                                         : 1.0f / max_linear_velocity_magnitude;
-    g_solver_config->max_angular_velocity_magnitude_inv = (0.0f == max_angular_velocity_magnitude)
+    config->max_angular_velocity_magnitude_inv = (0.0f == max_angular_velocity_magnitude)
                                                         ? F32_INFINITY
                                                         : 1.0f / max_angular_velocity_magnitude;
-	g_solver_config->linear_dampening = linear_dampening;
-	g_solver_config->angular_dampening = angular_dampening;
-	g_solver_config->linear_slop = linear_slop;
-	g_solver_config->restitution_threshold = restitution_threshold;
-
- 	g_solver_config->sleep_enabled = sleep_enabled;
-	g_solver_config->sleep_time_threshold = sleep_time_threshold;
-	g_solver_config->sleep_linear_velocity_sq_limit = sleep_linear_velocity_sq_limit;
-	g_solver_config->sleep_angular_velocity_sq_limit = sleep_angular_velocity_sq_limit;
-
-	g_solver_config->pending_warmup_solver = g_solver_config->warmup_solver;
-	g_solver_config->pending_sleep_enabled = g_solver_config->sleep_enabled;
-	g_solver_config->pending_pgs_iteration_count = g_solver_config->pgs_iteration_count;
-	g_solver_config->pending_ngs_iteration_count = g_solver_config->ngs_iteration_count;
-	g_solver_config->pending_linear_slop = g_solver_config->linear_slop;
-	g_solver_config->pending_baumgarte_constant = g_solver_config->baumgarte_constant;
-	g_solver_config->pending_restitution_threshold = g_solver_config->restitution_threshold;
-	g_solver_config->pending_linear_dampening = g_solver_config->linear_dampening;
-	g_solver_config->pending_angular_dampening = g_solver_config->angular_dampening;
+	config->linear_dampening = linear_dampening;
+	config->angular_dampening = angular_dampening;
+	config->linear_slop = linear_slop;
+	config->restitution_threshold = restitution_threshold;
+
+ 	config->sleep_enabled = sleep_enabled;
+	config->sleep_time_threshold = sleep_time_threshold;
+	config->sleep_linear_velocity_sq_limit = sleep_linear_velocity_sq_limit;
+	config->sleep_angular_velocity_sq_limit = sleep_angular_velocity_sq_limit;
+
+	config->split_deferred = split_deferred;
+	config->split_body_budget = split_body_budget;
+	config->island_builder = island_builder;
+	config->substep_count = substep_count;
+	config->deterministic = deterministic;
+
+	config->pending_warmup_solver = config->warmup_solver;
+	config->pending_sleep_enabled = config->sleep_enabled;
+	config->pending_pgs_iteration_count = config->pgs_iteration_count;
+	config->pending_ngs_iteration_count = config->ngs_iteration_count;
+	config->pending_linear_slop = config->linear_slop;
+	config->pending_baumgarte_constant = config->baumgarte_constant;
+	config->pending_restitution_threshold = config->restitution_threshold;
+	config->pending_linear_dampening = config->linear_dampening;
+	config->pending_angular_dampening = config->angular_dampening;
+	config->pending_split_deferred = config->split_deferred;
+	config->pending_split_body_budget = config->split_body_budget;
+	config->pending_island_builder = config->island_builder;
+	config->pending_substep_count = config->substep_count;
+	config->pending_deterministic = config->deterministic;
 
 	static_body.mass = F32_INFINITY;
 }
 
-struct solver *SolverInitBodyData(struct arena *mem, struct ds_Island *is, const f32 timestep)
+static void SolverApplyExternalForces(struct solver *solver, const u32 i)
+{
+	Vec3TranslateScaled(solver->linear_velocity[i], solver->config->gravity, solver->timestep);
+
+	/* Apply dampening: 
+	 *		dv/dt = -d*v
+	 *	=>	d/dt[ve^(d*t)] = 0
+	 *	=>	v(t) = v(0)*e^(-d*t)
+	 *
+	 *	approx e^(-d*t) = 1 - d*t + d^2*t^2 / 2! - ....
+	 *	using Pade P^0_1 =>
+	 *		1 - d*t = a0 / (1 + b1*t)
+	 *		b0 = 1
+	 *		a0 = c0 = 1
+	 *		0 = a1 = c1 + c0*b1
+	 *	=>	0 = b1 - d
+	 *	=>	
+	 *		e^(-d*t) ~= P^0_1(t) 
+	 *			  =  a0 / (b0 + b1*t) 
+	 *			  =  1 / (1 + d*t)
+	 */
+	const f32 linear_damp = 1.0f / (1.0f + solver->config->linear_dampening * solver->timestep);
+	const f32 angular_damp = 1.0f / (1.0f + solver->config->angular_dampening * solver->timestep);
+	Vec3ScaleSelf(solver->linear_velocity[i], linear_damp);
+	Vec3ScaleSelf(solver->angular_velocity[i], angular_damp);
+}
+
+struct solver *SolverInitBodyData(struct arena *mem, const struct solverConfig *config, struct ds_Island *is, const f32 timestep)
 {
 	struct solver *solver = ArenaPush(mem, sizeof(struct solver));
 
+	solver->config = config;
 	solver->bodies = is->bodies;
 	solver->timestep = timestep;
 	solver->body_count = is->body_list.count;
@@ -116,41 +153,53 @@ struct solver *SolverInitBodyData(struct arena *mem, struct ds_Island *is, const
 		/* integrate new velocities using external forces */
 		Vec3Copy(solver->linear_velocity[i], b->velocity);
 		Vec3Copy(solver->angular_velocity[i], b->angular_velocity);
-		Vec3TranslateScaled(solver->linear_velocity[i], g_solver_config->gravity, timestep);
-
-		/* Apply dampening: 
-		 *		dv/dt = -d*v
-		 *	=>	d/dt[ve^(d*t)] = 0
-		 *	=>	v(t) = v(0)*e^(-d*t)
-		 *
-		 *	approx e^(-d*t) = 1 - d*t + d^2*t^2 / 2! - ....
-		 *	using Pade P^0_1 =>
-		 *		1 - d*t = a0 / (1 + b1*t)
-		 *		b0 = 1
-		 *		a0 = c0 = 1
-		 *		0 = a1 = c1 + c0*b1
-		 *	=>	0 = b1 - d
-		 *	=>	
-		 *		e^(-d*t) ~= P^0_1(t) 
-		 *			  =  a0 / (b0 + b1*t) 
-		 *			  =  1 / (1 + d*t)
-		 */
-		const f32 linear_damp = 1.0f / (1.0f + g_solver_config->linear_dampening * timestep);
-		const f32 angular_damp = 1.0f / (1.0f + g_solver_config->angular_dampening * timestep);
-		Vec3ScaleSelf(solver->linear_velocity[i], linear_damp);
-		Vec3ScaleSelf(solver->angular_velocity[i], angular_damp);
+		SolverApplyExternalForces(solver, i);
 	}
 
 	return solver;
 }
 
-void SolverInitVelocityConstraints(struct arena *mem, struct solver *solver, const struct ds_RigidBodyPipeline *pipeline, const struct ds_Island *is)
+/* effective normal and tangent masses of the contact point, given its levers and the world inertia of the bodies */
+static void SolverContactMass(const struct solver *solver, const struct velocityConstraint *vc, struct velocityConstraintPoint *vcp)
 {
-	solver->vcs = ArenaPush(mem, solver->contact_count * sizeof(struct velocityConstraint));
-
 	vec3 tmp1, tmp2, tmp3, tmp4;
 	vec3 vcp_Ic; 	/* Temporary storage for Inw(I_1)(r1 x n) */
 	vec3 vcp_c;	    /* Temporary storage for(r1 x n) */
+	mat3ptr Iw_inv1 = solver->Iw_inv + vc->lb1;
+	mat3ptr Iw_inv2 = solver->Iw_inv + vc->lb2;
+
+	Vec3Cross(vcp_c, vcp->r1, vc->normal);
+	Mat3VecMul(vcp_Ic, *Iw_inv1, vcp_c);
+	vcp->normal_mass = 1.0f / solver->bodies[vc->lb1]->mass + Vec3Dot(vcp_Ic, vcp_c);
+
+	Vec3Cross(tmp1, vcp->r1, vc->tangent[0]);
+	Vec3Cross(tmp3, vcp->r1, vc->tangent[1]);
+	Mat3VecMul(tmp2, *Iw_inv1, tmp1);
+	Mat3VecMul(tmp4, *Iw_inv1, tmp3);
+	vcp->tangent_mass[0] = 1.0f / solver->bodies[vc->lb1]->mass + Vec3Dot(tmp1, tmp2);
+	vcp->tangent_mass[1] = 1.0f / solver->bodies[vc->lb1]->mass + Vec3Dot(tmp3, tmp4);
+
+	Vec3Cross(vcp_c, vcp->r2, vc->normal);
+	Mat3VecMul(vcp_Ic, *Iw_inv2, vcp_c);
+	vcp->normal_mass += 1.0f / solver->bodies[vc->lb2]->mass + Vec3Dot(vcp_Ic, vcp_c);
+
+	Vec3Cross(tmp1, vcp->r2, vc->tangent[0]);
+	Vec3Cross(tmp3, vcp->r2, vc->tangent[1]);
+	Mat3VecMul(tmp2, *Iw_inv2, tmp1);
+	Mat3VecMul(tmp4, *Iw_inv2, tmp3);
+	vcp->tangent_mass[0] += 1.0f / solver->bodies[vc->lb2]->mass + Vec3Dot(tmp1, tmp2);
+	vcp->tangent_mass[1] += 1.0f / solver->bodies[vc->lb2]->mass + Vec3Dot(tmp3, tmp4);
+
+	vcp->normal_mass = 1.0f / vcp->normal_mass;
+	vcp->tangent_mass[0] = 1.0f / vcp->tangent_mass[0];
+	vcp->tangent_mass[1] = 1.0f / vcp->tangent_mass[1];
+}
+
+void SolverInitVelocityConstraints(struct arena *mem, struct solver *solver, const struct ds_RigidBodyPipeline *pipeline, const struct ds_Island *is)
+{
+	solver->vcs = ArenaPush(mem, solver->contact_count * sizeof(struct velocityConstraint));
+
+	vec3 tmp1, tmp2;
 	for (u32 i = 0; i < solver->contact_count; ++i)
 	{			
 		struct velocityConstraint *vc = solver->vcs + i;
@@ -172,9 +221,6 @@ void SolverInitVelocityConstraints(struct arena *mem, struct solver *solver, con
 		    vc->friction = f32_sqrt(s1->friction*s2->friction);
         }
 
-		mat3ptr Iw_inv1 = solver->Iw_inv + vc->lb1;
-		mat3ptr Iw_inv2 = solver->Iw_inv + vc->lb2;
-
         Vec3Copy(vc->normal, is->contacts[i]->cm.n);
 		Vec3CreateBasis(vc->tangent[0], vc->tangent[1], vc->normal);
 
@@ -200,31 +246,7 @@ void SolverInitVelocityConstraints(struct arena *mem, struct solver *solver, con
                      that |r1 - r1_cached|^2 = 0.0f <= limit_sq, so we will continue alias the old contact despite\
                      moving far away from it.");
 
-			Vec3Cross(vcp_c, vcp->r1, vc->normal);
-			Mat3VecMul(vcp_Ic, *Iw_inv1, vcp_c);
-			vcp->normal_mass = 1.0f / solver->bodies[vc->lb1]->mass + Vec3Dot(vcp_Ic, vcp_c);
-
-			Vec3Cross(tmp1, vcp->r1, vc->tangent[0]);
-			Vec3Cross(tmp3, vcp->r1, vc->tangent[1]);
-			Mat3VecMul(tmp2, *Iw_inv1, tmp1);
-			Mat3VecMul(tmp4, *Iw_inv1, tmp3);
-			vcp->tangent_mass[0] = 1.0f / solver->bodies[vc->lb1]->mass + Vec3Dot(tmp1, tmp2);
-			vcp->tangent_mass[1] = 1.0f / solver->bodies[vc->lb1]->mass + Vec3Dot(tmp3, tmp4);
-
-			Vec3Cross(vcp_c, vcp->r2, vc->normal);
-			Mat3VecMul(vcp_Ic, *Iw_inv2, vcp_c);
-			vcp->normal_mass += 1.0f / solver->bodies[vc->lb2]->mass + Vec3Dot(vcp_Ic, vcp_c);
-
-			Vec3Cross(tmp1, vcp->r2, vc->tangent[0]);
-			Vec3Cross(tmp3, vcp->r2, vc->tangent[1]);
-			Mat3VecMul(tmp2, *Iw_inv2, tmp1);
-			Mat3VecMul(tmp4, *Iw_inv2, tmp3);
-			vcp->tangent_mass[0] += 1.0f / solver->bodies[vc->lb2]->mass + Vec3Dot(tmp1, tmp2);
-			vcp->tangent_mass[1] += 1.0f / solver->bodies[vc->lb2]->mass + Vec3Dot(tmp3, tmp4);
-
-			vcp->normal_mass = 1.0f / vcp->normal_mass;
-			vcp->tangent_mass[0] = 1.0f / vcp->tangent_mass[0];
-			vcp->tangent_mass[1] = 1.0f / vcp->tangent_mass[1];
+			SolverContactMass(solver, vc, vcp);
 
 			/* TODO: This will run immediately again on the first iteration of the solver,
 			 * could somehow remove it here, but would make stuff more complex than needed
@@ -240,7 +262,7 @@ void SolverInitVelocityConstraints(struct arena *mem, struct solver *solver, con
 			const f32 separating_velocity = Vec3Dot(vc->normal, relative_velocity);
 
 			/* if sufficiently fast collision happening, so apply the restitution effect */
-			vcp->velocity_bias = (separating_velocity < -g_solver_config->restitution_threshold)
+			vcp->velocity_bias = (separating_velocity < -solver->config->restitution_threshold)
                 ? -separating_velocity * vc->restitution
                 : 0.0f;
 		}
@@ -491,9 +513,9 @@ u32 SolverIteratePositionConstraints(struct solver *solver)
             Vec3Add(tmp2, r2, solver->w_center_of_mass[vc->lb2]);
             const f32 distance = Vec3Dot(tmp2, vc->normal) - Vec3Dot(tmp1, vc->normal); 
             min_separation = f32_max(min_separation, distance);
-            const f32 biased_slop_distance = g_solver_config->baumgarte_constant * (distance + g_solver_config->linear_slop);
+            const f32 biased_slop_distance = solver->config->baumgarte_constant * (distance + solver->config->linear_slop);
 
-            const f32 C = f32_clamp(biased_slop_distance, -g_solver_config->max_linear_correction, 0.0f);
+            const f32 C = f32_clamp(biased_slop_distance, -solver->config->max_linear_correction, 0.0f);
             
             const f32 impulse = (K > 0.0f) 
                 ? -C/K 
@@ -526,7 +548,190 @@ u32 SolverIteratePositionConstraints(struct solver *solver)
      * If all penetration depths at start of iteration was smaller that 3*linear_slop, we view contacts as
      * okay and early exit. Note that the solver target separation is -solver->linear_slop, not 0.0f. 
      */
-    return (min_separation >= -3.0f*g_solver_config->linear_slop)
+    return (min_separation >= -3.0f*solver->config->linear_slop)
         ? 1
         : 0;
 }
+
+/* apply impulse at contact point: -impulse on body 1, +impulse on body 2 */
+static void SolverApplyContactImpulse(struct solver *solver, const struct velocityConstraint *vc, const struct velocityConstraintPoint *vcp, const vec3 impulse)
+{
+	vec3 tmp1, tmp2;
+	Vec3TranslateScaled(solver->linear_velocity[vc->lb1], impulse, -1.0f / solver->bodies[vc->lb1]->mass);
+	Vec3TranslateScaled(solver->linear_velocity[vc->lb2], impulse, 1.0f / solver->bodies[vc->lb2]->mass);
+	Vec3Cross(tmp1, vcp->r1, impulse);
+	Mat3VecMul(tmp2, solver->Iw_inv[vc->lb1], tmp1);
+	Vec3TranslateScaled(solver->angular_velocity[vc->lb1], tmp2, -1.0f);
+	Vec3Cross(tmp1, vcp->r2, impulse);
+	Mat3VecMul(tmp2, solver->Iw_inv[vc->lb2], tmp1);
+	Vec3Translate(solver->angular_velocity[vc->lb2], tmp2);
+}
+
+/* Calculate separating velocity at point along direction: JV */
+static f32 SolverSeparatingVelocity(const struct solver *solver, const struct velocityConstraint *vc, const struct velocityConstraintPoint *vcp, const vec3 direction)
+{
+	vec3 relative_velocity, tmp1, tmp2;
+	Vec3Sub(relative_velocity, 
+			solver->linear_velocity[vc->lb2],
+			solver->linear_velocity[vc->lb1]);
+	Vec3Cross(tmp1, solver->angular_velocity[vc->lb2], vcp->r2);
+	Vec3Cross(tmp2, solver->angular_velocity[vc->lb1], vcp->r1);
+	Vec3Translate(relative_velocity, tmp1);
+	Vec3TranslateScaled(relative_velocity, tmp2, -1.0f);
+	return Vec3Dot(direction, relative_velocity);
+}
+
+void SolverInitSubstepConstraints(struct solver *solver)
+{
+    quat body1_inverse_rotation, body2_inverse_rotation;
+    for (u32 i = 0; i < solver->contact_count; ++i)
+	{
+		struct velocityConstraint *vc = solver->vcs + i;
+        QuatInverse(body1_inverse_rotation, solver->rotation[vc->lb1]);
+        QuatInverse(body2_inverse_rotation, solver->rotation[vc->lb2]);
+		for (u32 j = 0; j < vc->vcp_count; ++j)
+		{
+			struct velocityConstraintPoint *vcp = vc->vcps + j;
+            QuatVec3Rotate(vcp->local_r1, body1_inverse_rotation, vcp->r1);
+            QuatVec3Rotate(vcp->local_r2, body2_inverse_rotation, vcp->r2);
+        }
+    }
+}
+
+void SolverIntegrateVelocities(struct solver *solver)
+{
+	for (u32 i = 0; i < solver->body_count; ++i)
+	{
+		SolverApplyExternalForces(solver, i);
+	}
+}
+
+void SolverWarmupSubstep(struct solver *solver)
+{
+	vec3 impulse;
+    for (u32 i = 0; i < solver->contact_count; ++i)
+	{
+		const struct velocityConstraint *vc = solver->vcs + i;
+		for (u32 j = 0; j < vc->vcp_count; ++j)
+		{
+			const struct velocityConstraintPoint *vcp = vc->vcps + j;
+			Vec3Scale(impulse, vc->normal, vcp->normal_impulse);
+			Vec3TranslateScaled(impulse, vc->tangent[0], vcp->tangent_impulse[0]);
+			Vec3TranslateScaled(impulse, vc->tangent[1], vcp->tangent_impulse[1]);
+			SolverApplyContactImpulse(solver, vc, vcp, impulse);
+		}
+	}
+}
+
+void SolverIterateSubstepConstraints(struct solver *solver, const u32 use_bias)
+{
+	vec3 impulse, p1, p2, diff;
+	const f32 inv_h = 1.0f / solver->timestep;
+	/* baumgarte_constant is the fraction of penetration resolved per tick, not per sub-step */
+	const f32 inv_tick = inv_h / solver->config->substep_count;
+	for (u32 i = 0; i < solver->contact_count; ++i)
+	{
+		struct velocityConstraint *vc = solver->vcs + i;
+
+		/* solve friction constraints first, since normal constraints are more important */
+		for (u32 j = 0; j < vc->vcp_count; ++j)
+		{
+			struct velocityConstraintPoint *vcp = vc->vcps + j;
+			const f32 impulse_bound = vc->friction * vcp->normal_impulse;
+			for (u32 k = 0; k < 2; ++k)
+			{
+				const f32 separating_velocity = SolverSeparatingVelocity(solver, vc, vcp, vc->tangent[k]);
+				f32 delta_impulse = -vcp->tangent_mass[k] * separating_velocity;
+				const f32 old_impulse = vcp->tangent_impulse[k];
+				vcp->tangent_impulse[k] = f32_clamp(vcp->tangent_impulse[k] + delta_impulse, -impulse_bound, impulse_bound);
+				delta_impulse = vcp->tangent_impulse[k] - old_impulse;
+
+				Vec3Scale(impulse, vc->tangent[k], delta_impulse);
+				SolverApplyContactImpulse(solver, vc, vcp, impulse);
+			}
+		}
+
+		for (u32 j = 0; j < vc->vcp_count; ++j)
+		{
+			struct velocityConstraintPoint *vcp = vc->vcps + j;
+
+			/* current separation of the contact points, given the sub-stepped positions */
+            QuatVec3Rotate(p1, solver->rotation[vc->lb1], vcp->local_r1);
+            QuatVec3Rotate(p2, solver->rotation[vc->lb2], vcp->local_r2);
+            Vec3Translate(p1, solver->w_center_of_mass[vc->lb1]);
+            Vec3Translate(p2, solver->w_center_of_mass[vc->lb2]);
+            Vec3Sub(diff, p2, p1);
+            const f32 separation = Vec3Dot(vc->normal, diff);
+
+            /* 
+             * Separated points may approach each other until they touch (speculative contact). Penetrating
+             * points are pushed out only when use_bias is set; the relaxation iteration then removes the 
+             * velocity added by the push out, so it never turns into kinetic energy.
+             */
+			f32 velocity_bias = vcp->velocity_bias;
+            if (separation > 0.0f)
+            {
+                velocity_bias = -separation * inv_h;
+            }
+            else if (use_bias)
+            {
+                const f32 C = f32_clamp(solver->config->baumgarte_constant * (separation + solver->config->linear_slop), -solver->config->max_linear_correction, 0.0f);
+                velocity_bias = f32_max(velocity_bias, -C * inv_tick);
+            }
+
+			const f32 separating_velocity = SolverSeparatingVelocity(solver, vc, vcp, vc->normal);
+			f32 delta_impulse = vcp->normal_mass * (velocity_bias - separating_velocity);
+			const f32 old_impulse = vcp->normal_impulse;
+			vcp->normal_impulse = f32_max(0.0f, vcp->normal_impulse + delta_impulse);
+			delta_impulse = vcp->normal_impulse - old_impulse;
+
+			Vec3Scale(impulse, vc->normal, delta_impulse);
+			SolverApplyContactImpulse(solver, vc, vcp, impulse);
+		}
+	}
+}
+
+void SolverIntegratePositions(struct solver *solver)
+{
+	mat3 rot, rot_inv, tmp;
+    quat a_vel_quat, rot_delta;
+	for (u32 i = 0; i < solver->body_count; ++i)
+	{
+        const f32 div_linear = Vec3Length(solver->linear_velocity[i]) * solver->config->max_linear_velocity_magnitude_inv;
+        const f32 div_angular = Vec3Length(solver->angular_velocity[i]) * solver->config->max_angular_velocity_magnitude_inv;
+        const f32 t_linear = 1.0f / f32_clamp(div_linear, 1.0f, F32_INFINITY);
+        const f32 t_angular = 1.0f / f32_clamp(div_angular, 1.0f, F32_INFINITY);
+
+		Vec3TranslateScaled(solver->w_center_of_mass[i], solver->linear_velocity[i], solver->timestep * t_linear);	
+		QuatSet(a_vel_quat, 
+				solver->angular_velocity[i][0] * t_angular, 
+				solver->angular_velocity[i][1] * t_angular, 
+				solver->angular_velocity[i][2] * t_angular,
+			      	0.0f);
+		QuatMul(rot_delta, a_vel_quat, solver->rotation[i]);
+		QuatScale(rot_delta, solver->timestep / 2.0f);
+		QuatTranslate(solver->rotation[i], rot_delta);
+		QuatNormalize(solver->rotation[i]);
+
+		/* world inertia follows the new rotation */
+		Mat3Quat(rot, solver->rotation[i]);
+		Mat3Transpose(rot_inv, rot);
+		Mat3Mul(tmp, rot, solver->bodies[i]->inv_inertia_tensor);
+		Mat3Mul(solver->Iw_inv[i], tmp, rot_inv);
+	}
+}
+
+void SolverUpdateSubstepConstraints(struct solver *solver)
+{
+    for (u32 i = 0; i < solver->contact_count; ++i)
+	{
+		struct velocityConstraint *vc = solver->vcs + i;
+		for (u32 j = 0; j < vc->vcp_count; ++j)
+		{
+			struct velocityConstraintPoint *vcp = vc->vcps + j;
+            QuatVec3Rotate(vcp->r1, solver->rotation[vc->lb1], vcp->local_r1);
+            QuatVec3Rotate(vcp->r2, solver->rotation[vc->lb2], vcp->local_r2);
+			SolverContactMass(solver, vc, vcp);
+        }
+    }
+}
@@ -18,11 +18,17 @@
 */
 
 #include "dynamics.h"
+#include "ds_job.h"
 
 ds_RigidBodyId ds_RigidBodyAdd(struct ds_RigidBodyPipeline *pipeline, const struct ds_RigidBodyPrefab *prefab, const ds_Transform *t_world, const u32 entity)
 {
 	struct slot slot = ds_PoolAdd(&pipeline->body_pool);
 	struct ds_RigidBody *body = slot.address;
+	if (!body)
+	{
+		LogString(T_PHYSICS, S_FATAL, "Rigid body pool full, increase body_max, exiting.");
+		FatalCleanupAndExit();
+	}
     body->tag += DS_ID_TAG_GENERATION_INCREMENT;
     const ds_RigidBodyId id = ((u64) body->tag << 32) | slot.index;
 
@@ -38,13 +44,15 @@ ds_RigidBodyId ds_RigidBodyAdd(struct ds_RigidBodyPipeline *pipeline, const stru
 	Vec3Set(body->linear_momentum, 0.0f, 0.0f, 0.0f);
 
 	const u32 dynamic_flag = (prefab->dynamic) ? RB_DYNAMIC : 0;
-	body->flags = RB_ACTIVE | (g_solver_config->sleep_enabled * RB_AWAKE) | dynamic_flag;
+	body->flags = RB_ACTIVE | (pipeline->config.sleep_enabled * RB_AWAKE) | dynamic_flag;
 
 	body->low_velocity_time = 0.0f;
+	body->awake_index = U32_MAX;
 
 	if (body->flags & RB_DYNAMIC)
 	{
 		isdb_InitIslandFromBody(pipeline, slot.index);
+		ds_RigidBodyProxyWake(pipeline, slot.index);
 	}
 	else
 	{
@@ -67,6 +75,11 @@ void ds_RigidBodyRemove(struct arena *mem_tmp, struct ds_RigidBodyPipeline *pipe
 		? dll_Remove(&pipeline->body_marked_list, pipeline->body_pool.buf, ds_IdIndex(id))
 		: dll_Remove(&pipeline->body_non_marked_list, pipeline->body_pool.buf, ds_IdIndex(id));
 
+	if (body->awake_index != U32_MAX)
+	{
+		ds_RigidBodyProxySleep(pipeline, ds_IdIndex(id));
+	}
+
 	struct ds_Shape *shape_ptr;
 	if (body->island_index != ISLAND_STATIC)
 	{
@@ -109,6 +122,146 @@ void ds_RigidBodyRemove(struct arena *mem_tmp, struct ds_RigidBodyPipeline *pipe
 	PhysicsEventBodyRemoved(pipeline, entity);
 }
 
+struct ds_ShapeProxyBboxInput
+{
+	const struct ds_RigidBodyPipeline *	pipeline;
+	const u32 *				shape;	/* base of shape index range */
+	struct aabb *				bbox;	/* bbox[i] is the proxy bbox of shape[i] */
+};
+
+static void ThreadShapeProxyBbox(void *task_addr)
+{
+	ProfZone;
+
+	struct task *task = task_addr;
+	const struct ds_ShapeProxyBboxInput *in = task->input;
+	const u32 *shape = task->range->base;
+	struct aabb *bbox = in->bbox + (shape - in->shape);
+	for (u64 i = 0; i < task->range->count; ++i)
+	{
+		bbox[i] = ds_ShapeProxyBbox(in->pipeline, ds_PoolAddress(&in->pipeline->shape_pool, shape[i]));
+	}
+
+	ProfZoneEnd;
+}
+
+void ds_RigidBodyAddBatch(struct arena *mem_tmp, struct ds_RigidBodyPipeline *pipeline, ds_RigidBodyId *body_id, ds_ShapeId *shape_id, const struct ds_RigidBodyBatch *batch)
+{
+	ProfZone;
+
+	ds_AssertString(pipeline->async_stream == NULL, "Fence any in-flight ticks before adding bodies");
+	ArenaPushRecord(mem_tmp);
+
+	const u32 count = batch->count;
+	u32 *shape = ArenaPush(mem_tmp, count*sizeof(u32));
+	u32 *proxy = ArenaPush(mem_tmp, count*sizeof(u32));
+	u32 *asleep = ArenaPush(mem_tmp, count*sizeof(u32));
+	struct aabb *bbox = ArenaPush(mem_tmp, count*sizeof(struct aabb));
+	if (count && (!shape || !proxy || !asleep || !bbox))
+	{
+		LogString(T_PHYSICS, S_FATAL, "Arena OOM in ds_RigidBodyAddBatch, increase size!");
+		FatalCleanupAndExit();
+	}
+
+	/* grow the pools once instead of doubling them over the batch */
+	if (!ds_PoolReserve(&pipeline->body_pool, pipeline->body_pool.count + count)
+		|| !ds_PoolReserve(&pipeline->shape_pool, pipeline->shape_pool.count + count))
+	{
+		LogString(T_PHYSICS, S_FATAL, "Rigid body batch exceeds body_max or shape_max, exiting.");
+		FatalCleanupAndExit();
+	}
+
+	for (u32 i = 0; i < count; ++i)
+	{
+		body_id[i] = ds_RigidBodyAdd(pipeline, batch->body_prefab[i], batch->t_world + i, batch->entity[i]);
+		const struct slot slot = ds_ShapeAlloc(pipeline, batch->shape_prefab[i], batch->t_local + i, body_id[i]);
+		ds_Assert(slot.address);
+		shape[i] = slot.index;
+		if (shape_id)
+		{
+			shape_id[i] = ((u64) ((struct ds_Shape *) slot.address)->tag << 32) | slot.index;
+		}
+
+		ds_RigidBodyUpdateMassProperties(pipeline, body_id[i]);
+		const struct ds_RigidBody *body = ds_PoolAddress(&pipeline->body_pool, ds_IdIndex(body_id[i]));
+		asleep[i] = (body->awake_index == U32_MAX);
+	}
+
+	struct ds_ShapeProxyBboxInput args = { .pipeline = pipeline, .shape = shape, .bbox = bbox };
+	task_parallel_for(mem_tmp, ThreadShapeProxyBbox, shape, count, sizeof(u32), 64, &args);
+
+	DbvhInsertBatch(mem_tmp, &pipeline->shape_bvh, proxy, shape, bbox, asleep, count);
+	for (u32 i = 0; i < count; ++i)
+	{
+		struct ds_Shape *s = ds_PoolAddress(&pipeline->shape_pool, shape[i]);
+		s->proxy = proxy[i];
+	}
+
+	ArenaPopRecord(mem_tmp);
+	ProfZoneEnd;
+}
+
+void ds_RigidBodyRemoveBatch(struct arena *mem_tmp, struct ds_RigidBodyPipeline *pipeline, const ds_RigidBodyId *id, const u32 count)
+{
+	ProfZone;
+
+	ArenaPushRecord(mem_tmp);
+
+	u32 proxy_count = 0;
+	for (u32 i = 0; i < count; ++i)
+	{
+		const struct slot slot = ds_RigidBodyLookup(pipeline, id[i]);
+		if (slot.address)
+		{
+			proxy_count += ((struct ds_RigidBody *) slot.address)->shape_list.count;
+		}
+	}
+
+	/* pull the proxies out of the bvh up front, so the per-body removal below skips DbvhRemove */
+	u32 *proxy = ArenaPush(mem_tmp, proxy_count*sizeof(u32));
+	if (proxy_count && !proxy)
+	{
+		LogString(T_PHYSICS, S_FATAL, "Arena OOM in ds_RigidBodyRemoveBatch, increase size!");
+		FatalCleanupAndExit();
+	}
+
+	proxy_count = 0;
+	for (u32 i = 0; i < count; ++i)
+	{
+		const struct slot slot = ds_RigidBodyLookup(pipeline, id[i]);
+		if (!slot.address)
+		{
+			continue;
+		}
+
+		const struct ds_RigidBody *body = slot.address;
+		if (body->awake_index != U32_MAX)
+		{
+			ds_RigidBodyProxySleep(pipeline, slot.index);
+		}
+
+		struct ds_Shape *shape = NULL;
+		for (u32 j = body->shape_list.first; j != DLL_NULL; j = shape->dll_next)
+		{
+			shape = ds_PoolAddress(&pipeline->shape_pool, j);
+			if (shape->proxy != U32_MAX)
+			{
+				proxy[proxy_count++] = shape->proxy;
+				shape->proxy = U32_MAX;
+			}
+		}
+	}
+	DbvhRemoveBatch(mem_tmp, &pipeline->shape_bvh, proxy, proxy_count);
+
+	for (u32 i = 0; i < count; ++i)
+	{
+		ds_RigidBodyRemove(mem_tmp, pipeline, id[i]);
+	}
+
+	ArenaPopRecord(mem_tmp);
+	ProfZoneEnd;
+}
+
 struct slot ds_RigidBodyLookup(const struct ds_RigidBodyPipeline *pipeline, const ds_RigidBodyId id)
 {
     struct slot slot = { .address = NULL, .index = 0 };
@@ -122,6 +275,80 @@ struct slot ds_RigidBodyLookup(const struct ds_RigidBodyPipeline *pipeline, cons
     return slot;
 }
 
+void ds_RigidBodySetTransform(struct ds_RigidBodyPipeline *pipeline, const ds_RigidBodyId id, const ds_Transform *t_world)
+{
+	ds_AssertString(pipeline->async_stream == NULL, "Fence any in-flight ticks before moving bodies");
+	const struct slot slot = ds_RigidBodyLookup(pipeline, id);
+	struct ds_RigidBody *body = slot.address;
+	if (!body)
+	{
+		return;
+	}
+
+	body->t_world = *t_world;
+	if (body->flags & RB_DYNAMIC)
+	{
+		/* only proxies on the awake list are refit */
+		if (body->awake_index == U32_MAX)
+		{
+			ds_RigidBodyProxyWake(pipeline, slot.index);
+		}
+	}
+	else
+	{
+		struct ds_Shape *shape = NULL;
+		for (u32 i = body->shape_list.first; i != DLL_NULL; i = shape->dll_next)
+		{
+			shape = ds_PoolAddress(&pipeline->shape_pool, i);
+			const struct aabb bbox_proxy = ds_ShapeProxyBbox(pipeline, shape);
+			DbvhRemove(&pipeline->shape_bvh, shape->proxy);
+			shape->proxy = DbvhInsert(&pipeline->shape_bvh, i, &bbox_proxy);
+			DbvhSetAsleep(&pipeline->shape_bvh, shape->proxy, 1);
+		}
+	}
+}
+
+void ds_RigidBodyProxyWake(struct ds_RigidBodyPipeline *pipeline, const u32 index)
+{
+	struct ds_RigidBody *body = ds_PoolAddress(&pipeline->body_pool, index);
+	ds_Assert(body->awake_index == U32_MAX);
+	ds_Assert(body->flags & RB_DYNAMIC);
+
+	body->awake_index = pipeline->body_awake_list.next;
+	stack_u32Push(&pipeline->body_awake_list, index);
+
+	struct ds_Shape *shape = NULL;
+	for (u32 i = body->shape_list.first; i != DLL_NULL; i = shape->dll_next)
+	{
+		shape = ds_PoolAddress(&pipeline->shape_pool, i);
+		DbvhSetAsleep(&pipeline->shape_bvh, shape->proxy, 0);
+	}
+}
+
+void ds_RigidBodyProxySleep(struct ds_RigidBodyPipeline *pipeline, const u32 index)
+{
+	struct ds_RigidBody *body = ds_PoolAddress(&pipeline->body_pool, index);
+	ds_Assert(body->awake_index < pipeline->body_awake_list.next);
+	ds_Assert(pipeline->body_awake_list.arr[body->awake_index] == index);
+
+	/* swap in the last awake body */
+	const u32 last = stack_u32Pop(&pipeline->body_awake_list);
+	if (last != index)
+	{
+		struct ds_RigidBody *body_last = ds_PoolAddress(&pipeline->body_pool, last);
+		pipeline->body_awake_list.arr[body->awake_index] = last;
+		body_last->awake_index = body->awake_index;
+	}
+	body->awake_index = U32_MAX;
+
+	struct ds_Shape *shape = NULL;
+	for (u32 i = body->shape_list.first; i != DLL_NULL; i = shape->dll_next)
+	{
+		shape = ds_PoolAddress(&pipeline->shape_pool, i);
+		DbvhSetAsleep(&pipeline->shape_bvh, shape->proxy, 1);
+	}
+}
+
 void ds_RigidBodyUpdateLocalFrame(struct ds_RigidBodyPipeline *pipeline, const u32 body, const ds_Transform t_apply_to_local)
 {
 	//TODO
@@ -19,20 +19,18 @@
 
 #include "dynamics.h"
 
-ds_ShapeId ds_ShapeAdd(struct ds_RigidBodyPipeline *pipeline, const struct ds_ShapePrefab *prefab, const ds_Transform *t, const ds_RigidBodyId body)
+struct slot ds_ShapeAlloc(struct ds_RigidBodyPipeline *pipeline, const struct ds_ShapePrefab *prefab, const ds_Transform *t, const ds_RigidBodyId body)
 {
-    ds_ShapeId id = DS_ID_NULL;
     struct slot slot = ds_PoolAdd(&pipeline->shape_pool);
 	if (slot.address)
 	{
-		struct ds_RigidBody *body_ptr = ds_PoolAddress(&pipeline->body_pool, body);
+		struct ds_RigidBody *body_ptr = ds_PoolAddress(&pipeline->body_pool, ds_IdIndex(body));
 		ds_Assert(PoolSlotAllocated(body_ptr));
 		dll_Append(&body_ptr->shape_list, pipeline->shape_pool.buf, slot.index);
 
 		struct ds_Shape *shape = slot.address;
 
         shape->tag += DS_ID_TAG_GENERATION_INCREMENT;
-        id = ((u64) shape->tag << 32) | slot.index;
 		shape->body = ds_IdIndex(body);
 		shape->contact_first = NLL_NULL;
 		shape->density = prefab->density;
@@ -40,18 +38,43 @@ ds_ShapeId ds_ShapeAdd(struct ds_RigidBodyPipeline *pipeline, const struct ds_Sh
 		shape->friction = prefab->friction;
 		shape->t_local = *t;
 		shape->margin = prefab->margin;
+		shape->proxy = U32_MAX;
 
 		const struct c_Shape *cshape = strdb_Address(pipeline->cshape_db, prefab->cshape);
 		const struct slot cshape_slot = strdb_Reference(pipeline->cshape_db, cshape->id);
 		shape->cshape_handle = cshape_slot.index;
 		shape->cshape_type = cshape->type;
+	}
 
-		struct aabb bbox_proxy = ds_ShapeWorldBbox(pipeline, shape);
-		if (shape->cshape_type != C_SHAPE_TRI_MESH)
+	return slot;
+}
+
+struct aabb ds_ShapeProxyBbox(const struct ds_RigidBodyPipeline *pipeline, const struct ds_Shape *shape)
+{
+	struct aabb bbox_proxy = ds_ShapeWorldBbox(pipeline, shape);
+	if (shape->cshape_type != C_SHAPE_TRI_MESH)
+	{
+		Vec3Translate(bbox_proxy.hw, Vec3Inline(shape->margin, shape->margin, shape->margin));
+	}
+	return bbox_proxy;
+}
+
+ds_ShapeId ds_ShapeAdd(struct ds_RigidBodyPipeline *pipeline, const struct ds_ShapePrefab *prefab, const ds_Transform *t, const ds_RigidBodyId body)
+{
+    ds_ShapeId id = DS_ID_NULL;
+    struct slot slot = ds_ShapeAlloc(pipeline, prefab, t, body);
+	if (slot.address)
+	{
+		struct ds_Shape *shape = slot.address;
+        id = ((u64) shape->tag << 32) | slot.index;
+
+		const struct aabb bbox_proxy = ds_ShapeProxyBbox(pipeline, shape);
+		shape->proxy = DbvhInsert(&pipeline->shape_bvh, slot.index, &bbox_proxy);
+		const struct ds_RigidBody *body_ptr = ds_PoolAddress(&pipeline->body_pool, ds_IdIndex(body));
+		if (body_ptr->awake_index == U32_MAX)
 		{
-			Vec3Translate(bbox_proxy.hw, Vec3Inline(shape->margin, shape->margin, shape->margin));
+			DbvhSetAsleep(&pipeline->shape_bvh, shape->proxy, 1);
 		}
-		shape->proxy = DbvhInsert(&pipeline->shape_bvh, slot.index, &bbox_proxy);
 
         ds_RigidBodyUpdateMassProperties(pipeline, body);
 	}
@@ -70,7 +93,10 @@ void ds_ShapeDynamicRemove(struct ds_RigidBodyPipeline *pipeline, struct ds_Isla
 	shape->contact_first = NLL_NULL;
 
 	strdb_Dereference(pipeline->cshape_db, shape->cshape_handle);
-	DbvhRemove(&pipeline->shape_bvh, shape->proxy);
+	if (shape->proxy != U32_MAX)
+	{
+		DbvhRemove(&pipeline->shape_bvh, shape->proxy);
+	}
 	ds_PoolRemove(&pipeline->shape_pool, ds_PoolIndex(&pipeline->shape_pool, shape));
 
 	while (ci != NLL_NULL)
@@ -105,7 +131,6 @@ void ds_ShapeDynamicRemove(struct ds_RigidBodyPipeline *pipeline, struct ds_Isla
 
 	    PhysicsEventContactRemoved(pipeline, b0, s0, b1, s1);
         dll_Remove(&island->contact_list, pipeline->cdb->contact_net.pool.buf, ci);
-		BitVecSetBit(&pipeline->cdb->contact_persistent_usage, ci, 0);
 		ds_HashMapRemove(&pipeline->cdb->contact_map, ds_ContactKeyHash(&c->key), ci);
 		nll_Remove(&pipeline->cdb->contact_net, ci);
 		ci = ci_next;
@@ -124,7 +149,10 @@ void ds_ShapeStaticRemove(struct arena *mem_tmp, struct ds_RigidBodyPipeline *pi
     ds_Assert(((struct ds_RigidBody *) ds_PoolAddress(&pipeline->body_pool, shape->body))->island_index == ISLAND_STATIC);
 
 	strdb_Dereference(pipeline->cshape_db, shape->cshape_handle);
-	DbvhRemove(&pipeline->shape_bvh, shape->proxy);
+	if (shape->proxy != U32_MAX)
+	{
+		DbvhRemove(&pipeline->shape_bvh, shape->proxy);
+	}
 	ds_PoolRemove(&pipeline->shape_pool, ds_PoolIndex(&pipeline->shape_pool, shape));
 
 	ArenaPushRecord(&pipeline->frame);
@@ -175,7 +203,6 @@ void ds_ShapeStaticRemove(struct arena *mem_tmp, struct ds_RigidBodyPipeline *pi
 		}
 
 		PhysicsEventContactRemoved(pipeline, b0, s0, b1, s1);
-		BitVecSetBit(&pipeline->cdb->contact_persistent_usage, ci, 0);
 		ds_HashMapRemove(&pipeline->cdb->contact_map, ds_ContactKeyHash(&c->key), ci);
         dll_Remove(&is->contact_list, pipeline->cdb->contact_net.pool.buf, ci);
 		nll_Remove(&pipeline->cdb->contact_net, ci);
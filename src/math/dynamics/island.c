@@ -38,7 +38,7 @@ static struct slot isdb_IslandEmpty(struct ds_RigidBodyPipeline *pipeline)
 	struct ds_Island *is = slot.address;
 	is->contact_list = dll_Init(struct ds_Contact);
 	is->body_list = dll2_Init(struct ds_RigidBody);
-	is->flags = g_solver_config->sleep_enabled * (ISLAND_AWAKE | ISLAND_SLEEP_RESET);
+	is->flags = pipeline->config.sleep_enabled * (ISLAND_AWAKE | ISLAND_SLEEP_RESET);
 
 	return slot;
 }
@@ -100,12 +100,16 @@ void isdb_PrintIsland(FILE *file, const struct ds_RigidBodyPipeline *pipeline, c
 	fprintf(file, "}\n");
 }
 
-struct isdb isdb_Alloc(struct arena *mem_persistent, const u32 initial_size)
+struct isdb isdb_Alloc(struct arena *mem_persistent, const u32 initial_size, const u32 growable)
 {
 	struct isdb is_db = { 0 };
 
-	is_db.island_pool = ds_PoolAlloc(NULL, initial_size, struct ds_Island, GROWABLE);
+	is_db.island_pool = ds_PoolAlloc(NULL, initial_size, struct ds_Island, growable);
 	is_db.island_list = dll_Init(struct ds_Island);
+	/* stale entries of removed islands may linger until the next split pass, so leave room for twice the islands */
+	is_db.possible_splits = (growable)
+		? stack_u32Alloc(NULL, 64, GROWABLE)
+		: stack_u32Alloc(NULL, 2*is_db.island_pool.length, NOT_GROWABLE);
 
 	return is_db;
 }
@@ -113,19 +117,14 @@ struct isdb isdb_Alloc(struct arena *mem_persistent, const u32 initial_size)
 void isdb_Dealloc(struct isdb *is_db)
 {
 	ds_PoolDealloc(&is_db->island_pool);
+	stack_u32Free(&is_db->possible_splits);
 }
 
 void isdb_Flush(struct isdb *is_db)
 {
-	isdb_ClearFrame(is_db);
 	ds_PoolFlush(&is_db->island_pool);
 	dll_Flush(&is_db->island_list);
-}
-
-void isdb_ClearFrame(struct isdb *is_db)
-{
-	is_db->possible_splits = NULL;
-	is_db->possible_splits_count = 0;
+	stack_u32Flush(&is_db->possible_splits);
 }
 
 void isdb_Validate(const struct ds_RigidBodyPipeline *pipeline)
@@ -246,7 +245,7 @@ void isdb_MergeIslands(struct ds_RigidBodyPipeline *pipeline, const u32 ci, cons
 		struct ds_Island *is_expand = ds_PoolAddress(&pipeline->is_db.island_pool, expand);
 		struct ds_Island *is_merge = ds_PoolAddress(&pipeline->is_db.island_pool, merge);
 
-		if (g_solver_config->sleep_enabled)
+		if (pipeline->config.sleep_enabled)
 		{
 			const u32 island_sleep_interrupted = 1 - ISLAND_AWAKE_BIT(is_merge)*ISLAND_AWAKE_BIT(is_expand)
 						+ ISLAND_TRY_SLEEP_BIT(is_merge) + ISLAND_TRY_SLEEP_BIT(is_expand);
@@ -257,10 +256,16 @@ void isdb_MergeIslands(struct ds_RigidBodyPipeline *pipeline, const u32 ci, cons
 				{
 					PhysicsEventIslandAwake(pipeline, expand);	
 				}
-				is_expand->flags = ISLAND_AWAKE | ISLAND_SLEEP_RESET;
+				is_expand->flags = ISLAND_AWAKE | ISLAND_SLEEP_RESET | (is_expand->flags & ISLAND_SPLIT);
 			}
 		}
 
+		/* A pending split of the merged island is inherited by the expanded island */
+		if (ISLAND_SPLIT_BIT(is_merge))
+		{
+			isdb_SplitIslandDefer(&pipeline->is_db, expand);
+		}
+
 		struct ds_Contact *contact_new = nll_Address(&pipeline->cdb->contact_net, ci);
 		if (is_expand->contact_list.count == 0)
 		{
@@ -328,6 +333,9 @@ void isdb_SplitIsland(struct arena *mem_tmp, struct ds_RigidBodyPipeline *pipeli
 	ArenaPushRecord(mem_tmp);
 
 	struct ds_Island *split_island = ds_PoolAddress(&pipeline->is_db.island_pool, island_to_split);
+	/* A deferred split of an island about to sleep keeps the sleep timers of its bodies, so that
+	 * the new islands may fall asleep without having to accumulate low velocity time again. */
+	const u32 keep_sleep_timers = pipeline->config.split_deferred && ISLAND_TRY_SLEEP_BIT(split_island);
 	//isdb_PrintIsland(stderr, pipeline, island_to_split, "To Split");
 	u32 *body_stack = ArenaPush(mem_tmp, split_island->body_list.count*sizeof(u32));
 	u32 sc;
@@ -338,6 +346,7 @@ void isdb_SplitIsland(struct arena *mem_tmp, struct ds_RigidBodyPipeline *pipeli
 		ds_Assert(body_last->island_index == island_to_split);
 		struct slot slot = isdb_IslandEmpty(pipeline);
 		struct ds_Island *new_island = slot.address;
+		new_island->flags &= ~(keep_sleep_timers * ISLAND_SLEEP_RESET);
 		split_island = ds_PoolAddress(&pipeline->is_db.island_pool, island_to_split);
         /* Note: we set this manually here as to skip the check 
          * neighbour_island == island_to_split for the body */
@@ -357,8 +366,6 @@ void isdb_SplitIsland(struct arena *mem_tmp, struct ds_RigidBodyPipeline *pipeli
                 while (ci != NLL_NULL)
                 {
 		    		const struct ds_Contact *c = nll_Address(&pipeline->cdb->contact_net, ci);
-		    		ds_Assert(ci >= pipeline->cdb->contact_frame_usage.bit_count 
-		    				||  BitVecGetBit(&pipeline->cdb->contact_frame_usage, ci) == 1)
 
                     u32 neighbour_index;
                     if (bi_cur == c->key.body0)
@@ -398,17 +405,14 @@ void isdb_SplitIsland(struct arena *mem_tmp, struct ds_RigidBodyPipeline *pipeli
 	{
 	    c = nll_Address(&pipeline->cdb->contact_net, i);
 		next = dll_Next(c);
-		if (i >= pipeline->cdb->contact_frame_usage.bit_count || BitVecGetBit(&pipeline->cdb->contact_frame_usage, i) == 1)
-		{
-			const struct ds_RigidBody *body0 = ds_PoolAddress(&pipeline->body_pool, c->key.body0);
-			const struct ds_RigidBody *body1 = ds_PoolAddress(&pipeline->body_pool, c->key.body1);
-			const u32 island0 = body0->island_index;
-			const u32 island1 = body1->island_index;
-			struct ds_Island *is = (island0 != ISLAND_STATIC)
-				? ds_PoolAddress(&pipeline->is_db.island_pool, island0)
-				: ds_PoolAddress(&pipeline->is_db.island_pool, island1);
-			dll_Append(&is->contact_list, pipeline->cdb->contact_net.pool.buf, i);
-		}
+		const struct ds_RigidBody *body0 = ds_PoolAddress(&pipeline->body_pool, c->key.body0);
+		const struct ds_RigidBody *body1 = ds_PoolAddress(&pipeline->body_pool, c->key.body1);
+		const u32 island0 = body0->island_index;
+		const u32 island1 = body1->island_index;
+		struct ds_Island *is = (island0 != ISLAND_STATIC)
+			? ds_PoolAddress(&pipeline->is_db.island_pool, island0)
+			: ds_PoolAddress(&pipeline->is_db.island_pool, island1);
+		dll_Append(&is->contact_list, pipeline->cdb->contact_net.pool.buf, i);
 	}
 
 	isdb_IslandRemove(pipeline, split_island);
@@ -416,12 +420,457 @@ void isdb_SplitIsland(struct arena *mem_tmp, struct ds_RigidBodyPipeline *pipeli
     ProfZoneEnd;
 }
 
+void isdb_SplitIslandDefer(struct isdb *is_db, const u32 island)
+{
+	struct ds_Island *is = ds_PoolAddress(&is_db->island_pool, island);
+	if (!(is->flags & ISLAND_SPLIT))
+	{
+		is->flags |= ISLAND_SPLIT;
+		stack_u32Push(&is_db->possible_splits, island);
+	}
+}
+
+void isdb_SplitPendingIslands(struct ds_RigidBodyPipeline *pipeline)
+{
+	ProfZone;
+
+	struct isdb *is_db = &pipeline->is_db;
+	if (is_db->possible_splits.next == 0)
+	{
+		ProfZoneEnd;
+		return;
+	}
+
+	struct arena tmp = ArenaAlloc1MB();
+	u32 budget = pipeline->config.split_body_budget;
+	u32 pending_count = 0;
+	/* TODO: Parallelize island splitting */
+	for (u32 i = 0; i < is_db->possible_splits.next; ++i)
+	{
+		const u32 island = is_db->possible_splits.arr[i];
+		const struct ds_Island *is = ds_PoolAddress(&is_db->island_pool, island);
+		if (!PoolSlotAllocated(is) || !(is->flags & ISLAND_SPLIT))
+		{
+			continue;
+		}
+
+		/* 
+		 * Islands about to fall asleep must be split, otherwise disconnected bodies would sleep
+		 * and wake as a single unit. Other islands are split as long as any budget remains, so
+		 * a non-zero budget always makes progress.
+		 */
+		if (!pipeline->config.split_deferred || ISLAND_TRY_SLEEP_BIT(is) || budget)
+		{
+			budget = (is->body_list.count < budget) ? budget - is->body_list.count : 0;
+			isdb_SplitIsland(&tmp, pipeline, island);
+		}
+		else
+		{
+			is_db->possible_splits.arr[pending_count++] = island;
+		}
+	}
+	PoisonAddress(is_db->possible_splits.arr + pending_count, (is_db->possible_splits.next - pending_count)*sizeof(u32));
+	is_db->possible_splits.next = pending_count;
+	ArenaFree1MB(&tmp);
+
+	ProfZoneEnd;
+}
+
+/*
+ * Lock-free union-find over body indices. A root is only ever linked below a root of lower index, so 
+ * parent[x] <= x always holds and the final root of a set is its minimum body index, independent of 
+ * the order in which threads perform unions. 
+ */
+static u32 UnionFindRoot(u32 *parent, u32 x)
+{
+	u32 p = AtomicLoadRlx32(parent + x);
+	while (p != x)
+	{
+		/* path halving; a failed exchange only means some other thread already shortened the path */
+		u32 gp = AtomicLoadRlx32(parent + p);
+		if (gp != p)
+		{
+			u32 expected = p;
+			AtomicCompareExchangeRlxRlx32(parent + x, &expected, gp);
+		}
+		x = p;
+		p = AtomicLoadRlx32(parent + x);
+	}
+
+	return x;
+}
+
+static void UnionFindUnite(u32 *parent, u32 a, u32 b)
+{
+	while (1)
+	{
+		a = UnionFindRoot(parent, a);
+		b = UnionFindRoot(parent, b);
+		if (a == b)
+		{
+			return;
+		}
+
+		if (a < b)
+		{
+			const u32 tmp = a;
+			a = b;
+			b = tmp;
+		}
+
+		u32 expected = a;
+		if (AtomicCompareExchangeRlxRlx32(parent + a, &expected, b))
+		{
+			return;
+		}
+	}
+}
+
+struct isdb_UnionInput
+{
+	struct ds_RigidBodyPipeline *	pipeline;
+	u32 *				parent;
+};
+
+static void ThreadIslandUnion(void *task_addr)
+{
+	ProfZone;
+
+	struct task *task = task_addr;
+	const struct isdb_UnionInput *in = task->input;
+	const u32 *contacts = task->range->base;
+	for (u64 i = 0; i < task->range->count; ++i)
+	{
+		const struct ds_Contact *c = nll_Address(&in->pipeline->cdb->contact_net, contacts[i]);
+		const struct ds_RigidBody *b0 = ds_PoolAddress(&in->pipeline->body_pool, c->key.body0);
+		const struct ds_RigidBody *b1 = ds_PoolAddress(&in->pipeline->body_pool, c->key.body1);
+		if (b0->island_index != ISLAND_STATIC && b1->island_index != ISLAND_STATIC)
+		{
+			UnionFindUnite(in->parent, c->key.body0, c->key.body1);
+		}
+	}
+
+	ProfZoneEnd;
+}
+
+void isdb_RebuildIslands(struct ds_RigidBodyPipeline *pipeline)
+{
+	ProfZone;
+
+	struct isdb *is_db = &pipeline->is_db;
+	struct cdb *cdb = pipeline->cdb;
+	struct arena *mem = &pipeline->frame;
+	const u32 sleep_enabled = pipeline->config.sleep_enabled;
+
+	/* 
+	 * (1) New contacts between distinct islands wake any sleeping island; new contacts that stay within a 
+	 * sleeping island (or between a sleeping island and a static body) are linked immediately, since 
+	 * only awake islands are rebuilt. Linking waits until every wake is resolved, as a later new contact 
+	 * may wake the island, which then gathers the contact from its list and again as a new contact.
+	 */
+	for (u32 i = 0; i < cdb->contact_new_count; ++i)
+	{
+		const struct ds_Contact *c = nll_Address(&cdb->contact_net, cdb->contact_new[i]);
+		const struct ds_RigidBody *body0 = ds_PoolAddress(&pipeline->body_pool, c->key.body0);
+		const struct ds_RigidBody *body1 = ds_PoolAddress(&pipeline->body_pool, c->key.body1);
+		const u32 is0 = body0->island_index;
+		const u32 is1 = body1->island_index;
+		if (is0 != ISLAND_STATIC && is1 != ISLAND_STATIC && is0 != is1)
+		{
+			const u32 island[2] = { is0, is1 };
+			for (u32 j = 0; j < 2; ++j)
+			{
+				struct ds_Island *is = ds_PoolAddress(&is_db->island_pool, island[j]);
+				if (sleep_enabled && !ISLAND_AWAKE_BIT(is))
+				{
+					PhysicsEventIslandAwake(pipeline, island[j]);	
+					is->flags = ISLAND_AWAKE | ISLAND_SLEEP_RESET;
+				}
+			}
+		}
+	}
+
+	for (u32 i = 0; sleep_enabled && i < cdb->contact_new_count; ++i)
+	{
+		const struct ds_Contact *c = nll_Address(&cdb->contact_net, cdb->contact_new[i]);
+		const struct ds_RigidBody *body0 = ds_PoolAddress(&pipeline->body_pool, c->key.body0);
+		const struct ds_RigidBody *body1 = ds_PoolAddress(&pipeline->body_pool, c->key.body1);
+		const u32 is0 = body0->island_index;
+		const u32 is1 = body1->island_index;
+		if (is0 == ISLAND_STATIC || is1 == ISLAND_STATIC || is0 == is1)
+		{
+			const u32 island = (is0 != ISLAND_STATIC) ? is0 : is1;
+			struct ds_Island *is = ds_PoolAddress(&is_db->island_pool, island);
+			if (!ISLAND_AWAKE_BIT(is))
+			{
+				dll_Append(&is->contact_list, cdb->contact_net.pool.buf, cdb->contact_new[i]);
+			}
+		}
+	}
+
+	/* (2) Gather awake islands, their bodies and contacts, and any new contacts between awake bodies */
+	u32 island_count = 0;
+	u32 body_count = 0;
+	u32 contact_count = 0;
+	struct ds_Island *is = NULL;
+	for (u32 i = is_db->island_list.first; i != DLL_NULL; i = dll_Next(is))
+	{
+		is = ds_PoolAddress(&is_db->island_pool, i);
+		if (!sleep_enabled || ISLAND_AWAKE_BIT(is))
+		{
+			island_count += 1;
+			body_count += is->body_list.count;
+			contact_count += is->contact_list.count;
+		}
+	}
+
+	u32 *islands = ArenaPush(mem, island_count*sizeof(u32));
+	u32 *bodies = ArenaPush(mem, body_count*sizeof(u32));
+	u32 *contacts = ArenaPush(mem, (contact_count + cdb->contact_new_count)*sizeof(u32));
+	u32 *parent = ArenaPush(mem, pipeline->body_pool.count_max*sizeof(u32));
+	if ((island_count && !islands) || (body_count && !bodies) || !parent 
+			|| ((contact_count + cdb->contact_new_count) && !contacts))
+	{
+		LogString(T_PHYSICS, S_FATAL, "Frame arena OOM in isdb_RebuildIslands, increase size!");
+		FatalCleanupAndExit();
+	}
+
+	island_count = 0;
+	body_count = 0;
+	contact_count = 0;
+	for (u32 i = is_db->island_list.first; i != DLL_NULL; i = dll_Next(is))
+	{
+		is = ds_PoolAddress(&is_db->island_pool, i);
+		if (!sleep_enabled || ISLAND_AWAKE_BIT(is))
+		{
+			islands[island_count++] = i;
+
+			const struct ds_RigidBody *b;
+			for (u32 j = is->body_list.first; j != DLL_NULL; j = dll2_Next(b))
+			{
+				b = ds_PoolAddress(&pipeline->body_pool, j);
+				bodies[body_count++] = j;
+				parent[j] = j;
+			}
+
+			const struct ds_Contact *c;
+			for (u32 j = is->contact_list.first; j != DLL_NULL; j = dll_Next(c))
+			{
+				c = nll_Address(&cdb->contact_net, j);
+				contacts[contact_count++] = j;
+			}
+		}
+	}
+
+	for (u32 i = 0; i < cdb->contact_new_count; ++i)
+	{
+		const struct ds_Contact *c = nll_Address(&cdb->contact_net, cdb->contact_new[i]);
+		const struct ds_RigidBody *body0 = ds_PoolAddress(&pipeline->body_pool, c->key.body0);
+		const struct ds_RigidBody *body1 = ds_PoolAddress(&pipeline->body_pool, c->key.body1);
+		const u32 island = (body0->island_index != ISLAND_STATIC) ? body0->island_index : body1->island_index;
+		is = ds_PoolAddress(&is_db->island_pool, island);
+		if (!sleep_enabled || ISLAND_AWAKE_BIT(is))
+		{
+			contacts[contact_count++] = cdb->contact_new[i];
+		}
+	}
+
+	/* (3) Parallel union over dynamic-dynamic contacts */
+	{
+		ProfZoneNamed("IslandUnion");
+		struct isdb_UnionInput args = { .pipeline = pipeline, .parent = parent };
+		task_parallel_for(mem, ThreadIslandUnion, contacts, contact_count, sizeof(u32), 64, &args);
+		ProfZoneEnd;
+	}
+
+	/* 
+	 * (4) Compaction: map roots to dense island indices and group bodies and contacts contiguously per 
+	 * island. Since the parent array is no longer needed once all roots are found, it is reused as 
+	 * the root => rebuilt island map.
+	 */
+	u32 *body_root = ArenaPush(mem, body_count*sizeof(u32));
+	u32 *contact_root = ArenaPush(mem, contact_count*sizeof(u32));
+	if ((body_count && !body_root) || (contact_count && !contact_root))
+	{
+		LogString(T_PHYSICS, S_FATAL, "Frame arena OOM in isdb_RebuildIslands, increase size!");
+		FatalCleanupAndExit();
+	}
+
+	for (u32 i = 0; i < body_count; ++i)
+	{
+		body_root[i] = UnionFindRoot(parent, bodies[i]);
+	}
+
+	for (u32 i = 0; i < contact_count; ++i)
+	{
+		const struct ds_Contact *c = nll_Address(&cdb->contact_net, contacts[i]);
+		const struct ds_RigidBody *body0 = ds_PoolAddress(&pipeline->body_pool, c->key.body0);
+		contact_root[i] = (body0->island_index != ISLAND_STATIC)
+			? UnionFindRoot(parent, c->key.body0)
+			: UnionFindRoot(parent, c->key.body1);
+	}
+
+	u32 count = 0;
+	for (u32 i = 0; i < body_count; ++i)
+	{
+		if (body_root[i] == bodies[i])
+		{
+			parent[bodies[i]] = count++;
+		}
+	}
+
+	/* rebuilt island i owns island_bodies[body_offset[i], body_offset[i+1]) and likewise for contacts */
+	u32 *rebuilt_island = ArenaPush(mem, count*sizeof(u32));
+	u32 *island_bodies = ArenaPush(mem, body_count*sizeof(u32));
+	u32 *island_contacts = ArenaPush(mem, contact_count*sizeof(u32));
+	u32 *body_offset = ArenaPushZero(mem, (count + 1)*sizeof(u32));
+	u32 *contact_offset = ArenaPushZero(mem, (count + 1)*sizeof(u32));
+	u32 *cursor = ArenaPush(mem, count*sizeof(u32));
+	u32 *flags = ArenaPushZero(mem, count*sizeof(u32));
+	u32 *changed = ArenaPushZero(mem, count*sizeof(u32));	/* set if body set differs from candidate island */
+	if ((count && (!rebuilt_island || !cursor || !flags || !changed))
+			|| (body_count && !island_bodies) 
+			|| (contact_count && !island_contacts) 
+			|| !body_offset || !contact_offset)
+	{
+		LogString(T_PHYSICS, S_FATAL, "Frame arena OOM in isdb_RebuildIslands, increase size!");
+		FatalCleanupAndExit();
+	}
+
+	for (u32 i = 0; i < count; ++i)
+	{
+		rebuilt_island[i] = ISLAND_NULL;
+	}
+
+	/* 
+	 * Each rebuilt island is a candidate for reusing the persistent island of its first body. If the 
+	 * rebuilt island consists of bodies from several old islands (merge), the sleep state of the 
+	 * constituent islands is combined as in isdb_MergeIslands; if it is a strict subset of the candidate
+	 * island (split), its sleep timers are reset as in isdb_SplitIsland. 
+	 */
+	for (u32 i = 0; i < body_count; ++i)
+	{
+		const u32 k = parent[body_root[i]];
+		const struct ds_RigidBody *b = ds_PoolAddress(&pipeline->body_pool, bodies[i]);
+		if (rebuilt_island[k] == ISLAND_NULL)
+		{
+			rebuilt_island[k] = b->island_index;
+		}
+		else if (rebuilt_island[k] != b->island_index)
+		{
+			changed[k] = 1;
+		}
+		is = ds_PoolAddress(&is_db->island_pool, b->island_index);
+		flags[k] |= is->flags;
+		body_offset[k + 1] += 1;
+	}
+
+	for (u32 i = 0; i < contact_count; ++i)
+	{
+		contact_offset[parent[contact_root[i]] + 1] += 1;
+	}
+
+	for (u32 i = 0; i < count; ++i)
+	{
+		body_offset[i + 1] += body_offset[i];
+		contact_offset[i + 1] += contact_offset[i];
+
+		is = ds_PoolAddress(&is_db->island_pool, rebuilt_island[i]);
+		const u32 island_body_count = body_offset[i + 1] - body_offset[i];
+		if (changed[i])
+		{
+			flags[i] = sleep_enabled * (ISLAND_AWAKE | ((flags[i] & ISLAND_TRY_SLEEP) 
+				? ISLAND_SLEEP_RESET 
+				: (flags[i] & ISLAND_SLEEP_RESET)));
+		}
+		else if (island_body_count != is->body_list.count)
+		{
+			/* island was split */
+			flags[i] = sleep_enabled * (ISLAND_AWAKE | ISLAND_SLEEP_RESET);
+			changed[i] = 1;
+		}
+		else
+		{
+			flags[i] &= ~ISLAND_SPLIT;
+		}
+	}
+
+	for (u32 i = 0; i < count; ++i)
+	{
+		cursor[i] = body_offset[i];
+	}
+
+	for (u32 i = 0; i < body_count; ++i)
+	{
+		island_bodies[cursor[parent[body_root[i]]]++] = bodies[i];
+	}
+
+	for (u32 i = 0; i < count; ++i)
+	{
+		cursor[i] = contact_offset[i];
+	}
+
+	for (u32 i = 0; i < contact_count; ++i)
+	{
+		island_contacts[cursor[parent[contact_root[i]]]++] = contacts[i];
+	}
+
+	/* (5) Rebuild persistent islands, reusing the candidate island when it has not been claimed already */
+	u32 *claimed = ArenaPushZero(mem, is_db->island_pool.count_max*sizeof(u32));
+	for (u32 i = 0; i < count; ++i)
+	{
+		u32 island = rebuilt_island[i];
+		if (!claimed[island])
+		{
+			claimed[island] = 1;
+			is = ds_PoolAddress(&is_db->island_pool, island);
+			dll_Flush(&is->body_list);
+			dll_Flush(&is->contact_list);
+			if (changed[i])
+			{
+				PhysicsEventIslandExpanded(pipeline, island);
+			}
+		}
+		else
+		{
+			struct slot slot = isdb_IslandEmpty(pipeline);
+			island = slot.index;
+			is = slot.address;
+		}
+
+		is->flags = flags[i];
+		rebuilt_island[i] = island;
+		for (u32 j = body_offset[i]; j < body_offset[i + 1]; ++j)
+		{
+			isdb_AddBodyToIsland(pipeline, is, island_bodies[j]);
+		}
+
+		for (u32 j = contact_offset[i]; j < contact_offset[i + 1]; ++j)
+		{
+			dll_Append(&is->contact_list, cdb->contact_net.pool.buf, island_contacts[j]);
+		}
+	}
+
+	for (u32 i = 0; i < island_count; ++i)
+	{
+		if (!claimed[islands[i]])
+		{
+			isdb_IslandRemove(pipeline, ds_PoolAddress(&is_db->island_pool, islands[i]));
+		}
+	}
+
+	/* All awake islands are rebuilt, so any pending split has now been resolved */
+	stack_u32Flush(&is_db->possible_splits);
+
+	ProfZoneEnd;
+}
+
 /* TODO name and place somewhere reasonable.... */
 static void IntegrateOrientationVelocities(struct ds_Island *is, struct solver *solver, const u32 i)
 {
     /* update velocity and world center of mass */
-    const f32 div_linear = Vec3Length(solver->linear_velocity[i]) * g_solver_config->max_linear_velocity_magnitude_inv;
-    const f32 div_angular = Vec3Length(solver->angular_velocity[i]) * g_solver_config->max_angular_velocity_magnitude_inv;
+    const f32 div_linear = Vec3Length(solver->linear_velocity[i]) * solver->config->max_linear_velocity_magnitude_inv;
+    const f32 div_angular = Vec3Length(solver->angular_velocity[i]) * solver->config->max_angular_velocity_magnitude_inv;
     const f32 t_linear = 1.0f / f32_clamp(div_linear, 1.0f, F32_INFINITY);
     const f32 t_angular = 1.0f / f32_clamp(div_angular, 1.0f, F32_INFINITY);
 
@@ -442,6 +891,54 @@ static void IntegrateOrientationVelocities(struct ds_Island *is, struct solver *
 	QuatNormalize(solver->rotation[i]);
 }
 
+static void StoreVelocities(struct ds_Island *is, const struct solver *solver, const u32 i)
+{
+	struct ds_RigidBody *b = is->bodies[i];
+	Vec3Copy(b->velocity, solver->linear_velocity[i]);	
+	Vec3Copy(b->angular_velocity, solver->angular_velocity[i]);	
+}
+
+/* 
+ * Sub-stepped (TGS style) island solve: each of the substep_count sub-steps integrates velocities, warms up
+ * with the previous sub-step's impulses, solves the contacts with a position bias, integrates positions and 
+ * finally relaxes the velocities without the bias. Contact manifolds from the tick's single collision 
+ * detection pass are reused in every sub-step through the current separation of the contact points; the 
+ * contact levers and effective masses follow the bodies' rotations after every position integration.
+ */
+static struct solver *IslandSolveSubsteps(struct arena *mem_frame, const struct ds_RigidBodyPipeline *pipeline, struct ds_Island *is, const f32 timestep)
+{
+	const u32 substep_count = pipeline->config.substep_count;
+	/* spread the velocity iterations over the sub-steps */
+	const u32 iteration_count = (pipeline->config.pgs_iteration_count + substep_count - 1) / substep_count;
+	struct solver *solver = SolverInitBodyData(mem_frame, &pipeline->config, is, timestep / substep_count);
+	SolverInitVelocityConstraints(mem_frame, solver, pipeline, is);
+
+	if (pipeline->config.warmup_solver)
+	{
+		SolverWarmup(solver, is);
+	}
+	SolverInitSubstepConstraints(solver);
+
+	for (u32 i = 0; i < substep_count; ++i)
+	{
+		if (i)
+		{
+			SolverIntegrateVelocities(solver);
+			SolverWarmupSubstep(solver);
+		}
+
+		for (u32 j = 0; j < iteration_count; ++j)
+		{
+			SolverIterateSubstepConstraints(solver, 1);
+		}
+		SolverIntegratePositions(solver);
+		SolverUpdateSubstepConstraints(solver);
+		SolverIterateSubstepConstraints(solver, 0);
+	}
+
+	return solver;
+}
+
 static void UpdateOrientation(struct ds_Island *is, const struct solver *solver, const u32 i)
 {
 	struct ds_RigidBody *b = is->bodies[i];
@@ -455,6 +952,91 @@ static void UpdateOrientation(struct ds_Island *is, const struct solver *solver,
     Vec3Sub(b->t_world.position, solver->w_center_of_mass[i], rotated_local_center_of_mass);
 }
 
+/* 
+ * Island solves run on frame-local copies of the island's bodies and contacts, so that the solver loops scan 
+ * linear memory instead of chasing pool slots. Only the fields the solver touches are copied: the *Solved 
+ * copies list the fields the solver writes, and are shared between IslandCompact and IslandWriteBack; the 
+ * remaining compacted fields are read-only inputs.
+ */
+static void IslandBodyCopySolved(struct ds_RigidBody *dst, const struct ds_RigidBody *src)
+{
+	dst->flags = src->flags;
+	dst->t_world = src->t_world;
+	Vec3Copy(dst->velocity, src->velocity);
+	Vec3Copy(dst->angular_velocity, src->angular_velocity);
+	dst->low_velocity_time = src->low_velocity_time;
+}
+
+static void IslandContactCopySolved(struct ds_Contact *dst, const struct ds_Contact *src)
+{
+	dst->cached_count = src->cached_count;
+	Vec3Copy(dst->normal_cache, src->normal_cache);
+	Vec3Copy(dst->tangent_cache[0], src->tangent_cache[0]);
+	Vec3Copy(dst->tangent_cache[1], src->tangent_cache[1]);
+	for (u32 j = 0; j < src->cached_count; ++j)
+	{
+		Vec3Copy(dst->r1_cache[j], src->r1_cache[j]);
+		Vec3Copy(dst->r2_cache[j], src->r2_cache[j]);
+		dst->normal_impulse_cache[j] = src->normal_impulse_cache[j];
+		dst->tangent_impulse_cache[j][0] = src->tangent_impulse_cache[j][0];
+		dst->tangent_impulse_cache[j][1] = src->tangent_impulse_cache[j][1];
+	}
+}
+
+/* 
+ * Compact the island's bodies and contacts and repoint is->bodies and is->contacts at the copies. 
+ * contact_indices receives the contact_net index of each copied contact for the later write back.
+ */
+static void IslandCompact(struct arena *mem_frame, struct ds_RigidBodyPipeline *pipeline, struct ds_Island *is, u32 *contact_indices)
+{
+	struct ds_RigidBody *body_data = ArenaPush(mem_frame, is->body_list.count * sizeof(struct ds_RigidBody));
+	struct ds_Contact *contact_data = ArenaPush(mem_frame, is->contact_list.count * sizeof(struct ds_Contact));
+
+	for (u32 i = 0; i < is->body_list.count; ++i)
+	{
+		struct ds_RigidBody *src = is->bodies[i];
+		struct ds_RigidBody *dst = body_data + i;
+		IslandBodyCopySolved(dst, src);
+		Vec3Copy(dst->local_center_of_mass, src->local_center_of_mass);
+		Mat3Copy(dst->inv_inertia_tensor, src->inv_inertia_tensor);
+		dst->mass = src->mass;
+		is->bodies[i] = dst;
+	}
+
+	u32 k = is->contact_list.first;
+	for (u32 i = 0; i < is->contact_list.count; ++i)
+	{
+		const struct ds_Contact *src = nll_Address(&pipeline->cdb->contact_net, k);
+		struct ds_Contact *dst = contact_data + i;
+		IslandContactCopySolved(dst, src);
+		dst->key = src->key;
+		dst->cm.v_count = src->cm.v_count;
+		Vec3Copy(dst->cm.n, src->cm.n);
+		for (u32 j = 0; j < src->cm.v_count; ++j)
+		{
+			Vec3Copy(dst->cm.v[j], src->cm.v[j]);
+			dst->cm.depth[j] = src->cm.depth[j];
+		}
+		contact_indices[i] = k;
+		is->contacts[i] = dst;
+ 		k = src->dll_next;
+	}
+}
+
+/* Write the solver results of compacted bodies and contacts back to their persistent slots */
+static void IslandWriteBack(struct ds_RigidBodyPipeline *pipeline, const struct ds_Island *is, const u32 *body_indices, const u32 *contact_indices)
+{
+	for (u32 i = 0; i < is->body_list.count; ++i)
+	{
+		IslandBodyCopySolved(ds_PoolAddress(&pipeline->body_pool, body_indices[i]), is->bodies[i]);
+	}
+
+	for (u32 i = 0; i < is->contact_list.count; ++i)
+	{
+		IslandContactCopySolved(nll_Address(&pipeline->cdb->contact_net, contact_indices[i]), is->contacts[i]);
+	}
+}
+
 static u32 *IslandSolve(struct arena *mem_frame, struct ds_RigidBodyPipeline *pipeline, struct ds_Island *is, u32 *asleep, const f32 timestep)
 {
 	u32 *bodies_simulated = ArenaPush(mem_frame, is->body_list.count*sizeof(u32));
@@ -476,8 +1058,9 @@ static u32 *IslandSolve(struct arena *mem_frame, struct ds_RigidBodyPipeline *pi
 		k = b->dll2_next;
 	}
 
-	if (g_solver_config->sleep_enabled && ISLAND_TRY_SLEEP_BIT(is))
+	if (pipeline->config.sleep_enabled && ISLAND_TRY_SLEEP_BIT(is))
 	{
+		ds_AssertString(!ISLAND_SPLIT_BIT(is), "Island pending split should be split before falling asleep");
 		is->flags = 0;
 		for (u32 i = 0; i < is->body_list.count; ++i)
 		{
@@ -489,36 +1072,43 @@ static u32 *IslandSolve(struct arena *mem_frame, struct ds_RigidBodyPipeline *pi
 	/* Island low energy state was interrupted, or island is simply awake */
 	else
 	{
-		k = is->contact_list.first;
-		for (u32 i = 0; i < is->contact_list.count; ++i)
-		{
-			is->contacts[i] = nll_Address(&pipeline->cdb->contact_net, k);
- 			k = is->contacts[i]->dll_next;
-		}
+		u32 *contact_indices = ArenaPush(mem_frame, is->contact_list.count * sizeof(u32));
+		IslandCompact(mem_frame, pipeline, is, contact_indices);
 
-		/* init solver and velocity constraints */
-		struct solver *solver = SolverInitBodyData(mem_frame, is, timestep);
-		SolverInitVelocityConstraints(mem_frame, solver, pipeline, is);
-		
-		if (g_solver_config->warmup_solver)
+		const u32 substep = (pipeline->config.substep_count > 1);
+		struct solver *solver = NULL;
+		if (substep)
 		{
-			SolverWarmup(solver, is);
+			solver = IslandSolveSubsteps(mem_frame, pipeline, is, timestep);
 		}
-
-		for (u32 i = 0; i < g_solver_config->pgs_iteration_count; ++i)
+		else
 		{
-			SolverIterateVelocityConstraints(solver);
+			/* init solver and velocity constraints */
+			solver = SolverInitBodyData(mem_frame, &pipeline->config, is, timestep);
+			SolverInitVelocityConstraints(mem_frame, solver, pipeline, is);
+			
+			if (pipeline->config.warmup_solver)
+			{
+				SolverWarmup(solver, is);
+			}
+
+			for (u32 i = 0; i < pipeline->config.pgs_iteration_count; ++i)
+			{
+				SolverIterateVelocityConstraints(solver);
+			}
 		}
 
 		SolverCacheImpulse(solver, is);
 
 		/* integrate final solver velocities and update bodies and find lowest low_velocity time */
-		if (g_solver_config->sleep_enabled)
+		if (pipeline->config.sleep_enabled)
 		{
 			f32 min_low_velocity_time = F32_MAX_POSITIVE_NORMAL;
 			for (u32 i = 0; i < is->body_list.count; ++i)
 			{
-                IntegrateOrientationVelocities(is, solver, i);
+                (substep)
+					? StoreVelocities(is, solver, i)
+					: IntegrateOrientationVelocities(is, solver, i);
 
 				/* Always set RB_AWAKE, if island should sleep, we set it later,
 				 * but the bodies may come in sleeping if island just woke up 
@@ -528,7 +1118,7 @@ static u32 *IslandSolve(struct arena *mem_frame, struct ds_RigidBodyPipeline *pi
 				b->low_velocity_time = (1-ISLAND_SLEEP_RESET_BIT(is)) * b->low_velocity_time;
 				const f32 lv_sq = Vec3Dot(b->velocity, b->velocity);
 				const f32 av_sq = Vec3Dot(b->angular_velocity, b->angular_velocity);
-				if (lv_sq <= g_solver_config->sleep_linear_velocity_sq_limit && av_sq <= g_solver_config->sleep_angular_velocity_sq_limit)
+				if (lv_sq <= pipeline->config.sleep_linear_velocity_sq_limit && av_sq <= pipeline->config.sleep_angular_velocity_sq_limit)
 				{
 					b->low_velocity_time += timestep;
 				}
@@ -536,7 +1126,7 @@ static u32 *IslandSolve(struct arena *mem_frame, struct ds_RigidBodyPipeline *pi
 			}
 
 			is->flags &= ~ISLAND_SLEEP_RESET;
-			if (g_solver_config->sleep_time_threshold <= min_low_velocity_time)
+			if (pipeline->config.sleep_time_threshold <= min_low_velocity_time)
 			{
 				is->flags |= ISLAND_TRY_SLEEP;
 			}
@@ -546,24 +1136,32 @@ static u32 *IslandSolve(struct arena *mem_frame, struct ds_RigidBodyPipeline *pi
 		{
 			for (u32 i = 0; i < is->body_list.count; ++i)
 			{
-                IntegrateOrientationVelocities(is, solver, i);
+                (substep)
+					? StoreVelocities(is, solver, i)
+					: IntegrateOrientationVelocities(is, solver, i);
 			}
 		}
 
-        SolverInitPositionConstraints(solver, is); 
-        for (u32 i = 0; i < g_solver_config->ngs_iteration_count; ++i)
+		/* sub-stepping has already resolved penetration within its sub-steps */
+		if (!substep)
 		{
-			const u32 contacts_okay = SolverIteratePositionConstraints(solver);
-            if (contacts_okay)
-            {
-                break;
-            }
+        	SolverInitPositionConstraints(solver, is); 
+        	for (u32 i = 0; i < pipeline->config.ngs_iteration_count; ++i)
+			{
+				const u32 contacts_okay = SolverIteratePositionConstraints(solver);
+        	    if (contacts_okay)
+        	    {
+        	        break;
+        	    }
+			}
 		}
 
         for (u32 i = 0; i < is->body_list.count; ++i)
 	    {
             UpdateOrientation(is, solver, i);
 	    }
+
+		IslandWriteBack(pipeline, is, bodies_simulated, contact_indices);
 	} 
 
 	ArenaPopRecord(mem_frame);
@@ -580,5 +1178,11 @@ void ThreadIslandSolve(void *task_input)
 	args->out->island_asleep = 0;
 	args->out->bodies = IslandSolve(&t_ctx->executor->mem_frame, args->pipeline, args->is, &args->out->island_asleep, args->timestep);
 
+	for (u32 i = 0; i < args->out->body_count; ++i)
+	{
+		const struct ds_RigidBody *body = ds_PoolAddress(&args->pipeline->body_pool, args->out->bodies[i]);
+		PhysicsPipelineBodyEventPush(args->pipeline, ((u64) body->tag << 32) | args->out->bodies[i]);
+	}
+
 	ProfZoneEnd;
 }
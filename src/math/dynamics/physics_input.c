@@ -0,0 +1,187 @@
+/*
+==========================================================================
+    Copyright (C) 2026 Axel Sandstedt
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+==========================================================================
+*/
+
+#include "dynamics.h"
+
+struct ds_PhysicsInputLog PhysicsInputLogAlloc(const u32 initial_count)
+{
+	struct ds_PhysicsInputLog log =
+	{
+		.input = VectorAlloc(NULL, sizeof(struct ds_PhysicsInput), initial_count, GROWABLE),
+		.next = 0,
+	};
+
+	if (!log.input.data)
+	{
+		LogString(T_PHYSICS, S_FATAL, "Failed to allocate physics input log");
+		FatalCleanupAndExit();
+	}
+
+	return log;
+}
+
+void PhysicsInputLogFree(struct ds_PhysicsInputLog *log)
+{
+	VectorDealloc(&log->input);
+}
+
+void PhysicsInputLogFlush(struct ds_PhysicsInputLog *log)
+{
+	VectorFlush(&log->input);
+	log->next = 0;
+}
+
+static struct ds_PhysicsInput *PhysicsInputPush(struct ds_PhysicsInputLog *log, const struct ds_RigidBodyPipeline *pipeline, const enum physicsInputType type)
+{
+	ds_AssertString(pipeline->async_stream == NULL, "Fence any in-flight ticks before applying inputs");
+
+	/* recording after a seek rewrites the log from the cursor on */
+	log->input.next = log->next;
+	struct ds_PhysicsInput *input = VectorPush(&log->input).address;
+	if (!input)
+	{
+		LogString(T_PHYSICS, S_FATAL, "Failed to grow physics input log");
+		FatalCleanupAndExit();
+	}
+
+	input->frame = pipeline->frames_completed;
+	input->type = type;
+	log->next = log->input.next;
+	return input;
+}
+
+ds_RigidBodyId PhysicsInputBodyAdd(struct ds_PhysicsInputLog *log, struct ds_RigidBodyPipeline *pipeline, const struct ds_RigidBodyPrefab *prefab, const ds_Transform *t_world, const u32 entity)
+{
+	struct ds_PhysicsInput *input = PhysicsInputPush(log, pipeline, PHYSICS_INPUT_BODY_ADD);
+	input->body_add.t_world = *t_world;
+	input->body_add.entity = entity;
+	input->body_add.dynamic = prefab->dynamic;
+	input->body_add.id = ds_RigidBodyAdd(pipeline, prefab, t_world, entity);
+	return input->body_add.id;
+}
+
+ds_ShapeId PhysicsInputShapeAdd(struct ds_PhysicsInputLog *log, struct ds_RigidBodyPipeline *pipeline, const struct ds_ShapePrefab *prefab, const ds_Transform *t_local, const ds_RigidBodyId body)
+{
+	struct ds_PhysicsInput *input = PhysicsInputPush(log, pipeline, PHYSICS_INPUT_SHAPE_ADD);
+	input->shape_add.t_local = *t_local;
+	input->shape_add.body = body;
+	input->shape_add.cshape = prefab->cshape;
+	input->shape_add.density = prefab->density;
+	input->shape_add.restitution = prefab->restitution;
+	input->shape_add.friction = prefab->friction;
+	input->shape_add.margin = prefab->margin;
+	input->shape_add.id = ds_ShapeAdd(pipeline, prefab, t_local, body);
+	return input->shape_add.id;
+}
+
+void PhysicsInputBodyRemove(struct ds_PhysicsInputLog *log, struct arena *mem_tmp, struct ds_RigidBodyPipeline *pipeline, const ds_RigidBodyId id)
+{
+	struct ds_PhysicsInput *input = PhysicsInputPush(log, pipeline, PHYSICS_INPUT_BODY_REMOVE);
+	input->body_remove = id;
+	ds_RigidBodyRemove(mem_tmp, pipeline, id);
+}
+
+void PhysicsInputConfig(struct ds_PhysicsInputLog *log, struct ds_RigidBodyPipeline *pipeline, const struct solverConfig *config)
+{
+	struct ds_PhysicsInput *input = PhysicsInputPush(log, pipeline, PHYSICS_INPUT_CONFIG);
+	input->config = *config;
+	pipeline->config = *config;
+}
+
+u32 PhysicsInputLogReplay(struct arena *mem_tmp, struct ds_RigidBodyPipeline *pipeline, struct ds_PhysicsInputLog *log)
+{
+	ds_AssertString(pipeline->async_stream == NULL, "Fence any in-flight ticks before replaying inputs");
+
+	for (; log->next < log->input.next; ++log->next)
+	{
+		const struct ds_PhysicsInput *input = VectorAddress(&log->input, log->next);
+		if (input->frame != pipeline->frames_completed)
+		{
+			ds_AssertString(input->frame > pipeline->frames_completed, "Replaying input log past recorded inputs, seek first");
+			break;
+		}
+
+		switch (input->type)
+		{
+			case PHYSICS_INPUT_BODY_ADD:
+			{
+				const struct ds_RigidBodyPrefab prefab = { .dynamic = input->body_add.dynamic };
+				if (ds_RigidBodyAdd(pipeline, &prefab, &input->body_add.t_world, input->body_add.entity) != input->body_add.id)
+				{
+					Log(T_PHYSICS, S_ERROR, "Replaying physics input log: body add of frame %lu diverged", input->frame);
+					return 0;
+				}
+			} break;
+
+			case PHYSICS_INPUT_SHAPE_ADD:
+			{
+				const struct ds_ShapePrefab prefab =
+				{
+					.cshape = input->shape_add.cshape,
+					.density = input->shape_add.density,
+					.restitution = input->shape_add.restitution,
+					.friction = input->shape_add.friction,
+					.margin = input->shape_add.margin,
+				};
+				if (ds_ShapeAdd(pipeline, &prefab, &input->shape_add.t_local, input->shape_add.body) != input->shape_add.id)
+				{
+					Log(T_PHYSICS, S_ERROR, "Replaying physics input log: shape add of frame %lu diverged", input->frame);
+					return 0;
+				}
+			} break;
+
+			case PHYSICS_INPUT_BODY_REMOVE:
+			{
+				ds_RigidBodyRemove(mem_tmp, pipeline, input->body_remove);
+			} break;
+
+			case PHYSICS_INPUT_CONFIG:
+			{
+				pipeline->config = input->config;
+			} break;
+
+			default:
+			{
+				ds_AssertString(0, "Unhandled physics input type");
+			} break;
+		}
+	}
+
+	return 1;
+}
+
+void PhysicsInputLogSeek(struct ds_PhysicsInputLog *log, const u64 frame)
+{
+	u32 low = 0;
+	u32 high = log->input.next;
+	while (low < high)
+	{
+		const u32 mid = low + (high - low) / 2;
+		const struct ds_PhysicsInput *input = VectorAddress(&log->input, mid);
+		if (input->frame < frame)
+		{
+			low = mid + 1;
+		}
+		else
+		{
+			high = mid;
+		}
+	}
+	log->next = low;
+}
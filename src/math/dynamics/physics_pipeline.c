@@ -23,23 +23,13 @@
 #include "float32.h"
 #include "dynamics.h"
 #include "ds_job.h"
+#include "xxhash.h"
 
-dsThreadLocal struct collisionDebug *tl_debug;
-
-u32 g_a_thread_counter = 0;
-
-static void ThreadSetCollisionDebug(void *task_addr)
-{
-	struct task *task = task_addr;
-	struct worker *worker = task->executor;
-	const struct ds_RigidBodyPipeline *pipeline = task->input;
-	tl_debug = pipeline->debug + ds_ThreadSelfIndex();
+DEFINE_STACK(physicsEvent);
 
-	AtomicFetchAddRel32(&g_a_thread_counter, 1);
-	while (AtomicLoadAcq32(&g_a_thread_counter) != pipeline->debug_count);
-}
+dsThreadLocal struct collisionDebug *tl_debug;
 
-struct ds_RigidBodyPipeline PhysicsPipelineAlloc(struct arena *mem, const u32 initial_size, const u64 ns_tick, const u64 frame_memory, struct strdb *cshape_db, struct strdb *prefab_db)
+static struct ds_RigidBodyPipeline PhysicsPipelineAllocInternal(struct arena *mem, const struct ds_PhysicsCapacity *capacity, const u32 growable, const u64 ns_tick, const u64 frame_memory, struct strdb *cshape_db, struct strdb *prefab_db)
 {
 	struct ds_RigidBodyPipeline pipeline =
 	{
@@ -49,15 +39,13 @@ struct ds_RigidBodyPipeline PhysicsPipelineAlloc(struct arena *mem, const u32 in
 		.ns_start = 0,
 		.frame = ArenaAlloc(frame_memory),
 		.frames_completed = 0,
+		.state_hash = 0,
 	};
 
-	static u32 init_solver_once = 0;
-	if (!init_solver_once)
 	{
         const f32 max_linear_velocity_magnitude = 400.0f;
         const f32 max_angular_velocity_magnitude = 10.0f * F32_PI;
 
-		init_solver_once = 1;
 		const u32 pgs_iteration_count = 8;
 		const u32 ngs_iteration_count = 3;
 		const u32 warmup_solver = 1;
@@ -72,55 +60,111 @@ struct ds_RigidBodyPipeline PhysicsPipelineAlloc(struct arena *mem, const u32 in
 		const f32 sleep_time_threshold = 0.5f;
 		f32 sleep_linear_velocity_sq_limit = 0.005f*0.005f; 
 		f32 sleep_angular_velocity_sq_limit = 0.01f*0.01f*2.0f*F32_PI;
-		SolverConfigInit(pgs_iteration_count, ngs_iteration_count, warmup_solver, gravity, baumgarte_constant, max_linear_correction, max_linear_velocity_magnitude, max_angular_velocity_magnitude, linear_dampening, angular_dampening, linear_slop, restitution_threshold, sleep_enabled, sleep_time_threshold, sleep_linear_velocity_sq_limit, sleep_angular_velocity_sq_limit);
+		const u32 split_deferred = 0;
+		const u32 split_body_budget = 512;
+		const u32 island_builder = ISLAND_BUILDER_INCREMENTAL;
+		const u32 substep_count = 1;
+		const u32 deterministic = 0;
+		SolverConfigInit(&pipeline.config, pgs_iteration_count, ngs_iteration_count, warmup_solver, gravity, baumgarte_constant, max_linear_correction, max_linear_velocity_magnitude, max_angular_velocity_magnitude, linear_dampening, angular_dampening, linear_slop, restitution_threshold, sleep_enabled, sleep_time_threshold, sleep_linear_velocity_sq_limit, sleep_angular_velocity_sq_limit, split_deferred, split_body_budget, island_builder, substep_count, deterministic);
 	}
 
-	ds_AssertString(PowerOfTwoCheck(initial_size), "For simplicity of future data structures, expect pipeline sizes to be powers of two");
+	ds_AssertString(PowerOfTwoCheck(capacity->body_max) 
+			&& PowerOfTwoCheck(capacity->shape_max)
+			&& PowerOfTwoCheck(capacity->contact_max)
+			&& PowerOfTwoCheck(capacity->sat_cache_max), 
+			"For simplicity of future data structures, expect pipeline sizes to be powers of two");
 
-	pipeline.body_pool = ds_PoolAlloc(NULL, initial_size, struct ds_RigidBody, GROWABLE);
+	pipeline.fixed = !growable;
+	pipeline.capacity = *capacity;
+	memset(&pipeline.high_water, 0, sizeof(pipeline.high_water));
+
+	pipeline.body_pool = ds_PoolAlloc(NULL, capacity->body_max, struct ds_RigidBody, growable);
 	pipeline.body_marked_list = dll_Init(struct ds_RigidBody);
 	pipeline.body_non_marked_list = dll_Init(struct ds_RigidBody);
-
-	pipeline.shape_pool = ds_PoolAlloc(NULL, initial_size, struct ds_Shape, GROWABLE);
-	pipeline.shape_bvh = DbvhAlloc(NULL, 2*initial_size, 1);
-
-	pipeline.event_pool = ds_PoolAlloc(NULL, 256, struct physicsEvent, GROWABLE);
-	pipeline.event_list = dll_Init(struct physicsEvent);
+	pipeline.body_awake_list = stack_u32Alloc(NULL, pipeline.body_pool.length, growable);
+
+	pipeline.shape_pool = ds_PoolAlloc(NULL, capacity->shape_max, struct ds_Shape, growable);
+	/* a tree of n leaves has 2n-1 nodes, and batch insertion needs one more to graft its subtree */
+	pipeline.shape_bvh = DbvhAlloc(NULL, 2*pipeline.shape_pool.length, growable);
+
+	/* growable event buffers start small, fixed buffers hold event_max events between flushes */
+	pipeline.event = stack_physicsEventAlloc(NULL, (growable) ? 256 : capacity->event_max, growable);
+	/* solve tasks push orientation events into the buffer of the worker running them */
+	pipeline.body_event_count = g_task_ctx->worker_count;
+	pipeline.body_event = ArenaPushAligned(mem, pipeline.body_event_count*sizeof(struct physicsEventBuffer), DS_CACHE_LINE_UB);
+	for (u32 i = 0; i < pipeline.body_event_count; ++i)
+	{
+		pipeline.body_event[i].events = stack_physicsEventAlloc(NULL, (growable) ? capacity->body_max : capacity->event_max, growable);
+	}
 
 	pipeline.cshape_db = cshape_db;
 
-	pipeline.cdb = cdb_Alloc(mem, initial_size);
-	pipeline.is_db = isdb_Alloc(mem, initial_size);
+	pipeline.cdb = cdb_Alloc(mem, capacity->contact_max, capacity->sat_cache_max, growable);
+	/* every island owns at least one body, and a split allocates its islands before removing the split island */
+	pipeline.is_db = isdb_Alloc(mem, pipeline.body_pool.length + 1, growable);
 
     pipeline.margin_on = 0;
 	pipeline.margin = COLLISION_DEFAULT_MARGIN;
 
 	pipeline.debug_count = 0;
 	pipeline.debug = NULL;
-#ifdef DS_PHYSICS_DEBUG
-	struct task_stream *stream = task_stream_init(&pipeline.frame);
 
+	pipeline.async_enabled = 0;
+	pipeline.async_stream = NULL;
+	pipeline.snapshot_read = 0;
+	pipeline.contact_input = NULL;
+	pipeline.contact_output = NULL;
+	pipeline.contact_input_count = 0;
+	pipeline.island_input = NULL;
+	pipeline.island_output = NULL;
+	pipeline.island_input_count = 0;
+#ifdef DS_PHYSICS_DEBUG
 	pipeline.debug_count = g_arch_config->logical_core_count;
 	pipeline.debug = malloc(g_arch_config->logical_core_count * sizeof(struct collisionDebug));
 	for (u32 i = 0; i < pipeline.debug_count; ++i)
 	{
 		pipeline.debug[i].stack_segment = stack_visualSegmentAlloc(NULL, 1024, GROWABLE);
-		task_stream_dispatch(&pipeline.frame, stream, ThreadSetCollisionDebug, &pipeline);
 	}
-
-	task_main_master_run_available_jobs();
-
-	/* spin wait until last job completes */
-	task_stream_spin_wait(stream);
-	/* release any task resources */
-	task_stream_cleanup(stream);		
 #endif
 
 	return pipeline;
 }
 
+struct ds_RigidBodyPipeline PhysicsPipelineAlloc(struct arena *mem, const u32 initial_size, const u64 ns_tick, const u64 frame_memory, struct strdb *cshape_db, struct strdb *prefab_db)
+{
+	const struct ds_PhysicsCapacity capacity =
+	{
+		.body_max = initial_size,
+		.shape_max = initial_size,
+		.contact_max = initial_size,
+		.sat_cache_max = initial_size,
+		.event_max = initial_size,
+	};
+
+	return PhysicsPipelineAllocInternal(mem, &capacity, GROWABLE, ns_tick, frame_memory, cshape_db, prefab_db);
+}
+
+struct ds_RigidBodyPipeline PhysicsPipelineAllocFixed(struct arena *mem, const struct ds_PhysicsCapacity *capacity, const u64 ns_tick, const u64 frame_memory, struct strdb *cshape_db, struct strdb *prefab_db)
+{
+	ds_Assert(capacity->body_max && capacity->shape_max && capacity->contact_max && capacity->sat_cache_max && capacity->event_max);
+	const struct ds_PhysicsCapacity capacity_pow2 =
+	{
+		.body_max = (u32) PowerOfTwoCeil(capacity->body_max),
+		.shape_max = (u32) PowerOfTwoCeil(capacity->shape_max),
+		.contact_max = (u32) PowerOfTwoCeil(capacity->contact_max),
+		.sat_cache_max = (u32) PowerOfTwoCeil(capacity->sat_cache_max),
+		.event_max = capacity->event_max,
+	};
+
+	return PhysicsPipelineAllocInternal(mem, &capacity_pow2, NOT_GROWABLE, ns_tick, frame_memory, cshape_db, prefab_db);
+}
+
 void PhysicsPipelineFree(struct ds_RigidBodyPipeline *pipeline)
 {
+	if (pipeline->async_enabled)
+	{
+		PhysicsPipelineAsyncDisable(pipeline);
+	}
 #ifdef DS_PHYSICS_DEBUG
 	for (u32 i = 0; i < pipeline->debug_count; ++i)
 	{
@@ -132,7 +176,12 @@ void PhysicsPipelineFree(struct ds_RigidBodyPipeline *pipeline)
 	cdb_Free(pipeline->cdb);
 	isdb_Dealloc(&pipeline->is_db);
 	ds_PoolDealloc(&pipeline->body_pool);
-	ds_PoolDealloc(&pipeline->event_pool);
+	stack_u32Free(&pipeline->body_awake_list);
+	stack_physicsEventFree(&pipeline->event);
+	for (u32 i = 0; i < pipeline->body_event_count; ++i)
+	{
+		stack_physicsEventFree(&pipeline->body_event[i].events);
+	}
 	ds_PoolDealloc(&pipeline->shape_pool);
 }
 
@@ -144,7 +193,6 @@ static void PhysicsPipelineClearFrame(struct ds_RigidBodyPipeline *pipeline)
 		stack_visualSegmentFlush(&pipeline->debug[i].stack_segment);
 	}
 #endif
-	isdb_ClearFrame(&pipeline->is_db);
 	cdb_ClearFrame(pipeline->cdb);
 	ArenaFlush(&pipeline->frame);
 }
@@ -164,15 +212,29 @@ void PhysicsPipelineFlush(struct ds_RigidBodyPipeline *pipeline)
 	ds_PoolFlush(&pipeline->body_pool);
 	dll_Flush(&pipeline->body_marked_list);
 	dll_Flush(&pipeline->body_non_marked_list);
+	stack_u32Flush(&pipeline->body_awake_list);
 
 	DbvhFlush(&pipeline->shape_bvh);
 	ds_PoolFlush(&pipeline->shape_pool);
 
-	ds_PoolFlush(&pipeline->event_pool);
-	dll_Flush(&pipeline->event_list);
+	PhysicsPipelineEventFlush(pipeline);
+
+	if (pipeline->async_enabled)
+	{
+		ds_AssertString(pipeline->async_stream == NULL, "Fence any in-flight ticks before flushing the pipeline");
+		for (u32 i = 0; i < 2; ++i)
+		{
+			ArenaFlush(&pipeline->snapshot[i].mem);
+			pipeline->snapshot[i].body_count = 0;
+			pipeline->snapshot[i].event_count = 0;
+			pipeline->snapshot[i].frames_completed = 0;
+			pipeline->snapshot[i].state_hash = 0;
+		}
+	}
 
 	ArenaFlush(&pipeline->frame);
 	pipeline->frames_completed = 0;
+	pipeline->state_hash = 0;
 	pipeline->ns_elapsed = 0;
 }
 
@@ -194,6 +256,9 @@ struct tcc_Output
     struct ds_ContactKey    key;
     u32                     collision;
     u32                     cache_index;
+    u32                     cache_dropped;  /* no sat cache available, pair was run uncached                */
+    u32                     contact_index;  /* existing contact, or NLL_NULL                              */
+    u32                     contact_new;    /* collision without existing contact, insert in serial phase */
 };
 
 struct tcc_Input
@@ -212,9 +277,16 @@ static void ThreadCalculateContact(void *task_addr)
 	struct worker *worker = task->executor;
     struct tcc_Input *in = task->input;
     struct tcc_Output *out = in->out;
+#ifdef DS_PHYSICS_DEBUG
+    /* workers are shared between pipelines, so debug output goes to the pipeline of the task */
+    tl_debug = in->pipeline->debug + ds_ThreadSelfIndex();
+#endif
 
+    struct sat_Cache cache_local;
+    struct sat_Cache *cache = NULL;
     out->cache = NULL;
     out->cache_index = U32_MAX;
+    out->cache_dropped = 0;
     if (in->s1->cshape_type == C_SHAPE_CONVEX_HULL && in->s2->cshape_type == C_SHAPE_CONVEX_HULL)
     {
         const struct ds_RigidBody *b1 = ds_PoolAddress(&in->pipeline->body_pool, in->s1->body);
@@ -233,48 +305,134 @@ static void ThreadCalculateContact(void *task_addr)
         {
             slot = sat_CacheAdd(in->pipeline->cdb, &key);
         }
-        out->cache_index = slot.index;
-        out->cache = slot.address;
+
+        if (slot.address)
+        {
+            out->cache_index = slot.index;
+            out->cache = slot.address;
+            out->cache->frame_touched = in->pipeline->frames_completed;
+            cache = out->cache;
+        }
+        else
+        {
+            /* full fixed capacity sat cache pool; run the pair with a cache local to this frame */
+            cache_local.key = key;
+            cache_local.type = SAT_CACHE_NOT_SET;
+            cache = &cache_local;
+            out->cache_dropped = 1;
+        }
     }
 
     ds_Assert(in->s1->body != in->s2->body);
-    out->collision = ds_ShapeContact(&worker->mem_frame, &out->manifold, out->cache, in->pipeline, in->s1, in->s2);
+    out->collision = ds_ShapeContact(&worker->mem_frame, &out->manifold, cache, in->pipeline, in->s1, in->s2);
+
+    /* 
+     * The contact database is read-only during narrowphase (apart from the contact we own), so existing 
+     * contacts are looked up and updated here; only new contacts are left for the serial phase. 
+     */
+    out->contact_new = 0;
+    out->contact_index = NLL_NULL;
+    if (out->collision)
+    {
+        const struct slot slot = ds_ContactKeyLookup(in->pipeline, &out->key);
+        if (slot.address)
+        {
+            ds_ContactUpdate(in->pipeline, slot, &out->manifold);
+            out->contact_index = slot.index;
+        }
+        else
+        {
+            out->contact_new = 1;
+        }
+    }
 
 	ProfZoneEnd;
 }
 
-static void CollisionDetection(struct ds_RigidBodyPipeline *pipeline)
+static void ContactOutputMerge(struct tcc_Output **output, struct tcc_Output **tmp, const u32 left, const u32 mid, const u32 right)
+{
+	u32 l = left;
+	u32 r = mid;
+	const u32 count = right - left;
+
+	for (u32 i = left; i < right; ++i)
+	{
+		if (r < right && (l >= mid || ds_ContactKeyLess(&output[r]->key, &output[l]->key)))
+		{
+			tmp[i] = output[r];
+			r += 1;
+		}
+		else
+		{
+			tmp[i] = output[l];
+			l += 1;
+		}
+	}
+
+	memcpy(output + left, tmp + left, count * sizeof(struct tcc_Output *));
+}
+
+/* stable bottom-up merge sort of narrowphase outputs on their contact keys */
+static void ContactOutputSort(struct arena *mem_tmp, struct tcc_Output **output, const u32 count)
+{
+	ArenaPushRecord(mem_tmp);
+	struct tcc_Output **tmp = ArenaPush(mem_tmp, count*sizeof(struct tcc_Output *));
+	if (count && !tmp)
+	{
+		LogString(T_PHYSICS, S_FATAL, "Frame arena OOM in ContactOutputSort, increase size!");
+		FatalCleanupAndExit();
+	}
+
+	for (u32 width = 2; width/2 < count; width *= 2)
+	{
+		u32 i = 0;
+		for (; i + width <= count; i += width)
+		{
+			ContactOutputMerge(output, tmp, i, i + width/2, i + width);
+		}
+
+		if (i + width/2 < count)
+		{
+			ContactOutputMerge(output, tmp, i, i + width/2, count);
+		}
+	}
+
+	ArenaPopRecord(mem_tmp);
+}
+
+/* update moved proxies and set up the narrowphase tasks of the frame */
+static void CollisionDetectionPrepare(struct ds_RigidBodyPipeline *pipeline)
 {
 	ProfZone;
-    struct cdb *cdb = pipeline->cdb;
 
     {
     	ProfZoneNamed("DbvhUpdate");
     
-    	const u32 flags = RB_ACTIVE | RB_DYNAMIC | (g_solver_config->sleep_enabled * RB_AWAKE);
-    	const struct ds_RigidBody *body = NULL;
-    	for (u32 i = pipeline->body_non_marked_list.first; i != DLL_NULL; i = dll_Next(body))
+    	/* Only awake bodies can have moved; sleeping and static proxies are never visited */
+    	for (u32 i = 0; i < pipeline->body_awake_list.next; ++i)
     	{
-    		body = ds_PoolAddress(&pipeline->body_pool, i);
-    		if ((body->flags & flags) == flags)
+    		const struct ds_RigidBody *body = ds_PoolAddress(&pipeline->body_pool, pipeline->body_awake_list.arr[i]);
+    		if (!RB_IS_ACTIVE(body))
     		{
-                struct ds_Shape *shape = NULL;
-                for (u32 j = body->shape_list.first; j != DLL_NULL; j = shape->dll_next)
-                {
-                    shape = ds_PoolAddress(&pipeline->shape_pool, j);
-                    struct aabb bbox = ds_ShapeWorldBbox(pipeline, shape);
-                    const struct bvhNode *node = ds_PoolAddress(&pipeline->shape_bvh.tree.pool, shape->proxy);
-    			    const struct aabb *proxy = &node->bbox;
-    			    if (!AabbContains(proxy, &bbox))
-    			    {
-    			    	bbox.hw[0] += shape->margin;
-    			    	bbox.hw[1] += shape->margin;
-    			    	bbox.hw[2] += shape->margin;
-    			    	DbvhRemove(&pipeline->shape_bvh, shape->proxy);
-    			    	shape->proxy = DbvhInsert(&pipeline->shape_bvh, j, &bbox);
-    			    }
-                }
+    			continue;
     		}
+
+            struct ds_Shape *shape = NULL;
+            for (u32 j = body->shape_list.first; j != DLL_NULL; j = shape->dll_next)
+            {
+                shape = ds_PoolAddress(&pipeline->shape_pool, j);
+                struct aabb bbox = ds_ShapeWorldBbox(pipeline, shape);
+                const struct bvhNode *node = ds_PoolAddress(&pipeline->shape_bvh.tree.pool, shape->proxy);
+    		    const struct aabb *proxy = &node->bbox;
+    		    if (!AabbContains(proxy, &bbox))
+    		    {
+    		    	bbox.hw[0] += shape->margin;
+    		    	bbox.hw[1] += shape->margin;
+    		    	bbox.hw[2] += shape->margin;
+    		    	DbvhRemove(&pipeline->shape_bvh, shape->proxy);
+    		    	shape->proxy = DbvhInsert(&pipeline->shape_bvh, j, &bbox);
+    		    }
+            }
     	}
 
     	ProfZoneEnd;
@@ -288,12 +446,17 @@ static void CollisionDetection(struct ds_RigidBodyPipeline *pipeline)
     	ProfZoneEnd;
     }
 
-	struct tcc_Output *output = NULL;
     {
-    	ProfZoneNamed("NarrowPhase");
-	    /* acquire any task resources */
-	    struct task_stream *stream = task_stream_init(&pipeline->frame);
-	    struct tcc_Output **next = &output;
+    	ProfZoneNamed("NarrowPhasePrepare");
+	    struct tcc_Output **next = &pipeline->contact_output;
+        pipeline->contact_output = NULL;
+        pipeline->contact_input_count = 0;
+        pipeline->contact_input = ArenaPush(&pipeline->frame, proxy_overlap_count*sizeof(struct tcc_Input *));
+        if (proxy_overlap_count && !pipeline->contact_input)
+        {
+            LogString(T_PHYSICS, S_FATAL, "Frame arena OOM in Broadphase, increase size!");
+            FatalCleanupAndExit();
+        }
 
 	    for (u32 i = 0; i < proxy_overlap_count; ++i)
 	    {
@@ -318,122 +481,130 @@ static void CollisionDetection(struct ds_RigidBodyPipeline *pipeline)
             args->s1 = s1;
             args->s2 = s2;
 
-	    	task_stream_dispatch(&pipeline->frame, stream, ThreadCalculateContact, args);
+            pipeline->contact_input[pipeline->contact_input_count++] = args;
             *next = out;
             next = &out->next;
 	    }
 
-	    task_main_master_run_available_jobs();
-	    /* spin wait until last job completes */
-	    task_stream_spin_wait(stream);
-	    /* release any task resources */
-	    task_stream_cleanup(stream);		
-
     	ProfZoneEnd;
     }
- 
-    {
-    	ProfZoneNamed("ContactManagement");
 
-	    cdb->sat_cache_frame_usage = BitVecAlloc(&pipeline->frame, cdb->sat_cache_persistent_usage.bit_count, 0, 0);
-	    cdb->contact_frame_usage = BitVecAlloc(&pipeline->frame, cdb->contact_persistent_usage.bit_count, 0, 0);
+	ProfZoneEnd;
+}
 
-        struct memArray arr = ArenaPushAlignedAll(&pipeline->frame, sizeof(u32), sizeof(u32));
-        cdb->contact_new = arr.addr;
-        //fprintf(stderr, "A: {");
-	    for (; output; output = output->next)
-	    {
-            if (output->cache)
-            {
-                cdb->sat_cache_count += 1;
-                if (output->cache_index < cdb->sat_cache_persistent_usage.bit_count)
-                {
-                    BitVecSetBit(&cdb->sat_cache_frame_usage, output->cache_index, 1);   
-                }
-            }
+void PhysicsPipelineContactDispatch(struct arena *mem, struct task_stream *stream, struct ds_RigidBodyPipeline *pipeline, const u32 first, const u32 count)
+{
+	const u32 end = (first + count < pipeline->contact_input_count) ? first + count : pipeline->contact_input_count;
+	for (u32 i = first; i < end; ++i)
+	{
+		task_stream_dispatch(mem, stream, ThreadCalculateContact, pipeline->contact_input[i]);
+	}
+}
+
+void PhysicsPipelineContactFork(struct arena *mem, struct task *running, struct ds_RigidBodyPipeline *pipeline)
+{
+	for (u32 i = 0; i < pipeline->contact_input_count; ++i)
+	{
+		task_graph_fork(mem, running, ThreadCalculateContact, pipeline->contact_input[i]);
+	}
+}
+
+/* insert the new contacts found by the narrowphase tasks and remove stale sat caches */
+static void ContactManagement(struct ds_RigidBodyPipeline *pipeline)
+{
+	ProfZone;
+    struct cdb *cdb = pipeline->cdb;
+    struct tcc_Output *output = pipeline->contact_output;
+
+    /* Existing contacts and frame stamps were updated by the workers, only insert new contacts */
+    struct memArray arr = ArenaPushAlignedAll(&pipeline->frame, sizeof(struct tcc_Output *), sizeof(struct tcc_Output *));
+    struct tcc_Output **output_new = arr.addr;
+    u32 output_new_count = 0;
+    for (; output; output = output->next)
+    {
+        cdb->sat_cache_count += (output->cache != NULL);
+        cdb->contact_count += output->collision;
+        pipeline->high_water.sat_cache_dropped += output->cache_dropped;
+        if (output->cache)
+        {
+            stack_u32Push(&cdb->sat_cache_touched, output->cache_index);
+        }
 
-            if (output->collision)
+        if (output->contact_index != NLL_NULL)
+        {
+            stack_u32Push(&cdb->contact_touched, output->contact_index);
+        }
+        else if (output->contact_new)
+        {
+            if (output_new_count >= arr.len)
             {
-                cdb->contact_count += 1;
-                struct slot slot = ds_ContactKeyLookup(pipeline, &output->key);
-                if (!slot.address)
-                {
-                    slot = ds_ContactAdd(pipeline, &output->manifold, &output->key);
-                }
-                else
-                {
-                    ds_ContactUpdate(pipeline, slot, &output->manifold);
-                }
-                 
-			    /* add to new links if needed */
-			    if (slot.index >= cdb->contact_persistent_usage.bit_count
-			    	 || BitVecGetBit(&cdb->contact_persistent_usage, slot.index) == 0)
-			    {
-                        if (cdb->contact_new_count >= arr.len)
-                        {
-                            LogString(T_PHYSICS, S_FATAL, "Frame arena OOM in Broadphase, increase size!");
-                            FatalCleanupAndExit();
-                        }
-                        cdb->contact_new[ cdb->contact_new_count ] = slot.index;
-			    		cdb->contact_new_count += 1;
-			    }
-			    //fprintf(stderr, " %u", index);
+                LogString(T_PHYSICS, S_FATAL, "Frame arena OOM in Broadphase, increase size!");
+                FatalCleanupAndExit();
             }
-	    }
-        //fprintf(stderr, " } ");
-        ArenaPopPacked(&pipeline->frame, sizeof(u32)*(arr.len - cdb->contact_new_count));
+            output_new[output_new_count++] = output;
+        }
+    }
+    ArenaPopPacked(&pipeline->frame, sizeof(struct tcc_Output *)*(arr.len - output_new_count));
 
-        /* Remove stale sat_Caches */
-	    u32 bit = 0;
-	    for (u64 block = 0; block < cdb->sat_cache_frame_usage.block_count; ++block)
-	    {
-	    	u64 broken_link_block = 
-	    			    cdb->sat_cache_persistent_usage.bits[block]
-	    			& (~cdb->sat_cache_frame_usage.bits[block]);
-	    	u32 b = 0;
-	    	while (broken_link_block)
-	    	{
-	    		const u32 tzc = Ctz64(broken_link_block);
-	    		b += tzc;
-	    		const u32 ci = bit + b;
-	    		b += 1;
-
-	    		broken_link_block = (tzc < 63) 
-	    			? broken_link_block >> (tzc + 1)
-	    			: 0;
-
-	    		sat_CacheRemove(cdb, ci);
-	    	}
-	    	bit += 64;
-	    }	
-    
-        /* Update sat_cache_persistent_usage */
-        for (u64 i = 0; i < cdb->sat_cache_frame_usage.block_count; ++i)
+    /* 
+     * The overlap order depends on the layout of the bvh, i.e. on the history of the pipeline; in 
+     * deterministic mode new contacts, and thereby island merges and contact list order, follow key order.
+     */
+    if (pipeline->config.deterministic)
+    {
+        ContactOutputSort(&pipeline->frame, output_new, output_new_count);
+    }
+
+    /* 
+     * A fixed capacity contact net never grows; new contacts that do not fit are dropped for this frame 
+     * and found again by the next narrowphase. Unlike the other fixed limits this is not fatal, so the
+     * first drop is logged. The tail is dropped, so in deterministic mode the kept
+     * contacts follow key order.
+     */
+    if (!cdb->contact_net.pool.growable && output_new_count > cdb->contact_net.pool.length - cdb->contact_net.pool.count)
+    {
+        const u32 contact_free = cdb->contact_net.pool.length - cdb->contact_net.pool.count;
+        if (pipeline->high_water.contact_dropped == 0)
         {
-        	cdb->sat_cache_persistent_usage.bits[i] = cdb->sat_cache_frame_usage.bits[i];	
+            Log(T_PHYSICS, S_WARNING, "Fixed contact capacity %u reached, dropping %u new contacts; bodies may pass through each other", cdb->contact_net.pool.length, output_new_count - contact_free);
         }
+        pipeline->high_water.contact_dropped += output_new_count - contact_free;
+        output_new_count = contact_free;
+    }
+
+    cdb->contact_new = ArenaPush(&pipeline->frame, output_new_count*sizeof(u32));
+    if (output_new_count && !cdb->contact_new)
+    {
+        LogString(T_PHYSICS, S_FATAL, "Frame arena OOM in Broadphase, increase size!");
+        FatalCleanupAndExit();
+    }
+
+    for (u32 i = 0; i < output_new_count; ++i)
+    {
+        const struct slot slot = ds_ContactAdd(pipeline, &output_new[i]->manifold, &output_new[i]->key);
+        cdb->contact_new[ cdb->contact_new_count ] = slot.index;
+			cdb->contact_new_count += 1;
+    }
 
-        const u32 count_max = AtomicLoadRlx32(&cdb->sat_cache_pool.a_count_max);
-        const u32 length = AtomicLoadRlx32(&cdb->sat_cache_pool.a_length);
-        if (cdb->sat_cache_persistent_usage.bit_count < count_max)
+    /* Remove stale sat_Caches, i.e. caches alive last frame which were not used in this frame */
+    for (u32 i = 0; i < cdb->sat_cache_live.next; ++i)
+    {
+        const u32 index = cdb->sat_cache_live.arr[i];
+        const struct sat_Cache *cache = sat_CacheTPoolAddress(&cdb->sat_cache_pool, index);
+        if (cache->frame_touched != pipeline->frames_completed)
         {
-        	const u64 low_bit = cdb->sat_cache_persistent_usage.bit_count;
-        	const u64 high_bit = count_max;
-        	BitVecIncreaseSize(&cdb->sat_cache_persistent_usage, length, 0);
-        	/* any new sat_caches that is in the appended region must now be set */
-        	for (u64 bit = low_bit; bit < high_bit; ++bit)
-        	{
-        		BitVecSetBit(&cdb->sat_cache_persistent_usage, bit, 1);
-        	}
+            sat_CacheRemove(cdb, index);
         }
-
-    	ProfZoneEnd;
     }
 
+    const stack_u32 tmp = cdb->sat_cache_live;
+    cdb->sat_cache_live = cdb->sat_cache_touched;
+    cdb->sat_cache_touched = tmp;
+    stack_u32Flush(&cdb->sat_cache_touched);
+
 	ProfZoneEnd;
 }
 
-
 static void MergeIslands(struct ds_RigidBodyPipeline *pipeline)
 {
 	ProfZone;
@@ -472,120 +643,86 @@ static void MergeIslands(struct ds_RigidBodyPipeline *pipeline)
 	ProfZoneEnd;
 }
 
-static void SplitIslandsAndRemoveContacts(struct ds_RigidBodyPipeline *pipeline)
+/* Remove contacts no longer in use and flag any island that may have been split by the removal */
+static void RemoveContacts(struct ds_RigidBodyPipeline *pipeline)
 {
 	ProfZone;
 
     struct cdb *cdb = pipeline->cdb;
 
-	if (cdb->contact_net.pool.count == 0) 
-	{ 
-		ProfZoneEnd;
-		return; 
-	}
-    
-	u32 *split = ArenaPush(&pipeline->frame, pipeline->is_db.island_pool.count*sizeof(u32));
-    u32 split_count = 0;
-	u32 bit = 0;
-	//fprintf(stderr, " R: {");
-	for (u64 block = 0; block < cdb->contact_frame_usage.block_count; ++block)
-	{
-		u64 broken_link_block = 
-				    cdb->contact_persistent_usage.bits[block]
-				& (~cdb->contact_frame_usage.bits[block]);
-		u32 b = 0;
-		while (broken_link_block)
+	/* Contacts alive at the end of the last frame which have not been touched in this frame are stale */
+	for (u32 i = 0; i < cdb->contact_live.next; ++i)
+	{
+		const u32 ci = cdb->contact_live.arr[i];
+		struct ds_Contact *c = nll_Address(&cdb->contact_net, ci);
+
+		/* Skip contacts removed outside of the frame, and still alive or new contacts */
+		if (!PoolSlotAllocated(c) || c->frame_touched == pipeline->frames_completed)
 		{
-			const u32 tzc = Ctz64(broken_link_block);
-			b += tzc;
-			const u32 ci = bit + b;
-			b += 1;
-
-			broken_link_block = (tzc < 63) 
-				? broken_link_block >> (tzc + 1)
-				: 0;
-		
-			//fprintf(stderr, " %lu", ci);
-			struct ds_Contact *c = nll_Address(&cdb->contact_net, ci);
-
-			const u32 b0 = c->key.body0;
-			const u32 b1 = c->key.body1;
-			const struct ds_RigidBody *body0 = ds_PoolAddress(&pipeline->body_pool, b0);
-			const struct ds_RigidBody *body1 = ds_PoolAddress(&pipeline->body_pool, b1);
-			ds_Assert(body0->island_index != ISLAND_STATIC || body1->island_index != ISLAND_STATIC);
-
-			struct ds_Island *is;
-			if (body0->island_index != ISLAND_STATIC)
-			{
-				is = isdb_BodyToIsland(pipeline, b0);
-				if (body1->island_index != ISLAND_STATIC)
-				{
-                    if (!(is->flags & ISLAND_SPLIT))
-                    {
-                    	is->flags |= ISLAND_SPLIT;
-                    	split[split_count++] = body0->island_index;
-                        ds_Assert(split_count <= pipeline->is_db.island_pool.count);
-                    }
-				}
-			}
-			else
+			continue;
+		}
+
+		const u32 b0 = c->key.body0;
+		const u32 b1 = c->key.body1;
+		const struct ds_RigidBody *body0 = ds_PoolAddress(&pipeline->body_pool, b0);
+		const struct ds_RigidBody *body1 = ds_PoolAddress(&pipeline->body_pool, b1);
+		ds_Assert(body0->island_index != ISLAND_STATIC || body1->island_index != ISLAND_STATIC);
+
+		/* The broadphase skips pairs of sleeping proxies, so their contacts are kept as is */
+		if (body0->awake_index == U32_MAX && body1->awake_index == U32_MAX)
+		{
+			c->frame_touched = pipeline->frames_completed;
+			stack_u32Push(&cdb->contact_touched, ci);
+			continue;
+		}
+
+		struct ds_Island *is;
+		if (body0->island_index != ISLAND_STATIC)
+		{
+			is = isdb_BodyToIsland(pipeline, b0);
+			if (body1->island_index != ISLAND_STATIC)
 			{
-				is = isdb_BodyToIsland(pipeline, b1);
+                isdb_SplitIslandDefer(&pipeline->is_db, body0->island_index);
 			}
-
-			ds_Assert(is->contact_list.count > 0);
-			dll_Remove(&is->contact_list, cdb->contact_net.pool.buf, ci);
-			ds_ContactRemove(pipeline, ci);
 		}
-		bit += 64;
-	}	
-	ArenaPopPacked(&pipeline->frame, (pipeline->is_db.island_pool.count - split_count)*sizeof(u32));
+		else
+		{
+			is = isdb_BodyToIsland(pipeline, b1);
+		}
 
-    struct arena tmp = ArenaAlloc1MB();
-	/* TODO: Parallelize island splitting */
-	for (u32 i = 0; i < split_count; ++i)
-	{
-		isdb_SplitIsland(&tmp, pipeline, split[i]);
+		ds_Assert(is->contact_list.count > 0);
+		dll_Remove(&is->contact_list, cdb->contact_net.pool.buf, ci);
+		ds_ContactRemove(pipeline, ci);
 	}
 
-    /* Update contact_persistent_usage */
-    {
-        for (u64 i = 0; i < cdb->contact_frame_usage.block_count; ++i)
-        {
-        	cdb->contact_persistent_usage.bits[i] = cdb->contact_frame_usage.bits[i];	
-        }
-
-        if (cdb->contact_persistent_usage.bit_count < cdb->contact_net.pool.count_max)
-        {
-        	const u64 low_bit = cdb->contact_persistent_usage.bit_count;
-        	const u64 high_bit = cdb->contact_net.pool.count_max;
-        	BitVecIncreaseSize(&cdb->contact_persistent_usage, cdb->contact_net.pool.length, 0);
-        	/* any new contacts that is in the appended region must now be set */
-        	for (u64 bit = low_bit; bit < high_bit; ++bit)
-        	{
-        		BitVecSetBit(&cdb->contact_persistent_usage, bit, 1);
-        	}
-        }
-    } 
-	ArenaFree1MB(&tmp);
+    const stack_u32 tmp = cdb->contact_live;
+    cdb->contact_live = cdb->contact_touched;
+    cdb->contact_touched = tmp;
+    stack_u32Flush(&cdb->contact_touched);
 
 	ProfZoneEnd;
 }
 
-static void SolveIslands(struct ds_RigidBodyPipeline *pipeline, const f32 delta) 
+/* set up the solve tasks of the frame's awake islands */
+static void SolveIslandsPrepare(struct ds_RigidBodyPipeline *pipeline, const f32 delta) 
 {
 	ProfZone;
 
-	/* acquire any task resources */
-	struct task_stream *stream = task_stream_init(&pipeline->frame);
-	struct ds_IslandSolveOutput *output = NULL;
-	struct ds_IslandSolveOutput **next = &output;
+	struct ds_IslandSolveOutput **next = &pipeline->island_output;
+	pipeline->island_output = NULL;
+	pipeline->island_input_count = 0;
+	pipeline->island_input = ArenaPush(&pipeline->frame, pipeline->is_db.island_list.count*sizeof(struct ds_IslandSolveInput *));
+	if (pipeline->is_db.island_list.count && !pipeline->island_input)
+	{
+		LogString(T_PHYSICS, S_FATAL, "Frame arena OOM in SolveIslands, increase size!");
+		FatalCleanupAndExit();
+	}
 
 	struct ds_Island *is = NULL;
 	for (u32 i = pipeline->is_db.island_list.first; i != DLL_NULL; i = dll_Next(is))
 	{
 		is = ds_PoolAddress(&pipeline->is_db.island_pool, i);
-		if (!g_solver_config->sleep_enabled || ISLAND_AWAKE_BIT(is))
+		if (!pipeline->config.sleep_enabled || ISLAND_AWAKE_BIT(is))
 		{
 			struct ds_IslandSolveInput *args = ArenaPush(&pipeline->frame, sizeof(struct ds_IslandSolveInput));
 			*next = ArenaPush(&pipeline->frame, sizeof(struct ds_IslandSolveOutput));
@@ -596,32 +733,66 @@ static void SolveIslands(struct ds_RigidBodyPipeline *pipeline, const f32 delta)
 			args->is = is;
 			args->pipeline = pipeline;
 			args->timestep = delta;
-			task_stream_dispatch(&pipeline->frame, stream, ThreadIslandSolve, args);
+			pipeline->island_input[pipeline->island_input_count++] = args;
 
 			next = &(*next)->next;
 		}
 	}
 
-	task_main_master_run_available_jobs();
-	/* spin wait until last job completes */
-	task_stream_spin_wait(stream);
-	/* release any task resources */
-	task_stream_cleanup(stream);		
+	ProfZoneEnd;
+}
+
+/* 
+ * Island solves prefer the cache group of the dispatching worker, which just built the islands, so with several
+ * pipelines in flight each pipeline's solver data stays within the caches of one group of cores.
+ */
+void PhysicsPipelineIslandDispatch(struct arena *mem, struct task_stream *stream, struct ds_RigidBodyPipeline *pipeline, const u32 first, const u32 count)
+{
+	const u32 locality = task_locality();
+	const u32 end = (first + count < pipeline->island_input_count) ? first + count : pipeline->island_input_count;
+	for (u32 i = first; i < end; ++i)
+	{
+		task_stream_dispatch_local(mem, stream, ThreadIslandSolve, pipeline->island_input[i], locality);
+	}
+}
 
-	for (; output; output = output->next)
+void PhysicsPipelineIslandFork(struct arena *mem, struct task *running, struct ds_RigidBodyPipeline *pipeline)
+{
+	const u32 locality = task_locality();
+	for (u32 i = 0; i < pipeline->island_input_count; ++i)
+	{
+		task_graph_fork_local(mem, running, ThreadIslandSolve, pipeline->island_input[i], locality);
+	}
+}
+
+/* move the proxies of islands that fell asleep or woke up in the solve tasks */
+static void SolveIslandsFinish(struct ds_RigidBodyPipeline *pipeline)
+{
+	ProfZone;
+
+	for (struct ds_IslandSolveOutput *output = pipeline->island_output; output; output = output->next)
 	{
 		if (output->island_asleep)
 		{
 			PhysicsEventIslandAsleep(pipeline, output->island);
+			for (u32 i = 0; i < output->body_count; ++i)
+			{
+				ds_RigidBodyProxySleep(pipeline, output->bodies[i]);
+			}
 		}
-
-		for (u32 i = 0; i < output->body_count; ++i)
+		else
 		{
-			struct physicsEvent *event = PhysicsPipelineEventPush(pipeline);
-			event->type = PHYSICS_EVENT_BODY_ORIENTATION;
-            const struct ds_RigidBody *body = ds_PoolAddress(&pipeline->body_pool, output->bodies[i]);
-			event->body = ((u64) body->tag << 32) | output->bodies[i];
+			/* bodies of islands woken up since the last solve get their proxies back into the broadphase */
+			for (u32 i = 0; i < output->body_count; ++i)
+			{
+				const struct ds_RigidBody *body = ds_PoolAddress(&pipeline->body_pool, output->bodies[i]);
+				if (body->awake_index == U32_MAX)
+				{
+					ds_RigidBodyProxyWake(pipeline, output->bodies[i]);
+				}
+			}
 		}
+
 	}
 
 	ProfZoneEnd;
@@ -629,10 +800,10 @@ static void SolveIslands(struct ds_RigidBodyPipeline *pipeline, const f32 delta)
 
 void PhysicsPipelineSleepEnable(struct ds_RigidBodyPipeline *pipeline)
 {
-	ds_Assert(g_solver_config->sleep_enabled == 0);
-	if (!g_solver_config->sleep_enabled)
+	ds_Assert(pipeline->config.sleep_enabled == 0);
+	if (!pipeline->config.sleep_enabled)
 	{
-		g_solver_config->sleep_enabled = 1;
+		pipeline->config.sleep_enabled = 1;
 		const u32 body_flags = RB_ACTIVE | RB_DYNAMIC;
 		struct ds_RigidBody *body = NULL;
 		for (u32 i = pipeline->body_non_marked_list.first; i != DLL_NULL; i = dll_Next(body))
@@ -656,10 +827,10 @@ void PhysicsPipelineSleepEnable(struct ds_RigidBodyPipeline *pipeline)
 
 void PhysicsPipelineSleepDisable(struct ds_RigidBodyPipeline *pipeline)
 {
-	ds_Assert(g_solver_config->sleep_enabled == 1);
-	if (g_solver_config->sleep_enabled)
+	ds_Assert(pipeline->config.sleep_enabled == 1);
+	if (pipeline->config.sleep_enabled)
 	{
-		g_solver_config->sleep_enabled = 0;
+		pipeline->config.sleep_enabled = 0;
 		const u32 body_flags = RB_ACTIVE | RB_DYNAMIC;
 		struct ds_RigidBody *body = NULL;
 		for (u32 i = pipeline->body_non_marked_list.first; i != DLL_NULL; i = dll_Next(body))
@@ -683,22 +854,27 @@ void PhysicsPipelineSleepDisable(struct ds_RigidBodyPipeline *pipeline)
 
 static void UpdateSolverConfig(struct ds_RigidBodyPipeline *pipeline)
 {
-	g_solver_config->warmup_solver = g_solver_config->pending_warmup_solver;
-	g_solver_config->pgs_iteration_count = g_solver_config->pending_pgs_iteration_count;
-	g_solver_config->ngs_iteration_count = g_solver_config->pending_ngs_iteration_count;
-	g_solver_config->linear_slop = g_solver_config->pending_linear_slop;
-	g_solver_config->baumgarte_constant = g_solver_config->pending_baumgarte_constant;
-	g_solver_config->restitution_threshold = g_solver_config->pending_restitution_threshold;
-	g_solver_config->linear_dampening = g_solver_config->pending_linear_dampening;
-	g_solver_config->angular_dampening = g_solver_config->pending_angular_dampening;
-
-	if (g_solver_config->pending_sleep_enabled != g_solver_config->sleep_enabled)
+	pipeline->config.warmup_solver = pipeline->config.pending_warmup_solver;
+	pipeline->config.pgs_iteration_count = pipeline->config.pending_pgs_iteration_count;
+	pipeline->config.ngs_iteration_count = pipeline->config.pending_ngs_iteration_count;
+	pipeline->config.linear_slop = pipeline->config.pending_linear_slop;
+	pipeline->config.baumgarte_constant = pipeline->config.pending_baumgarte_constant;
+	pipeline->config.restitution_threshold = pipeline->config.pending_restitution_threshold;
+	pipeline->config.linear_dampening = pipeline->config.pending_linear_dampening;
+	pipeline->config.angular_dampening = pipeline->config.pending_angular_dampening;
+	pipeline->config.split_deferred = pipeline->config.pending_split_deferred;
+	pipeline->config.split_body_budget = pipeline->config.pending_split_body_budget;
+	pipeline->config.island_builder = pipeline->config.pending_island_builder;
+	pipeline->config.substep_count = pipeline->config.pending_substep_count;
+	pipeline->config.deterministic = pipeline->config.pending_deterministic;
+
+	if (pipeline->config.pending_sleep_enabled != pipeline->config.sleep_enabled)
 	{
-		(g_solver_config->pending_sleep_enabled)
+		(pipeline->config.pending_sleep_enabled)
 			? PhysicsPipelineSleepEnable(pipeline)
 			: PhysicsPipelineSleepDisable(pipeline);
 
-		g_solver_config->sleep_enabled = g_solver_config->pending_sleep_enabled;
+		pipeline->config.sleep_enabled = pipeline->config.pending_sleep_enabled;
 	}
 }
 
@@ -715,51 +891,411 @@ void PhysicsPipelineRigidBodyTagForRemoval(struct ds_RigidBodyPipeline *pipeline
 
 static void RemoveMarkedBodies(struct ds_RigidBodyPipeline *pipeline)
 {
+	if (pipeline->body_marked_list.count == 0)
+	{
+		return;
+	}
+
     struct arena tmp = ArenaAlloc1MB();
-    u32 next;
-	for (u32 i = pipeline->body_marked_list.first; i != DLL_NULL; i = next)
+	ArenaPushRecord(&pipeline->frame);
+	ds_RigidBodyId *id = ArenaPush(&pipeline->frame, pipeline->body_marked_list.count*sizeof(ds_RigidBodyId));
+	if (!id)
+	{
+		LogString(T_PHYSICS, S_FATAL, "Frame arena OOM in RemoveMarkedBodies, increase size!");
+		FatalCleanupAndExit();
+	}
+
+	u32 count = 0;
+	const struct ds_RigidBody *b = NULL;
+	for (u32 i = pipeline->body_marked_list.first; i != DLL_NULL; i = dll_Next(b))
 	{
-		struct ds_RigidBody *b = ds_PoolAddress(&pipeline->body_pool, i);
-        next = dll_Next(b);
-		ds_RigidBodyRemove(&tmp, pipeline, i);
+		b = ds_PoolAddress(&pipeline->body_pool, i);
+		id[count++] = ((u64) b->tag << 32) | i;
 	}
 
+	ds_RigidBodyRemoveBatch(&tmp, pipeline, id, count);
+	ds_Assert(pipeline->body_marked_list.count == 0);
 	dll_Flush(&pipeline->body_marked_list);
+	ArenaPopRecord(&pipeline->frame);
     ArenaFree1MB(&tmp);
 }
 
-void PhysicsPipelineSimulateFrame(struct ds_RigidBodyPipeline *pipeline, const f32 delta)
+void PhysicsPipelineFrameBegin(struct ds_RigidBodyPipeline *pipeline)
 {
+	ProfZone;
+
+	if (pipeline->frames_completed > 0)
+	{
+		PhysicsPipelineClearFrame(pipeline);
+	}
+	pipeline->frames_completed += 1;
+
 	RemoveMarkedBodies(pipeline);
 
 	/* update, if possible, any pending values in contact solver config */
 	UpdateSolverConfig(pipeline);
 
 	/* broadphase => narrowphase => solve => integrate */
-    CollisionDetection(pipeline);
+	CollisionDetectionPrepare(pipeline);
 
-	MergeIslands(pipeline);
-	SplitIslandsAndRemoveContacts(pipeline);
-	SolveIslands(pipeline, delta);
+	ProfZoneEnd;
+}
+
+void PhysicsPipelineFrameIslands(struct ds_RigidBodyPipeline *pipeline)
+{
+	ProfZone;
+
+	ContactManagement(pipeline);
+	if (pipeline->config.island_builder == ISLAND_BUILDER_UNION_FIND)
+	{
+		RemoveContacts(pipeline);
+		isdb_RebuildIslands(pipeline);
+	}
+	else
+	{
+		MergeIslands(pipeline);
+		RemoveContacts(pipeline);
+		isdb_SplitPendingIslands(pipeline);
+	}
+
+	const f32 delta = (f32) pipeline->ns_tick / NSEC_PER_SEC;
+	SolveIslandsPrepare(pipeline, delta);
+
+	ProfZoneEnd;
+}
+
+static u32 U32Max(const u32 a, const u32 b)
+{
+	return (a < b) ? b : a;
+}
+
+static void PhysicsPipelineHighWaterUpdate(struct ds_RigidBodyPipeline *pipeline)
+{
+	struct ds_PhysicsHighWater *hw = &pipeline->high_water;
+	hw->body = U32Max(hw->body, pipeline->body_pool.count);
+	hw->shape = U32Max(hw->shape, pipeline->shape_pool.count);
+	hw->bvh_node = U32Max(hw->bvh_node, pipeline->shape_bvh.tree.pool.count);
+	hw->contact = U32Max(hw->contact, pipeline->cdb->contact_net.pool.count);
+	hw->sat_cache = U32Max(hw->sat_cache, AtomicLoadRlx32(&pipeline->cdb->sat_cache_pool.a_count_max));
+	hw->island = U32Max(hw->island, pipeline->is_db.island_pool.count);
+	hw->awake = U32Max(hw->awake, pipeline->body_awake_list.next);
+	hw->event = U32Max(hw->event, pipeline->event.next);
+	for (u32 i = 0; i < pipeline->body_event_count; ++i)
+	{
+		hw->body_event = U32Max(hw->body_event, pipeline->body_event[i].events.next);
+	}
+}
+
+void PhysicsPipelineFrameEnd(struct ds_RigidBodyPipeline *pipeline)
+{
+	ProfZone;
+
+	SolveIslandsFinish(pipeline);
+	PhysicsPipelineHighWaterUpdate(pipeline);
+
+	pipeline->state_hash = (pipeline->config.deterministic)
+		? PhysicsPipelineStateHash(pipeline)
+		: 0;
 
 	PHYSICS_PIPELINE_VALIDATE(pipeline);
+
+	ProfZoneEnd;
 }
 
 void PhysicsPipelineTick(struct ds_RigidBodyPipeline *pipeline)
 {
 	ProfZone;
 
-	if (pipeline->frames_completed > 0)
+	PhysicsPipelineFrameBegin(pipeline);
 	{
-		PhysicsPipelineClearFrame(pipeline);
+		ProfZoneNamed("NarrowPhase");
+		/* acquire any task resources; the frame waits on the physics tick, so it runs in the high priority lane */
+		struct task_stream *stream = task_stream_init(&pipeline->frame);
+		task_stream_priority_set(stream, TASK_PRIORITY_HIGH);
+		PhysicsPipelineContactDispatch(&pipeline->frame, stream, pipeline, 0, pipeline->contact_input_count);
+		task_main_master_run_available_jobs();
+		/* spin wait until last job completes */
+		task_stream_spin_wait(stream);
+		/* release any task resources */
+		task_stream_cleanup(stream);		
+		ProfZoneEnd;
 	}
-	pipeline->frames_completed += 1;
-	const f32 delta = (f32) pipeline->ns_tick / NSEC_PER_SEC;
-	PhysicsPipelineSimulateFrame(pipeline, delta);
+
+	PhysicsPipelineFrameIslands(pipeline);
+	{
+		ProfZoneNamed("SolveIslands");
+		struct task_stream *stream = task_stream_init(&pipeline->frame);
+		task_stream_priority_set(stream, TASK_PRIORITY_HIGH);
+		PhysicsPipelineIslandDispatch(&pipeline->frame, stream, pipeline, 0, pipeline->island_input_count);
+		task_main_master_run_available_jobs();
+		task_stream_spin_wait(stream);
+		task_stream_cleanup(stream);		
+		ProfZoneEnd;
+	}
+	PhysicsPipelineFrameEnd(pipeline);
+
+	ProfZoneEnd;
+}
+
+u64 PhysicsPipelineStateHash(const struct ds_RigidBodyPipeline *pipeline)
+{
+	ProfZone;
+
+	/* chained hash; each link hashes the previous hash together with the state of the next body */
+	struct
+	{
+		u64             hash;
+		u32             index;
+		u32             flags;
+		u32             island_index;
+		u32             tag;
+		ds_Transform    t_world;
+		vec3            velocity;
+		vec3            angular_velocity;
+		f32             low_velocity_time;
+	} link;
+
+	memset(&link, 0, sizeof(link));
+	link.hash = pipeline->frames_completed;
+	for (u32 i = 0; i < pipeline->body_pool.count_max; ++i)
+	{
+		const struct ds_RigidBody *body = ds_PoolAddress(&pipeline->body_pool, i);
+		if (!PoolSlotAllocated(body))
+		{
+			continue;
+		}
+
+		link.index = i;
+		link.flags = body->flags;
+		link.island_index = body->island_index;
+		link.tag = body->tag;
+		link.t_world = body->t_world;
+		Vec3Copy(link.velocity, body->velocity);
+		Vec3Copy(link.angular_velocity, body->angular_velocity);
+		link.low_velocity_time = body->low_velocity_time;
+		link.hash = XXH3_64bits(&link, sizeof(link));
+	}
+
+	ProfZoneEnd;
+	return link.hash;
+}
+
+static u32 BodySnapshotLess(const struct ds_BodySnapshot *a, const struct ds_BodySnapshot *b)
+{
+	return (ds_IdIndex(a->body) < ds_IdIndex(b->body)) || (ds_IdIndex(a->body) == ds_IdIndex(b->body) && a->ns < b->ns);
+}
+
+static void BodySnapshotMerge(struct ds_BodySnapshot *snap, struct ds_BodySnapshot *tmp, const u32 left, const u32 mid, const u32 right)
+{
+	u32 l = left;
+	u32 r = mid;
+	const u32 count = right - left;
+
+	for (u32 i = left; i < right; ++i)
+	{
+		if (r < right && (l >= mid || BodySnapshotLess(snap + r, snap + l)))
+		{
+			tmp[i] = snap[r];
+			r += 1;
+		}
+		else
+		{
+			tmp[i] = snap[l];
+			l += 1;
+		}
+	}
+
+	memcpy(snap + left, tmp + left, count * sizeof(struct ds_BodySnapshot));
+}
+
+/* stable bottom-up merge sort of body snapshots on body index and time */
+static void BodySnapshotSort(struct arena *mem_tmp, struct ds_BodySnapshot *snap, const u32 count)
+{
+	ArenaPushRecord(mem_tmp);
+	struct ds_BodySnapshot *tmp = ArenaPush(mem_tmp, count*sizeof(struct ds_BodySnapshot));
+	if (count && !tmp)
+	{
+		LogString(T_PHYSICS, S_FATAL, "Frame arena OOM in BodySnapshotSort, increase size!");
+		FatalCleanupAndExit();
+	}
+
+	for (u32 width = 2; width/2 < count; width *= 2)
+	{
+		u32 i = 0;
+		for (; i + width <= count; i += width)
+		{
+			BodySnapshotMerge(snap, tmp, i, i + width/2, i + width);
+		}
+
+		if (i + width/2 < count)
+		{
+			BodySnapshotMerge(snap, tmp, i, i + width/2, count);
+		}
+	}
+
+	ArenaPopRecord(mem_tmp);
+}
+
+/* Move the pipeline events into the snapshot; orientation events are replaced by the current body state */
+static void PhysicsPipelineSnapshotCapture(struct ds_RigidBodyPipeline *pipeline, struct ds_PhysicsSnapshot *snapshot)
+{
+	ProfZone;
+
+	u32 body_count = 0;
+	for (u32 t = 0; t < pipeline->body_event_count; ++t)
+	{
+		body_count += pipeline->body_event[t].events.next;
+	}
+	const u32 event_count = pipeline->event.next;
+
+	ArenaFlush(&snapshot->mem);
+	snapshot->frames_completed = pipeline->frames_completed;
+	snapshot->state_hash = pipeline->state_hash;
+	snapshot->body_count = 0;
+	snapshot->event_count = event_count;
+	snapshot->bodies = ArenaPush(&snapshot->mem, body_count*sizeof(struct ds_BodySnapshot));
+	snapshot->events = ArenaPushMemcpy(&snapshot->mem, pipeline->event.arr, event_count*sizeof(struct physicsEvent));
+	if ((body_count && !snapshot->bodies) || (event_count && !snapshot->events))
+	{
+		LogString(T_PHYSICS, S_FATAL, "Snapshot arena OOM, increase size!");
+		FatalCleanupAndExit();
+	}
+
+	for (u32 t = 0; t < pipeline->body_event_count; ++t)
+	{
+		const stack_physicsEvent *buffer = &pipeline->body_event[t].events;
+		for (u32 i = 0; i < buffer->next; ++i)
+		{
+			const struct physicsEvent *event = buffer->arr + i;
+			const struct ds_RigidBody *body = ds_PoolAddress(&pipeline->body_pool, ds_IdIndex(event->body));
+			struct ds_BodySnapshot *snap = snapshot->bodies + snapshot->body_count++;
+			snap->ns = event->ns;
+			snap->body = event->body;
+			snap->entity = body->entity;
+			Vec3Copy(snap->position, body->t_world.position);
+			QuatCopy(snap->rotation, body->t_world.rotation);
+			Vec3Copy(snap->linear_velocity, body->velocity);
+			Vec3Copy(snap->angular_velocity, body->angular_velocity);
+		}
+	}
+
+	/* the per worker buffers are filled in task schedule order, so deterministic mode sorts the snapshot */
+	if (pipeline->config.deterministic)
+	{
+		BodySnapshotSort(&pipeline->frame, snapshot->bodies, snapshot->body_count);
+	}
+
+	PhysicsPipelineEventFlush(pipeline);
 
 	ProfZoneEnd;
 }
 
+static void ThreadPhysicsPipelineTick(void *task_addr)
+{
+	struct task *task = task_addr;
+	struct ds_RigidBodyPipeline *pipeline = task->input;
+
+	for (u64 i = 0; i < pipeline->async_frame_count; ++i)
+	{
+		PhysicsPipelineTick(pipeline);
+	}
+	PhysicsPipelineSnapshotCapture(pipeline, pipeline->snapshot + (1 - pipeline->snapshot_read));
+}
+
+void PhysicsPipelineAsyncEnable(struct ds_RigidBodyPipeline *pipeline, const u64 snapshot_memory)
+{
+	ds_Assert(!pipeline->async_enabled);
+
+	for (u32 i = 0; i < 2; ++i)
+	{
+		pipeline->snapshot[i].mem = ArenaAlloc(snapshot_memory);
+		pipeline->snapshot[i].bodies = NULL;
+		pipeline->snapshot[i].events = NULL;
+		pipeline->snapshot[i].body_count = 0;
+		pipeline->snapshot[i].event_count = 0;
+		pipeline->snapshot[i].frames_completed = pipeline->frames_completed;
+		pipeline->snapshot[i].state_hash = pipeline->state_hash;
+	}
+	pipeline->async_mem = ArenaAlloc(4096);
+	pipeline->async_stream = NULL;
+	pipeline->async_frame_count = 0;
+	pipeline->snapshot_read = 0;
+	pipeline->async_enabled = 1;
+}
+
+void PhysicsPipelineAsyncDisable(struct ds_RigidBodyPipeline *pipeline)
+{
+	ds_Assert(pipeline->async_enabled);
+
+	PhysicsPipelineFence(pipeline);
+	ArenaFree(&pipeline->snapshot[0].mem);
+	ArenaFree(&pipeline->snapshot[1].mem);
+	ArenaFree(&pipeline->async_mem);
+	pipeline->async_enabled = 0;
+}
+
+void PhysicsPipelineTickAsync(struct ds_RigidBodyPipeline *pipeline, const u64 frame_count)
+{
+	ProfZone;
+
+	ds_AssertString(pipeline->async_enabled, "Asynchronous ticking must be enabled before use");
+	ds_AssertString(pipeline->async_stream == NULL, "Fence in-flight ticks before starting new ones");
+
+	pipeline->async_frame_count = frame_count;
+	ArenaFlush(&pipeline->async_mem);
+	pipeline->async_stream = task_stream_init(&pipeline->async_mem);
+	if (frame_count && g_task_ctx->worker_count > 1)
+	{
+		/* the tick task takes over dispatching work until the fence */
+		task_stream_dispatch(&pipeline->async_mem, pipeline->async_stream, ThreadPhysicsPipelineTick, pipeline);
+	}
+	else
+	{
+		for (u64 i = 0; i < frame_count; ++i)
+		{
+			PhysicsPipelineTick(pipeline);
+		}
+		PhysicsPipelineSnapshotCapture(pipeline, pipeline->snapshot + (1 - pipeline->snapshot_read));
+	}
+
+	ProfZoneEnd;
+}
+
+void PhysicsPipelineFence(struct ds_RigidBodyPipeline *pipeline)
+{
+	if (!pipeline->async_enabled || pipeline->async_stream == NULL)
+	{
+		return;
+	}
+
+	ProfZone;
+
+	task_main_master_run_available_jobs();
+	/* spin wait until the tick task completes */
+	task_stream_spin_wait(pipeline->async_stream);
+	task_stream_cleanup(pipeline->async_stream);
+
+	pipeline->async_stream = NULL;
+	pipeline->snapshot_read = 1 - pipeline->snapshot_read;
+
+	ProfZoneEnd;
+}
+
+const struct ds_PhysicsSnapshot *PhysicsPipelineSnapshot(const struct ds_RigidBodyPipeline *pipeline)
+{
+	ds_Assert(pipeline->async_enabled);
+	return pipeline->snapshot + pipeline->snapshot_read;
+}
+
+void PhysicsPipelineSnapshotRelease(struct ds_RigidBodyPipeline *pipeline)
+{
+	ds_Assert(pipeline->async_enabled);
+	struct ds_PhysicsSnapshot *snapshot = pipeline->snapshot + pipeline->snapshot_read;
+	ArenaFlush(&snapshot->mem);
+	snapshot->body_count = 0;
+	snapshot->event_count = 0;
+}
+
 u32f32 PhysicsPipelineRaycastParameter(struct arena *mem_tmp1, struct arena *mem_tmp2, const struct ds_RigidBodyPipeline *pipeline, const struct ray *ray)
 {
 	ArenaPushRecord(mem_tmp1);
@@ -798,11 +1334,47 @@ u32f32 PhysicsPipelineRaycastParameter(struct arena *mem_tmp1, struct arena *mem
 
 struct physicsEvent *PhysicsPipelineEventPush(struct ds_RigidBodyPipeline *pipeline)
 {
-	struct slot slot = ds_PoolAdd(&pipeline->event_pool);
-	dll_Append(&pipeline->event_list, pipeline->event_pool.buf, slot.index);
-	struct physicsEvent *event = slot.address;
-	event->ns = pipeline->ns_start + pipeline->frames_completed * pipeline->ns_tick;
-	return event;
+	if (pipeline->event.next == pipeline->event.length && !pipeline->event.growable)
+	{
+		LogString(T_PHYSICS, S_FATAL, "Physics event buffer full, flush events more often or increase event_max, exiting.");
+		FatalCleanupAndExit();
+	}
+	stack_physicsEventPush(&pipeline->event, (struct physicsEvent) { .ns = pipeline->ns_start + pipeline->frames_completed * pipeline->ns_tick });
+	return pipeline->event.arr + pipeline->event.next - 1;
+}
+
+void PhysicsPipelineBodyEventPush(struct ds_RigidBodyPipeline *pipeline, const ds_RigidBodyId body)
+{
+	const u32 worker = task_worker_index();
+	if (worker >= pipeline->body_event_count)
+	{
+		Log(T_PHYSICS, S_FATAL, "Physics body event pushed from worker %u, but the pipeline was allocated for %u workers, exiting.", worker, pipeline->body_event_count);
+		FatalCleanupAndExit();
+	}
+
+	stack_physicsEvent *events = &pipeline->body_event[worker].events;
+	if (events->next == events->length && !events->growable)
+	{
+		LogString(T_PHYSICS, S_FATAL, "Physics body event buffer full, flush events more often or increase event_max, exiting.");
+		FatalCleanupAndExit();
+	}
+
+	const struct physicsEvent event =
+	{
+		.ns = pipeline->ns_start + pipeline->frames_completed * pipeline->ns_tick,
+		.type = PHYSICS_EVENT_BODY_ORIENTATION,
+		.body = body,
+	};
+	stack_physicsEventPush(events, event);
+}
+
+void PhysicsPipelineEventFlush(struct ds_RigidBodyPipeline *pipeline)
+{
+	stack_physicsEventFlush(&pipeline->event);
+	for (u32 i = 0; i < pipeline->body_event_count; ++i)
+	{
+		stack_physicsEventFlush(&pipeline->body_event[i].events);
+	}
 }
 
 void PhysicsPipelinePrintUsage(const struct ds_RigidBodyPipeline *pipeline)
@@ -811,10 +1383,24 @@ void PhysicsPipelinePrintUsage(const struct ds_RigidBodyPipeline *pipeline)
     fprintf(stderr, "\tbodies:                      %u\n", pipeline->body_pool.count);
     fprintf(stderr, "\tshapes:                      %u\n", pipeline->shape_pool.count);
     fprintf(stderr, "\tshape_bvh nodes:             %u\n", pipeline->shape_bvh.tree.pool.count);
-    fprintf(stderr, "\tevents:                      %u\n", pipeline->event_pool.count);
+    fprintf(stderr, "\tevents:                      %u\n", pipeline->event.next);
     fprintf(stderr, "\tislands:                     %u\n", pipeline->is_db.island_pool.count);
     fprintf(stderr, "\tcontacts:                    %u\n", pipeline->cdb->contact_net.pool.count);
     fprintf(stderr, "\tsat caches (max):            %u\n", AtomicLoadRlx32(&pipeline->cdb->sat_cache_pool.a_count_max));
-    fprintf(stderr, "\tcontact bitvector size:      %lu\n", pipeline->cdb->contact_persistent_usage.block_count*sizeof(u64));
-    fprintf(stderr, "\tsat cache bitvector size:    %lu\n", pipeline->cdb->sat_cache_persistent_usage.block_count*sizeof(u64));
+    fprintf(stderr, "\tcontact live list size:      %lu\n", pipeline->cdb->contact_live.length*sizeof(u32));
+    fprintf(stderr, "\tsat cache live list size:    %lu\n", pipeline->cdb->sat_cache_live.length*sizeof(u32));
+
+    const struct ds_PhysicsHighWater *hw = &pipeline->high_water;
+    fprintf(stderr, "Physics high-water marks (%s):\n", (pipeline->fixed) ? "fixed" : "growable");
+    fprintf(stderr, "\tbodies:                      %u / %u\n", hw->body, pipeline->body_pool.length);
+    fprintf(stderr, "\tshapes:                      %u / %u\n", hw->shape, pipeline->shape_pool.length);
+    fprintf(stderr, "\tshape_bvh nodes:             %u / %u\n", hw->bvh_node, pipeline->shape_bvh.tree.pool.length);
+    fprintf(stderr, "\tcontacts:                    %u / %u\n", hw->contact, pipeline->cdb->contact_net.pool.length);
+    fprintf(stderr, "\tsat caches:                  %u / %u\n", hw->sat_cache, AtomicLoadRlx32(&pipeline->cdb->sat_cache_pool.a_length));
+    fprintf(stderr, "\tislands:                     %u / %u\n", hw->island, pipeline->is_db.island_pool.length);
+    fprintf(stderr, "\tawake bodies:                %u / %u\n", hw->awake, pipeline->body_awake_list.length);
+    fprintf(stderr, "\tevents:                      %u / %u\n", hw->event, pipeline->event.length);
+    fprintf(stderr, "\tbody events (per thread):    %u\n", hw->body_event);
+    fprintf(stderr, "\tcontacts dropped:            %u\n", hw->contact_dropped);
+    fprintf(stderr, "\tsat caches dropped:          %u\n", hw->sat_cache_dropped);
 }
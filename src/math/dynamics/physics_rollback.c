@@ -0,0 +1,464 @@
+/*
+==========================================================================
+    Copyright (C) 2026 Axel Sandstedt
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+==========================================================================
+*/
+
+#include <string.h>
+
+#include "dynamics.h"
+
+struct physicsStatePool
+{
+	u32	count;
+	u32	count_max;
+	u32	next_free;
+};
+
+/* scalar pipeline state, saved as the first region of every state */
+struct physicsStateHeader
+{
+	u64			frames_completed;
+	u64			state_hash;
+	u64			ns_elapsed;
+
+	struct dll		body_marked_list;
+	struct dll		body_non_marked_list;
+	struct dll		island_list;
+
+	struct physicsStatePool	body;
+	struct physicsStatePool	shape;
+	struct physicsStatePool	bvh_node;
+	struct physicsStatePool	contact;
+	struct physicsStatePool	island;
+
+	u32			bvh_root;
+	u32			body_awake_count;
+	u32			contact_live_count;
+	u32			sat_cache_live_count;
+	u32			possible_split_count;
+	u32			contact_index_count;	/* used entries in cdb->contact_map.index */
+	u32			sat_cache_count_max;
+	u32			pad;
+};
+
+struct physicsStateRegion
+{
+	void *	addr;
+	u64	size;
+};
+
+/* delta mode: undo record of a page, followed by the page's bytes before the save */
+struct physicsStateUndo
+{
+	u64	offset;
+	u64	size;
+	u32	region;
+	u32	pad;
+};
+
+static struct physicsStatePool PhysicsStatePoolGet(const struct ds_Pool *pool)
+{
+	return (struct physicsStatePool) { .count = pool->count, .count_max = pool->count_max, .next_free = pool->next_free };
+}
+
+static void PhysicsStatePoolSet(struct ds_Pool *pool, const struct physicsStatePool *state)
+{
+	ds_AssertString(state->count_max <= pool->length, "Restoring state into a pool smaller than the saved pool");
+	pool->count = state->count;
+	pool->count_max = state->count_max;
+	pool->next_free = state->next_free;
+}
+
+static void PhysicsStateHeaderGet(struct physicsStateHeader *header, const struct ds_RigidBodyPipeline *pipeline)
+{
+	const struct cdb *cdb = pipeline->cdb;
+
+	memset(header, 0, sizeof(struct physicsStateHeader));
+	header->frames_completed = pipeline->frames_completed;
+	header->state_hash = pipeline->state_hash;
+	header->ns_elapsed = pipeline->ns_elapsed;
+
+	header->body_marked_list = pipeline->body_marked_list;
+	header->body_non_marked_list = pipeline->body_non_marked_list;
+	header->island_list = pipeline->is_db.island_list;
+
+	header->body = PhysicsStatePoolGet(&pipeline->body_pool);
+	header->shape = PhysicsStatePoolGet(&pipeline->shape_pool);
+	header->bvh_node = PhysicsStatePoolGet(&pipeline->shape_bvh.tree.pool);
+	header->contact = PhysicsStatePoolGet(&cdb->contact_net.pool);
+	header->island = PhysicsStatePoolGet(&pipeline->is_db.island_pool);
+
+	header->bvh_root = pipeline->shape_bvh.tree.root;
+	header->body_awake_count = pipeline->body_awake_list.next;
+	header->contact_live_count = cdb->contact_live.next;
+	header->sat_cache_live_count = cdb->sat_cache_live.next;
+	header->possible_split_count = pipeline->is_db.possible_splits.next;
+	header->contact_index_count = (cdb->contact_map.index_len < header->contact.count_max)
+		? cdb->contact_map.index_len
+		: header->contact.count_max;
+	header->sat_cache_count_max = cdb->sat_cache_pool.a_count_max;
+}
+
+static void PhysicsStateHeaderSet(struct ds_RigidBodyPipeline *pipeline, const struct physicsStateHeader *header)
+{
+	struct cdb *cdb = pipeline->cdb;
+
+	pipeline->frames_completed = header->frames_completed;
+	pipeline->state_hash = header->state_hash;
+	pipeline->ns_elapsed = header->ns_elapsed;
+
+	pipeline->body_marked_list = header->body_marked_list;
+	pipeline->body_non_marked_list = header->body_non_marked_list;
+	pipeline->is_db.island_list = header->island_list;
+
+	PhysicsStatePoolSet(&pipeline->body_pool, &header->body);
+	PhysicsStatePoolSet(&pipeline->shape_pool, &header->shape);
+	PhysicsStatePoolSet(&pipeline->shape_bvh.tree.pool, &header->bvh_node);
+	PhysicsStatePoolSet(&cdb->contact_net.pool, &header->contact);
+	PhysicsStatePoolSet(&pipeline->is_db.island_pool, &header->island);
+
+	ds_Assert(header->body_awake_count <= pipeline->body_awake_list.length);
+	ds_Assert(header->contact_live_count <= cdb->contact_live.length);
+	ds_Assert(header->sat_cache_live_count <= cdb->sat_cache_live.length);
+	ds_Assert(header->possible_split_count <= pipeline->is_db.possible_splits.length);
+	ds_Assert(header->contact_index_count <= cdb->contact_map.index_len);
+	ds_Assert(header->sat_cache_count_max <= cdb->sat_cache_pool.a_length);
+
+	pipeline->shape_bvh.tree.root = header->bvh_root;
+	pipeline->body_awake_list.next = header->body_awake_count;
+	cdb->contact_live.next = header->contact_live_count;
+	cdb->sat_cache_live.next = header->sat_cache_live_count;
+	pipeline->is_db.possible_splits.next = header->possible_split_count;
+	AtomicStoreRel32(&cdb->sat_cache_pool.a_count_max, header->sat_cache_count_max);
+
+	/* any frame data refers to the state we left */
+	cdb_ClearFrame(cdb);
+	stack_u32Flush(&cdb->sat_cache_touched);
+}
+
+/* Return the byte regions of the pipeline's containers that are in use according to header. */
+static u32 PhysicsStateRegions(struct physicsStateRegion *region, struct ds_RigidBodyPipeline *pipeline, const struct physicsStateHeader *header)
+{
+	struct cdb *cdb = pipeline->cdb;
+	u32 count = 0;
+
+	region[count++] = (struct physicsStateRegion) { (void *) header, sizeof(struct physicsStateHeader) };
+	region[count++] = (struct physicsStateRegion) { pipeline->body_pool.buf, header->body.count_max*pipeline->body_pool.slot_size };
+	region[count++] = (struct physicsStateRegion) { pipeline->shape_pool.buf, header->shape.count_max*pipeline->shape_pool.slot_size };
+	region[count++] = (struct physicsStateRegion) { pipeline->shape_bvh.tree.pool.buf, header->bvh_node.count_max*pipeline->shape_bvh.tree.pool.slot_size };
+	region[count++] = (struct physicsStateRegion) { cdb->contact_net.pool.buf, header->contact.count_max*cdb->contact_net.pool.slot_size };
+	region[count++] = (struct physicsStateRegion) { pipeline->is_db.island_pool.buf, header->island.count_max*pipeline->is_db.island_pool.slot_size };
+	region[count++] = (struct physicsStateRegion) { pipeline->body_awake_list.arr, header->body_awake_count*sizeof(u32) };
+	region[count++] = (struct physicsStateRegion) { cdb->contact_live.arr, header->contact_live_count*sizeof(u32) };
+	region[count++] = (struct physicsStateRegion) { cdb->sat_cache_live.arr, header->sat_cache_live_count*sizeof(u32) };
+	region[count++] = (struct physicsStateRegion) { pipeline->is_db.possible_splits.arr, header->possible_split_count*sizeof(u32) };
+	region[count++] = (struct physicsStateRegion) { cdb->contact_map.hash, cdb->contact_map.hash_len*sizeof(u32) };
+	region[count++] = (struct physicsStateRegion) { cdb->contact_map.index, header->contact_index_count*sizeof(u32) };
+	region[count++] = (struct physicsStateRegion) { cdb->sat_cache_map.a_hash, cdb->sat_cache_map.hash_len*sizeof(u64) };
+	region[count++] = (struct physicsStateRegion) { cdb->sat_cache_pool.t_free_list, cdb->sat_cache_pool.free_list_count*sizeof(cdb->sat_cache_pool.t_free_list[0]) };
+
+	/* sat caches [0, count_max) are spread over the blocks of the pool, see TPool */
+	const struct sat_CacheTPool *pool = &cdb->sat_cache_pool;
+	u32 left = header->sat_cache_count_max;
+	for (u32 block = 0; left; ++block)
+	{
+		ds_Assert(block < pool->block_count);
+		const u32 length = (block == 0)
+			? pool->initial_length
+			: pool->initial_length << (block-1);
+		const u32 slots = (left < length) ? left : length;
+		region[count++] = (struct physicsStateRegion) { pool->block[block], slots*sizeof(struct sat_Cache) };
+		left -= slots;
+	}
+
+	ds_Assert(count <= PHYSICS_STATE_REGION_MAX);
+	return count;
+}
+
+static u8 *PhysicsStateSlotBase(const struct ds_PhysicsStateSlot *slot)
+{
+	return slot->mem.stack_ptr - (slot->mem.mem_size - slot->mem.mem_left);
+}
+
+static void PhysicsStateSlotOOM(void)
+{
+	LogString(T_PHYSICS, S_FATAL, "Rollback slot OOM, increase size!");
+	FatalCleanupAndExit();
+}
+
+static void PhysicsStateSaveFull(struct ds_PhysicsStateSlot *slot, const struct physicsStateRegion *region, const u32 region_count)
+{
+	for (u32 i = 0; i < region_count; ++i)
+	{
+		if (region[i].size && !ArenaPushAlignedMemcpy(&slot->mem, region[i].addr, region[i].size, 8))
+		{
+			PhysicsStateSlotOOM();
+		}
+	}
+}
+
+/* Copy the regions into the shadow state, pushing the previous contents of every changed page onto the slot */
+static void PhysicsStateSaveDelta(struct ds_PhysicsRollback *rollback, struct ds_PhysicsStateSlot *slot, const struct physicsStateRegion *region, const u32 region_count)
+{
+	if (!ArenaPushAlignedMemcpy(&slot->mem, rollback->shadow_size, sizeof(rollback->shadow_size), 8))
+	{
+		PhysicsStateSlotOOM();
+	}
+
+	for (u32 r = 0; r < PHYSICS_STATE_REGION_MAX; ++r)
+	{
+		const u8 *addr = (r < region_count) ? region[r].addr : NULL;
+		const u64 size = (r < region_count) ? region[r].size : 0;
+		const u64 size_old = rollback->shadow_size[r];
+		struct ds_MemSlot *shadow = rollback->shadow + r;
+
+		if (shadow->size < size)
+		{
+			(shadow->address)
+				? ds_Realloc(shadow, ds_AllocSizeCeil(size))
+				: ds_Alloc(shadow, size, NO_HUGE_PAGES);
+			if (!shadow->address)
+			{
+				LogString(T_PHYSICS, S_FATAL, "Failed to allocate rollback shadow state, exiting.");
+				FatalCleanupAndExit();
+			}
+		}
+
+		u8 *bytes = shadow->address;
+		for (u64 offset = 0; offset < size_old; offset += rollback->page_size)
+		{
+			const u64 page_old = (size_old - offset < rollback->page_size) ? size_old - offset : rollback->page_size;
+			const u64 page_new = (offset >= size) ? 0
+				: (size - offset < rollback->page_size) ? size - offset : rollback->page_size;
+			if (page_old == page_new && memcmp(bytes + offset, addr + offset, page_old) == 0)
+			{
+				continue;
+			}
+
+			struct physicsStateUndo *undo = ArenaPushAligned(&slot->mem, sizeof(struct physicsStateUndo), 8);
+			if (!undo || !ArenaPushAlignedMemcpy(&slot->mem, bytes + offset, page_old, 8))
+			{
+				PhysicsStateSlotOOM();
+			}
+			undo->offset = offset;
+			undo->size = page_old;
+			undo->region = r;
+			undo->pad = 0;
+		}
+
+		if (size)
+		{
+			memcpy(bytes, addr, size);
+		}
+		rollback->shadow_size[r] = size;
+	}
+}
+
+/* Return the shadow state to its state before the slot's save */
+static void PhysicsStateUndoDelta(struct ds_PhysicsRollback *rollback, const struct ds_PhysicsStateSlot *slot)
+{
+	const u8 *base = PhysicsStateSlotBase(slot);
+	const u8 *end = slot->mem.stack_ptr;
+	const u8 *cursor = base + sizeof(rollback->shadow_size);
+	while (cursor < end)
+	{
+		const struct physicsStateUndo *undo = (const struct physicsStateUndo *) cursor;
+		cursor += sizeof(struct physicsStateUndo);
+		memcpy((u8 *) rollback->shadow[undo->region].address + undo->offset, cursor, undo->size);
+		cursor += (undo->size + 7) & ~((u64) 7);
+	}
+
+	memcpy(rollback->shadow_size, base, sizeof(rollback->shadow_size));
+}
+
+struct ds_PhysicsRollback PhysicsRollbackAlloc(const u32 slot_count, const u64 slot_memory, const u32 delta)
+{
+	ds_Assert(slot_count > 0);
+
+	struct ds_PhysicsRollback rollback = { 0 };
+	rollback.slot = ds_Alloc(&rollback.mem_slot, slot_count*sizeof(struct ds_PhysicsStateSlot), NO_HUGE_PAGES);
+	if (!rollback.slot)
+	{
+		LogString(T_PHYSICS, S_FATAL, "Failed to allocate rollback slots, exiting.");
+		FatalCleanupAndExit();
+	}
+
+	for (u32 i = 0; i < slot_count; ++i)
+	{
+		rollback.slot[i].mem = ArenaAlloc(slot_memory);
+		rollback.slot[i].frames_completed = U64_MAX;
+		if (!rollback.slot[i].mem.mem_size)
+		{
+			LogString(T_PHYSICS, S_FATAL, "Failed to allocate rollback slot memory, exiting.");
+			FatalCleanupAndExit();
+		}
+	}
+
+	rollback.slot_count = slot_count;
+	rollback.slot_next = 0;
+	rollback.save_count = 0;
+	rollback.delta = delta;
+	rollback.page_size = g_arch_config->pagesize;
+
+	return rollback;
+}
+
+void PhysicsRollbackFree(struct ds_PhysicsRollback *rollback)
+{
+	for (u32 i = 0; i < rollback->slot_count; ++i)
+	{
+		ArenaFree(&rollback->slot[i].mem);
+	}
+
+	for (u32 r = 0; r < PHYSICS_STATE_REGION_MAX; ++r)
+	{
+		if (rollback->shadow[r].address)
+		{
+			ds_Free(rollback->shadow + r);
+		}
+	}
+
+	ds_Free(&rollback->mem_slot);
+	*rollback = (struct ds_PhysicsRollback) { 0 };
+}
+
+void PhysicsRollbackFlush(struct ds_PhysicsRollback *rollback)
+{
+	for (u32 i = 0; i < rollback->slot_count; ++i)
+	{
+		ArenaFlush(&rollback->slot[i].mem);
+		rollback->slot[i].frames_completed = U64_MAX;
+	}
+
+	for (u32 r = 0; r < PHYSICS_STATE_REGION_MAX; ++r)
+	{
+		rollback->shadow_size[r] = 0;
+	}
+
+	rollback->slot_next = 0;
+	rollback->save_count = 0;
+}
+
+void PhysicsPipelineSave(struct ds_PhysicsRollback *rollback, struct ds_RigidBodyPipeline *pipeline)
+{
+	ProfZone;
+
+	ds_AssertString(pipeline->async_stream == NULL, "Fence any in-flight ticks before saving the pipeline");
+	ds_AssertString(rollback->save_count == 0
+		|| rollback->slot[(rollback->slot_next + rollback->slot_count - 1) % rollback->slot_count].frames_completed < pipeline->frames_completed,
+		"Pipeline saves must be taken in increasing frame order");
+
+	struct physicsStateHeader header;
+	struct physicsStateRegion region[PHYSICS_STATE_REGION_MAX];
+	PhysicsStateHeaderGet(&header, pipeline);
+	const u32 region_count = PhysicsStateRegions(region, pipeline, &header);
+	/* free pool slots are poisoned */
+	for (u32 r = 0; r < region_count; ++r)
+	{
+		UnpoisonAddress(region[r].addr, region[r].size);
+	}
+
+	struct ds_PhysicsStateSlot *slot = rollback->slot + rollback->slot_next;
+	ArenaFlush(&slot->mem);
+	slot->frames_completed = pipeline->frames_completed;
+	(rollback->delta)
+		? PhysicsStateSaveDelta(rollback, slot, region, region_count)
+		: PhysicsStateSaveFull(slot, region, region_count);
+
+	rollback->slot_next = (rollback->slot_next + 1) % rollback->slot_count;
+	rollback->save_count += (rollback->save_count < rollback->slot_count);
+
+	ProfZoneEnd;
+}
+
+u32 PhysicsPipelineRestore(struct ds_RigidBodyPipeline *pipeline, struct ds_PhysicsRollback *rollback, const u64 frame)
+{
+	ProfZone;
+
+	ds_AssertString(pipeline->async_stream == NULL, "Fence any in-flight ticks before restoring the pipeline");
+
+	/* number of saves later than frame */
+	u32 later = U32_MAX;
+	for (u32 i = 0; i < rollback->save_count; ++i)
+	{
+		const u32 s = (rollback->slot_next + rollback->slot_count - 1 - i) % rollback->slot_count;
+		if (rollback->slot[s].frames_completed == frame)
+		{
+			later = i;
+			break;
+		}
+	}
+
+	if (later == U32_MAX)
+	{
+		ProfZoneEnd;
+		return 0;
+	}
+
+	const u8 *src[PHYSICS_STATE_REGION_MAX];
+	const u32 s = (rollback->slot_next + rollback->slot_count - 1 - later) % rollback->slot_count;
+	const struct physicsStateHeader *header;
+	if (rollback->delta)
+	{
+		for (u32 i = 0; i < later; ++i)
+		{
+			PhysicsStateUndoDelta(rollback, rollback->slot + (rollback->slot_next + rollback->slot_count - 1 - i) % rollback->slot_count);
+		}
+
+		header = rollback->shadow[0].address;
+		for (u32 r = 0; r < PHYSICS_STATE_REGION_MAX; ++r)
+		{
+			src[r] = rollback->shadow[r].address;
+		}
+	}
+	else
+	{
+		/* regions are stored back to back, each 8 byte aligned */
+		const u8 *cursor = PhysicsStateSlotBase(rollback->slot + s);
+		header = (const struct physicsStateHeader *) cursor;
+		struct physicsStateRegion region[PHYSICS_STATE_REGION_MAX];
+		const u32 region_count = PhysicsStateRegions(region, pipeline, header);
+		for (u32 r = 0; r < region_count; ++r)
+		{
+			src[r] = cursor;
+			cursor += (region[r].size + 7) & ~((u64) 7);
+		}
+	}
+
+	struct physicsStateRegion region[PHYSICS_STATE_REGION_MAX];
+	const u32 region_count = PhysicsStateRegions(region, pipeline, header);
+	PhysicsStateHeaderSet(pipeline, header);
+	for (u32 r = 1; r < region_count; ++r)
+	{
+		if (region[r].size)
+		{
+			UnpoisonAddress(region[r].addr, region[r].size);
+			memcpy(region[r].addr, src[r], region[r].size);
+		}
+	}
+
+	/* events of the discarded frames are stale */
+	PhysicsPipelineEventFlush(pipeline);
+
+	rollback->slot_next = (s + 1) % rollback->slot_count;
+	rollback->save_count -= later;
+
+	PHYSICS_PIPELINE_VALIDATE(pipeline);
+
+	ProfZoneEnd;
+	return 1;
+}
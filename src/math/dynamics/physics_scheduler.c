@@ -0,0 +1,142 @@
+/*
+==========================================================================
+    Copyright (C) 2026 Axel Sandstedt
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+==========================================================================
+*/
+
+#include "dynamics.h"
+#include "ds_job.h"
+
+struct ds_PhysicsScheduler PhysicsSchedulerAlloc(const u32 pipeline_max, const u64 task_memory)
+{
+	ds_Assert(pipeline_max > 0);
+
+	struct ds_PhysicsScheduler scheduler = { 0 };
+	scheduler.pipeline = ds_Alloc(&scheduler.mem_pipeline, pipeline_max*sizeof(struct ds_RigidBodyPipeline *), NO_HUGE_PAGES);
+	scheduler.mem = ArenaAlloc(task_memory);
+	if (!scheduler.pipeline || !scheduler.mem.mem_size)
+	{
+		LogString(T_PHYSICS, S_FATAL, "Failed to allocate physics scheduler, exiting.");
+		FatalCleanupAndExit();
+	}
+
+	scheduler.pipeline_count = 0;
+	scheduler.pipeline_max = pipeline_max;
+
+	return scheduler;
+}
+
+void PhysicsSchedulerFree(struct ds_PhysicsScheduler *scheduler)
+{
+	ArenaFree(&scheduler->mem);
+	ds_Free(&scheduler->mem_pipeline);
+	scheduler->pipeline_count = 0;
+	scheduler->pipeline_max = 0;
+}
+
+void PhysicsSchedulerAdd(struct ds_PhysicsScheduler *scheduler, struct ds_RigidBodyPipeline *pipeline)
+{
+	ds_AssertString(!pipeline->async_enabled, "Scheduled pipelines are ticked by the scheduler only");
+	ds_AssertString(scheduler->pipeline_count < scheduler->pipeline_max, "Physics scheduler is full");
+	scheduler->pipeline[scheduler->pipeline_count++] = pipeline;
+}
+
+void PhysicsSchedulerRemove(struct ds_PhysicsScheduler *scheduler, struct ds_RigidBodyPipeline *pipeline)
+{
+	for (u32 i = 0; i < scheduler->pipeline_count; ++i)
+	{
+		if (scheduler->pipeline[i] == pipeline)
+		{
+			scheduler->pipeline_count -= 1;
+			scheduler->pipeline[i] = scheduler->pipeline[scheduler->pipeline_count];
+			break;
+		}
+	}
+}
+
+static void ThreadPhysicsFrameBegin(void *task_addr)
+{
+	struct task *task = task_addr;
+	PhysicsPipelineFrameBegin(task->input);
+}
+
+static void ThreadPhysicsContacts(void *task_addr)
+{
+	struct task *task = task_addr;
+	struct ds_RigidBodyPipeline *pipeline = task->input;
+	/* the frame arena is owned by the stage running on the pipeline */
+	PhysicsPipelineContactFork(&pipeline->frame, task, pipeline);
+}
+
+static void ThreadPhysicsFrameIslands(void *task_addr)
+{
+	struct task *task = task_addr;
+	PhysicsPipelineFrameIslands(task->input);
+}
+
+static void ThreadPhysicsIslands(void *task_addr)
+{
+	struct task *task = task_addr;
+	struct ds_RigidBodyPipeline *pipeline = task->input;
+	PhysicsPipelineIslandFork(&pipeline->frame, task, pipeline);
+}
+
+static void ThreadPhysicsFrameEnd(void *task_addr)
+{
+	struct task *task = task_addr;
+	PhysicsPipelineFrameEnd(task->input);
+}
+
+void PhysicsSchedulerTick(struct ds_PhysicsScheduler *scheduler)
+{
+	ProfZone;
+
+	ArenaFlush(&scheduler->mem);
+
+	/*
+	 * Every pipeline is a chain 
+	 *
+	 * 	FrameBegin => Contacts (forks narrowphase) => FrameIslands => Islands (forks island solves) => FrameEnd
+	 *
+	 * and the chains are independent, so one pipeline may solve islands while another is in its narrowphase.
+	 */
+	struct task_graph *graph = task_graph_init(&scheduler->mem);
+	for (u32 i = 0; i < scheduler->pipeline_count; ++i)
+	{
+		struct ds_RigidBodyPipeline *pipeline = scheduler->pipeline[i];
+		struct task_graph_node *begin = task_graph_add(&scheduler->mem, graph, ThreadPhysicsFrameBegin, pipeline);
+		struct task_graph_node *contacts = task_graph_add(&scheduler->mem, graph, ThreadPhysicsContacts, pipeline);
+		struct task_graph_node *islands = task_graph_add(&scheduler->mem, graph, ThreadPhysicsFrameIslands, pipeline);
+		struct task_graph_node *solve = task_graph_add(&scheduler->mem, graph, ThreadPhysicsIslands, pipeline);
+		struct task_graph_node *end = task_graph_add(&scheduler->mem, graph, ThreadPhysicsFrameEnd, pipeline);
+		task_graph_depend(&scheduler->mem, contacts, begin);
+		task_graph_depend(&scheduler->mem, islands, contacts);
+		task_graph_depend(&scheduler->mem, solve, islands);
+		task_graph_depend(&scheduler->mem, end, solve);
+
+		/* the frame waits on the tick, forks inherit the priority of their node */
+		task_graph_node_priority_set(begin, TASK_PRIORITY_HIGH);
+		task_graph_node_priority_set(contacts, TASK_PRIORITY_HIGH);
+		task_graph_node_priority_set(islands, TASK_PRIORITY_HIGH);
+		task_graph_node_priority_set(solve, TASK_PRIORITY_HIGH);
+		task_graph_node_priority_set(end, TASK_PRIORITY_HIGH);
+	}
+
+	task_graph_dispatch(graph);
+	task_graph_wait(graph);
+
+	ProfZoneEnd;
+}
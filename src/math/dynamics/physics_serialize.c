@@ -0,0 +1,342 @@
+/*
+==========================================================================
+    Copyright (C) 2026 Axel Sandstedt
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+==========================================================================
+*/
+
+#include <string.h>
+#include <stddef.h>
+
+#include "dynamics.h"
+#include "ds_serialize.h"
+
+/*
+ * Serialized pipeline layout (scalars big endian):
+ *
+ *	[ magic | version | byte order marker (native) | slot sizes ]
+ *	[ frames_completed | state_hash | ns_elapsed ]
+ *	[ body pool | shape pool | bvh node pool | contact pool | island pool ]
+ *	[ body lists | island list | bvh root ]
+ *	[ awake bodies | live contacts | possible splits ]
+ *	[ contact map | sat caches ]
+ *
+ * Pool slots only link to other slots through indices, so each pool is written as its raw slot array
+ * [0, count_max) together with (count, count_max, next_free), and read back in a single bulk read. Slot
+ * contents are native, so streams only load on machines with the same byte order and struct layout; this
+ * is checked through the byte order marker and slot sizes. Sat caches live in a thread-local pool whose
+ * layout depends on the worker count, so they are instead written as a list of live cache payloads and
+ * re-added on load.
+ */
+#define PHYSICS_SERIALIZE_MAGIC		0x44535050	/* "DSPP" */
+#define PHYSICS_SERIALIZE_VERSION	1
+#define PHYSICS_SERIALIZE_BOM		0x01020304
+
+/* serialized part of a sat_Cache, everything from the key onwards */
+#define SAT_CACHE_PAYLOAD_OFFSET	offsetof(struct sat_Cache, key)
+#define SAT_CACHE_PAYLOAD_SIZE		(sizeof(struct sat_Cache) - SAT_CACHE_PAYLOAD_OFFSET)
+
+static u64 PoolSerializeSize(const struct ds_Pool *pool)
+{
+	return 3*sizeof(u32) + pool->count_max*pool->slot_size;
+}
+
+static void PoolSerialize(struct ss *ss, const struct ds_Pool *pool)
+{
+	ss_WriteU32Be(ss, pool->count);
+	ss_WriteU32Be(ss, pool->count_max);
+	ss_WriteU32Be(ss, pool->next_free);
+	UnpoisonAddress(pool->buf, pool->count_max*pool->slot_size);
+	ss_Write8N(ss, (b8 *) pool->buf, pool->count_max*pool->slot_size);
+}
+
+static u32 PoolDeserialize(struct ds_Pool *pool, struct ss *ss)
+{
+	if (3*sizeof(u32) > ss_BytesLeft(ss))
+	{
+		return 0;
+	}
+
+	const u32 count = ss_ReadU32Be(ss);
+	const u32 count_max = ss_ReadU32Be(ss);
+	const u32 next_free = ss_ReadU32Be(ss);
+	if (count > count_max || (u64) count_max*pool->slot_size > ss_BytesLeft(ss) || !ds_PoolReserve(pool, count_max))
+	{
+		return 0;
+	}
+
+	UnpoisonAddress(pool->buf, count_max*pool->slot_size);
+	ss_Read8N((b8 *) pool->buf, ss, count_max*pool->slot_size);
+	pool->count = count;
+	pool->count_max = count_max;
+	pool->next_free = next_free;
+	return 1;
+}
+
+static u64 StackSerializeSize(const stack_u32 *stack)
+{
+	return (1 + stack->next)*sizeof(u32);
+}
+
+static void StackSerialize(struct ss *ss, const stack_u32 *stack)
+{
+	ss_WriteU32Be(ss, stack->next);
+	ss_WriteU32BeN(ss, stack->arr, stack->next);
+}
+
+static u32 StackDeserialize(stack_u32 *stack, struct ss *ss)
+{
+	if (sizeof(u32) > ss_BytesLeft(ss))
+	{
+		return 0;
+	}
+
+	const u32 count = ss_ReadU32Be(ss);
+	if ((u64) count*sizeof(u32) > ss_BytesLeft(ss))
+	{
+		return 0;
+	}
+
+	stack_u32Flush(stack);
+	for (u32 i = 0; i < count; ++i)
+	{
+		stack_u32Push(stack, ss_ReadU32Be(ss));
+	}
+	return 1;
+}
+
+static void DllSerialize(struct ss *ss, const struct dll *list)
+{
+	ss_WriteU32Be(ss, list->count);
+	ss_WriteU32Be(ss, list->first);
+	ss_WriteU32Be(ss, list->last);
+}
+
+static void DllDeserialize(struct dll *list, struct ss *ss)
+{
+	list->count = ss_ReadU32Be(ss);
+	list->first = ss_ReadU32Be(ss);
+	list->last = ss_ReadU32Be(ss);
+}
+
+static void SatCacheSerialize(struct ss *ss, const struct cdb *cdb)
+{
+	ss_WriteU32Be(ss, cdb->sat_cache_live.next);
+	for (u32 i = 0; i < cdb->sat_cache_live.next; ++i)
+	{
+		const struct sat_Cache *sat = sat_CacheTPoolAddress(&cdb->sat_cache_pool, cdb->sat_cache_live.arr[i]);
+		ss_Write8N(ss, (const b8 *) sat + SAT_CACHE_PAYLOAD_OFFSET, SAT_CACHE_PAYLOAD_SIZE);
+	}
+}
+
+static u32 SatCacheDeserialize(struct cdb *cdb, struct ss *ss)
+{
+	if (sizeof(u32) > ss_BytesLeft(ss))
+	{
+		return 0;
+	}
+
+	const u32 count = ss_ReadU32Be(ss);
+	if ((u64) count*SAT_CACHE_PAYLOAD_SIZE > ss_BytesLeft(ss))
+	{
+		return 0;
+	}
+
+	for (u32 i = 0; i < count; ++i)
+	{
+		struct sat_CacheKey key;
+		struct ss peek = *ss;
+		ss_Read8N((b8 *) &key, &peek, sizeof(key));
+
+		const struct slot slot = sat_CacheAdd(cdb, &key);
+		ss_Read8N((b8 *) slot.address + SAT_CACHE_PAYLOAD_OFFSET, ss, SAT_CACHE_PAYLOAD_SIZE);
+		stack_u32Push(&cdb->sat_cache_live, slot.index);
+	}
+	return 1;
+}
+
+u64 PhysicsPipelineSerializeSize(const struct ds_RigidBodyPipeline *pipeline)
+{
+	const struct cdb *cdb = pipeline->cdb;
+	return 3*sizeof(u32) + 5*sizeof(u64) + 3*sizeof(u64)
+		+ PoolSerializeSize(&pipeline->body_pool)
+		+ PoolSerializeSize(&pipeline->shape_pool)
+		+ PoolSerializeSize(&pipeline->shape_bvh.tree.pool)
+		+ PoolSerializeSize(&cdb->contact_net.pool)
+		+ PoolSerializeSize(&pipeline->is_db.island_pool)
+		+ 10*sizeof(u32)
+		+ StackSerializeSize(&pipeline->body_awake_list)
+		+ StackSerializeSize(&cdb->contact_live)
+		+ StackSerializeSize(&pipeline->is_db.possible_splits)
+		+ (2 + cdb->contact_map.hash_len + cdb->contact_map.index_len)*sizeof(u32)
+		+ sizeof(u32) + cdb->sat_cache_live.next*SAT_CACHE_PAYLOAD_SIZE;
+}
+
+u32 PhysicsPipelineSerialize(struct ss *ss, const struct ds_RigidBodyPipeline *pipeline)
+{
+	ProfZone;
+
+	ds_AssertString(pipeline->async_stream == NULL, "Fence any in-flight ticks before serializing the pipeline");
+	if (PhysicsPipelineSerializeSize(pipeline) > ss_BytesLeft(ss))
+	{
+		Log(T_PHYSICS, S_ERROR, "Serializing physics pipeline past byte boundary: Trying to write %luB with %luB left.", PhysicsPipelineSerializeSize(pipeline), ss_BytesLeft(ss));
+		ProfZoneEnd;
+		return 0;
+	}
+
+	const struct cdb *cdb = pipeline->cdb;
+	const u32 bom = PHYSICS_SERIALIZE_BOM;
+	ss_WriteU32Be(ss, PHYSICS_SERIALIZE_MAGIC);
+	ss_WriteU32Be(ss, PHYSICS_SERIALIZE_VERSION);
+	ss_Write8N(ss, (const b8 *) &bom, sizeof(bom));
+	ss_WriteU64Be(ss, pipeline->body_pool.slot_size);
+	ss_WriteU64Be(ss, pipeline->shape_pool.slot_size);
+	ss_WriteU64Be(ss, pipeline->shape_bvh.tree.pool.slot_size);
+	ss_WriteU64Be(ss, cdb->contact_net.pool.slot_size);
+	ss_WriteU64Be(ss, pipeline->is_db.island_pool.slot_size);
+
+	ss_WriteU64Be(ss, pipeline->frames_completed);
+	ss_WriteU64Be(ss, pipeline->state_hash);
+	ss_WriteU64Be(ss, pipeline->ns_elapsed);
+
+	PoolSerialize(ss, &pipeline->body_pool);
+	PoolSerialize(ss, &pipeline->shape_pool);
+	PoolSerialize(ss, &pipeline->shape_bvh.tree.pool);
+	PoolSerialize(ss, &cdb->contact_net.pool);
+	PoolSerialize(ss, &pipeline->is_db.island_pool);
+
+	DllSerialize(ss, &pipeline->body_marked_list);
+	DllSerialize(ss, &pipeline->body_non_marked_list);
+	DllSerialize(ss, &pipeline->is_db.island_list);
+	ss_WriteU32Be(ss, pipeline->shape_bvh.tree.root);
+
+	StackSerialize(ss, &pipeline->body_awake_list);
+	StackSerialize(ss, &cdb->contact_live);
+	StackSerialize(ss, &pipeline->is_db.possible_splits);
+
+	ds_HashMapSerialize(ss, &cdb->contact_map);
+	SatCacheSerialize(ss, cdb);
+
+	ProfZoneEnd;
+	return 1;
+}
+
+u32 PhysicsPipelineDeserialize(struct ds_RigidBodyPipeline *pipeline, struct ss *ss)
+{
+	ProfZone;
+
+	PhysicsPipelineFlush(pipeline);
+	struct cdb *cdb = pipeline->cdb;
+
+	u32 bom = 0;
+	u32 success = 0;
+	if (3*sizeof(u32) + 5*sizeof(u64) + 3*sizeof(u64) > ss_BytesLeft(ss))
+	{
+		Log(T_PHYSICS, S_ERROR, "Deserializing physics pipeline past byte boundary: %luB left.", ss_BytesLeft(ss));
+		goto end;
+	}
+
+	const u32 magic = ss_ReadU32Be(ss);
+	const u32 version = ss_ReadU32Be(ss);
+	ss_Read8N((b8 *) &bom, ss, sizeof(bom));
+	const u64 body_size = ss_ReadU64Be(ss);
+	const u64 shape_size = ss_ReadU64Be(ss);
+	const u64 node_size = ss_ReadU64Be(ss);
+	const u64 contact_size = ss_ReadU64Be(ss);
+	const u64 island_size = ss_ReadU64Be(ss);
+	if (magic != PHYSICS_SERIALIZE_MAGIC || version != PHYSICS_SERIALIZE_VERSION || bom != PHYSICS_SERIALIZE_BOM
+			|| body_size != pipeline->body_pool.slot_size
+			|| shape_size != pipeline->shape_pool.slot_size
+			|| node_size != pipeline->shape_bvh.tree.pool.slot_size
+			|| contact_size != cdb->contact_net.pool.slot_size
+			|| island_size != pipeline->is_db.island_pool.slot_size)
+	{
+		LogString(T_PHYSICS, S_ERROR, "Deserializing physics pipeline: stream is not a compatible physics pipeline");
+		goto end;
+	}
+
+	pipeline->frames_completed = ss_ReadU64Be(ss);
+	pipeline->state_hash = ss_ReadU64Be(ss);
+	pipeline->ns_elapsed = ss_ReadU64Be(ss);
+
+	if (!PoolDeserialize(&pipeline->body_pool, ss)
+			|| !PoolDeserialize(&pipeline->shape_pool, ss)
+			|| !PoolDeserialize(&pipeline->shape_bvh.tree.pool, ss)
+			|| !PoolDeserialize(&cdb->contact_net.pool, ss)
+			|| !PoolDeserialize(&pipeline->is_db.island_pool, ss)
+			|| 10*sizeof(u32) > ss_BytesLeft(ss))
+	{
+		LogString(T_PHYSICS, S_ERROR, "Deserializing physics pipeline: truncated pools");
+		goto end;
+	}
+
+	DllDeserialize(&pipeline->body_marked_list, ss);
+	DllDeserialize(&pipeline->body_non_marked_list, ss);
+	DllDeserialize(&pipeline->is_db.island_list, ss);
+	pipeline->shape_bvh.tree.root = ss_ReadU32Be(ss);
+
+	if (!StackDeserialize(&pipeline->body_awake_list, ss)
+			|| !StackDeserialize(&cdb->contact_live, ss)
+			|| !StackDeserialize(&pipeline->is_db.possible_splits, ss))
+	{
+		LogString(T_PHYSICS, S_ERROR, "Deserializing physics pipeline: truncated stacks");
+		goto end;
+	}
+
+	/* a fixed capacity pipeline keeps a fixed contact map that must index every contact slot */
+	const u32 contact_map_growable = cdb->contact_map.growable;
+	struct ds_HashMap contact_map = ds_HashMapDeserialize(NULL, ss, contact_map_growable);
+	if (!contact_map.hash)
+	{
+		LogString(T_PHYSICS, S_ERROR, "Deserializing physics pipeline: truncated contact map");
+		goto end;
+	}
+
+	if (!contact_map_growable && contact_map.index_len < cdb->contact_net.pool.length)
+	{
+		ds_HashMapDealloc(&contact_map);
+		LogString(T_PHYSICS, S_ERROR, "Deserializing physics pipeline: contact map smaller than fixed contact capacity");
+		goto end;
+	}
+	ds_HashMapDealloc(&cdb->contact_map);
+	cdb->contact_map = contact_map;
+
+	if (!SatCacheDeserialize(cdb, ss))
+	{
+		LogString(T_PHYSICS, S_ERROR, "Deserializing physics pipeline: truncated sat caches");
+		goto end;
+	}
+
+	/* frame-local island pointers are stale */
+	struct ds_Island *is = NULL;
+	for (u32 i = pipeline->is_db.island_list.first; i != DLL_NULL; i = dll_Next(is))
+	{
+		is = ds_PoolAddress(&pipeline->is_db.island_pool, i);
+		is->bodies = NULL;
+		is->contacts = NULL;
+		is->body_index_map = NULL;
+	}
+
+	success = 1;
+	PHYSICS_PIPELINE_VALIDATE(pipeline);
+end:
+	if (!success)
+	{
+		PhysicsPipelineFlush(pipeline);
+	}
+
+	ProfZoneEnd;
+	return success;
+}
@@ -18,6 +18,7 @@
 */
 
 #include <stdlib.h>
+#include <string.h>
 
 #include "ds_random.h"
 #include "ds_job.h"
@@ -27,9 +28,71 @@ struct task_context *g_task_ctx = &t_ctx;
 
 u32 a_startup_complete = 0;
 
-static void worker_init(struct worker *w)
+/* worker owned by the calling thread */
+static dsThreadLocal struct worker *tl_worker = NULL;
+/* priority of the task running on the calling thread, inherited by tasks it dispatches */
+static dsThreadLocal enum task_priority tl_priority = TASK_PRIORITY_NORMAL;
+/* fiber whose task is running on the calling thread, NULL if the running task may not be switched out */
+static dsThreadLocal struct task_fiber *tl_fiber = NULL;
+
+/*
+ * A pooled fiber runs one fiber task at a time. It is entered by the worker running the task, or later by the 
+ * worker running its resume task, and switches back to whoever entered it when the task waits or finishes.
+ */
+struct task_fiber
+{
+	dsFiber			context;	/* the fiber's own context */
+	dsFiber			resumer;	/* context which entered the fiber */
+	struct task		resume;		/* task resuming the fiber once the counter it waits on is zero */
+	struct task *		task;		/* fiber task running on the fiber */
+	struct task_counter *	waiting;	/* counter the fiber is suspended on, or NULL once the task finished */
+	struct task_fiber *	next;		/* next fiber waiting on the same counter */
+	struct ds_MemSlot	mem_stack;	/* the fiber's stack, unless DS_FIBER_NATIVE_STACK */
+	u64 *			stack;		/* bottom of the fiber's stack, unless DS_FIBER_NATIVE_STACK */
+	u32			index;		/* pool index */
+	u32			initialized;	/* the fiber has a stack and context; pool memory starts out zeroed */
+	TPOOL_NODE;
+};
+
+TPOOL_DECLARE(task_fiber)
+TPOOL_DEFINE(task_fiber)
+
+/* initial task capacity of a worker's deque, it grows on demand */
+#define TASK_INITIAL_COUNT 1024
+/* failed steal rounds over all workers before a worker goes to sleep */
+#define TASK_STEAL_ROUNDS 64
+/* backoff rounds, pausing 2^(round/8) times each, before a waiter out of tasks blocks */
+#define TASK_WAIT_SPIN_MAX 64
+/* stack size of worker threads */
+#define TASK_WORKER_STACK_SIZE (64*1024)
+/* initial number of pooled fibers, the pool grows on demand, and their stack size */
+#define TASK_FIBER_INITIAL_COUNT 128
+#define TASK_FIBER_STACK_SIZE (64*1024)
+/* written to the bottom of every fiber stack, and checked whenever a fiber is released */
+#define TASK_FIBER_STACK_CANARY 0xdeadbeefcafebabeull
+
+static void worker_init(struct arena *mem_persistent, struct worker *w)
 {
 	w->mem_frame = ArenaAlloc1MB();
+	for (u32 p = 0; p < TASK_PRIORITY_COUNT; ++p)
+	{
+		w->tasks[p] = DequeWsInit(mem_persistent, TASK_INITIAL_COUNT);
+	}
+	SemaphoreInit(&w->wait_wake, 0);
+	AtomicStoreRlx64(&w->a_inline_count, 0);
+	AtomicStoreRlx32(&w->a_mem_frame_clear, 0);
+	w->cache_group = TASK_LOCALITY_ANY;
+}
+
+/* pin the calling worker's thread to its cpu; workers beyond the cpu count wrap around. cpu_order[0] is left to 
+ * the unpinned main thread. */
+static void worker_pin(struct worker *w)
+{
+	const u32 cpu = g_arch_config->cpu_order[(w - g_task_ctx->workers) % g_arch_config->logical_core_count];
+	if (ds_ThreadSelfAffinitySet(cpu))
+	{
+		w->cache_group = g_arch_config->cpu_cache_group[cpu];
+	}
 }
 
 static void worker_exit(void *void_task)
@@ -38,6 +101,10 @@ static void worker_exit(void *void_task)
 	ds_ThreadExit();
 }
 
+static void task_graph_node_finish(struct task_graph_node *node);
+static void task_wait_wake(void);
+static void task_fiber_run(struct task *task, struct worker *w);
+
 static void task_run(struct task *task_info, struct worker *w)
 {
 	if (AtomicLoadAcq32(&w->a_mem_frame_clear))
@@ -46,29 +113,260 @@ static void task_run(struct task *task_info, struct worker *w)
 		AtomicStoreRel32(&w->a_mem_frame_clear, 0);
 	}
 
+	/* 
+	 * A task run while helping from within a fiber task runs on the borrowed fiber's stack, and may not switch 
+	 * the fiber out from under the helping frames, so it waits as a plain task does.
+	 */
+	const enum task_priority priority = tl_priority;
+	struct task_fiber *fiber = tl_fiber;
+	tl_priority = task_info->priority;
+	tl_fiber = NULL;
 	task_info->executor = w;
-	task_info->task(task_info);
+	if (task_info->batch_type == TASK_BATCH_FIBER)
+	{
+		task_fiber_run(task_info, w);
+	}
+	else
+	{
+		task_info->task(task_info);
+	}
+	tl_priority = priority;
+	tl_fiber = fiber;
 
 	switch (task_info->batch_type)
 	{
 		case TASK_BATCH_BUNDLE:
 		{
-			/* ThreadSanitizer screams if we use anything less than ACQ_REL or SEQ_CST. Can the sanitizer not
-			 * assume that the compiler won't reorder the native semaphore calls? 
-			 * TODO: Investigate more.
-			 */
+			/* release the task's writes to the thread acquiring a_tasks_left in task_bundle_completed */
 			struct task_bundle *bundle = task_info->batch;
 			if (AtomicSubFetchSeqCst32(&bundle->a_tasks_left, 1) == 0)
 			{
-				SemaphorePost(&bundle->bundle_completed);
+				task_wait_wake();
 			}
 		} break;
 
 		case TASK_BATCH_STREAM:
 		{
+			/* 
+			 * The owner may release the stream as soon as it sees the last completion, so the owner is read
+			 * before and the waiting flag is read in the same atomic op as the increment; the owner's 
+			 * semaphore outlives any stream.
+			 */
 			struct task_stream *stream = task_info->batch;
-			AtomicAddFetchRel32(&stream->a_completed, 1);
+			struct worker *owner = stream->owner;
+			if (AtomicFetchAddSeqCst32(&stream->a_completed, 1) & TASK_STREAM_WAITING)
+			{
+				SemaphorePost(&owner->wait_wake);
+			}
+		} break;
+
+		case TASK_BATCH_GRAPH:
+		{
+			task_graph_node_finish(task_info->batch);
 		} break;
+
+		/* fiber tasks complete when their fiber finishes, which task_fiber_run or a resume task observes */
+		case TASK_BATCH_FIBER:
+		case TASK_BATCH_NONE:
+		{
+		} break;
+	}
+}
+
+/* 
+ * pop the worker's own newest task, or steal the oldest task of some other worker, starting at a random one. 
+ * Unless foreign is set, tasks preferring another cache group than the worker's are left for that group. The
+ * peeked task may be taken and its memory reused before we read its hint, which at worst misplaces a task.
+ */
+static struct task *task_acquire_priority(struct worker *w, const u32 foreign, const enum task_priority p)
+{
+	struct task *task = DequeWsPop(w->tasks[p]);
+	if (task)
+	{
+		return task;
+	}
+
+	const u32 filter = (!foreign && w->cache_group != TASK_LOCALITY_ANY);
+	const u32 count = g_task_ctx->worker_count;
+	const u32 start = (u32) RngU64Range(0, count-1);
+	for (u32 i = 0; i < count; ++i)
+	{
+		struct worker *victim = g_task_ctx->workers + (start + i) % count;
+		if (victim == w)
+		{
+			continue;
+		}
+
+		if (filter)
+		{
+			const struct task *top = DequeWsPeek(victim->tasks[p]);
+			if (top && top->locality != TASK_LOCALITY_ANY && top->locality != w->cache_group)
+			{
+				continue;
+			}
+		}
+
+		if ((task = DequeWsSteal(victim->tasks[p])))
+		{
+			break;
+		}
+	}
+
+	return task;
+}
+
+/* high priority work of any worker goes before normal priority work, including our own */
+static struct task *task_acquire(struct worker *w, const u32 foreign)
+{
+	struct task *task = NULL;
+	for (u32 p = TASK_PRIORITY_COUNT; p-- > 0 && !task; )
+	{
+		task = task_acquire_priority(w, foreign, p);
+	}
+
+	return task;
+}
+
+/* return 1 if any worker has tasks queued; steals may fail on contention, so acquire failures are not proof */
+static u32 task_available(void)
+{
+	for (u32 i = 0; i < g_task_ctx->worker_count; ++i)
+	{
+		for (u32 p = 0; p < TASK_PRIORITY_COUNT; ++p)
+		{
+			if (DequeWsCount(g_task_ctx->workers[i].tasks[p]))
+			{
+				return 1;
+			}
+		}
+	}
+
+	return 0;
+}
+
+/* 
+ * Sleep/wake: a worker out of work registers in a_sleeping before checking the deques one last time, and a
+ * dispatcher checks a_sleeping after publishing its task. The fences order both pairs of accesses, so either 
+ * the worker sees the task or the dispatcher sees the worker. The dispatcher that decrements a_sleeping owns
+ * the wake up and posts exactly once; a worker cancelling its own sleep either decrements a_sleeping itself,
+ * or consumes the post of the dispatcher that got there first.
+ */
+static u32 task_sleeping_take(void)
+{
+	u32 sleeping = AtomicLoadSeqCst32(&g_task_ctx->a_sleeping);
+	while (sleeping && !AtomicCompareExchangeSeqCst32(&g_task_ctx->a_sleeping, &sleeping, sleeping - 1));
+	return sleeping;
+}
+
+static void task_wake_one(void)
+{
+	AtomicThreadFenceSeqCst();
+	if (task_sleeping_take())
+	{
+		SemaphorePost(&g_task_ctx->wake);
+	}
+}
+
+static void task_sleep(void)
+{
+	AtomicFetchAddSeqCst32(&g_task_ctx->a_sleeping, 1);
+	AtomicThreadFenceSeqCst();
+	if (task_available() && task_sleeping_take())
+	{
+		return;
+	}
+
+	/* Spurious wake ups may happen, so we keep this in a loop. */
+	while (!SemaphoreWait(&g_task_ctx->wake));
+}
+
+/* publish task on the calling worker's deque; if the deque could not grow, run the task immediately instead */
+static void task_push(struct task *task)
+{
+	struct worker *w = tl_worker;
+	ds_AssertString(w, "Tasks may only be dispatched by the master thread or a running task");
+	if (!DequeWsPush(w->tasks[task->priority], task))
+	{
+		AtomicStoreRlx64(&w->a_inline_count, AtomicLoadRlx64(&w->a_inline_count) + 1);
+		task_run(task, w);
+		return;
+	}
+
+	task_wake_one();
+}
+
+/* 
+ * Waiting: a waiter runs available tasks while there are any, then backs off with pause hints for a while, and 
+ * finally blocks on its wait_wake semaphore. task_wait_spin runs one backoff round, returning 1 once it is time to 
+ * block. Streams block on their own completion counter, see task_stream_spin_wait.
+ */
+static u32 task_wait_spin(u32 *spins)
+{
+	if (*spins < TASK_WAIT_SPIN_MAX)
+	{
+		for (u32 i = 0; i < (1u << (*spins / 8)); ++i)
+		{
+			AtomicSpinPause();
+		}
+		*spins += 1;
+		return 0;
+	}
+
+	return 1;
+}
+
+/* 
+ * Bundles, graphs and counters may be waited on by any thread, so instead of registering on the batch, a blocking
+ * waiter sets its bit in a_blocked, and the last completion of any batch posts every blocked worker. Both sides 
+ * fence between their write and their read, so either the waiter sees the completion or the completer sees the
+ * waiter. The completer touches no batch memory while waking, as the waiter may release the batch at once.
+ */
+static void task_wait_wake(void)
+{
+	AtomicThreadFenceSeqCst();
+	for (u32 i = 0; i < g_task_ctx->blocked_word_count; ++i)
+	{
+		u64 blocked = AtomicLoadSeqCst64(g_task_ctx->a_blocked + i);
+		while (blocked)
+		{
+			SemaphorePost(&g_task_ctx->workers[64*i + Ctz64(blocked)].wait_wake);
+			blocked &= blocked - 1;
+		}
+	}
+}
+
+/* run available tasks, back off and block until completed(batch); other batches completing only cause a recheck */
+static void task_wait(u32 (*completed)(const void *), const void *batch)
+{
+	struct worker *w = tl_worker;
+	const u32 index = (u32) (w - g_task_ctx->workers);
+	u64 *a_blocked = g_task_ctx->a_blocked + index / 64;
+	const u64 bit = (u64) 1 << (index % 64);
+	u32 spins = 0;
+	while (!completed(batch))
+	{
+		struct task *task = task_acquire(w, 1);
+		if (task)
+		{
+			task_run(task, w);
+			spins = 0;
+			continue;
+		}
+
+		if (!task_wait_spin(&spins))
+		{
+			continue;
+		}
+
+		/* our deque is empty and only we push to it, so no task can be stranded on it while we block */
+		AtomicFetchOrSeqCst64(a_blocked, bit);
+		AtomicThreadFenceSeqCst();
+		if (!completed(batch))
+		{
+			while (!SemaphoreWait(&w->wait_wake));
+		}
+		AtomicFetchAndSeqCst64(a_blocked, ~bit);
+		spins = 0;
 	}
 }
 
@@ -80,74 +378,114 @@ void task_main(dsThread *thr)
 	while (AtomicLoadAcq32(&a_startup_complete) == 0);
 
 	w->thr = thr;
+	tl_worker = w;
+	ds_FiberThreadInit();
+	if (g_task_ctx->pinned)
+	{
+		worker_pin(w);
+	}
 	AtomicFetchAddSeqCst32(&a_startup_complete, 1);
 	LogString(T_SYSTEM, S_NOTE, "task_worker setup finalized");
 
 	while (1)
 	{
 		/* If there is work, we plow through it continuously */
-		while (SemaphoreTryWait(&g_task_ctx->tasks->able_for_reservation))
+		u32 rounds = 0;
+		while (rounds < TASK_STEAL_ROUNDS)
 		{
-			task_run(FifoSpmcPop(g_task_ctx->tasks), w);
+			/* the second half of the rounds also takes work preferring other cache groups */
+			struct task *task = task_acquire(w, rounds >= TASK_STEAL_ROUNDS/2);
+			if (task)
+			{
+				task_run(task, w);
+				rounds = 0;
+			}
+			else
+			{
+				rounds += 1;
+			}
 		}
 
-		/* No more work, we go to sleep and wait until we aquire new work.
-		 * Spurious wake ups may happen, so we keep this in a loop.
-		 */
-		while (!SemaphoreWait(&g_task_ctx->tasks->able_for_reservation));
-
-		task_run(FifoSpmcPop(g_task_ctx->tasks), w);
+		/* No more work, we go to sleep and wait until new work is dispatched. */
+		task_sleep();
 	};
 }
 
 void task_main_master_run_available_jobs(void)
 {
-	struct worker *master = g_task_ctx->workers + 0;
-	while (SemaphoreTryWait(&g_task_ctx->tasks->able_for_reservation))
+	struct worker *w = tl_worker;
+	struct task *task;
+	while ((task = task_acquire(w, 1)))
 	{
-		task_run(FifoSpmcPop(g_task_ctx->tasks), master);
+		task_run(task, w);
 	}
 }
 
-static struct task_bundle task_bundle_init()
+static void task_fiber_main(void *void_fiber);
+
+/* Allocate the fiber pool; fibers get their stack and context on first use. */
+static void task_fiber_pool_init(struct arena *mem_persistent, const u32 thread_count)
 {
-	struct task_bundle bundle = { 0 };
-	SemaphoreInit(&bundle.bundle_completed, 0);
-	return bundle;
+#if __DS_PLATFORM__ == __DS_WEB__
+	LogString(T_SYSTEM, S_NOTE, "Fibers unsupported, fiber tasks run as plain tasks");
+#else
+	g_task_ctx->fibers = ArenaPush(mem_persistent, sizeof(struct task_fiberTPool));
+	if (!g_task_ctx->fibers)
+	{
+		LogString(T_SYSTEM, S_FATAL, "Failed to allocate task fiber pool, exiting.");
+		FatalCleanupAndExit();
+	}
+
+	/* the pool's free lists are indexed by thread index, and workers are the threads 0 to thread_count-1 */
+	task_fiberTPoolAlloc(g_task_ctx->fibers, thread_count, TASK_FIBER_INITIAL_COUNT, 1);
+#endif
 }
 
-static void task_bundle_destroy(struct task_bundle *bundle)
+/* number of pool slots ever handed out, i.e. fibers which may have been initialized */
+static u32 task_fiber_pool_count(const struct task_fiberTPool *pool)
 {
-	SemaphoreDestroy(&bundle->bundle_completed);
+	const u32 count = AtomicLoadAcq32(&pool->a_count_max);
+	const u32 length = AtomicLoadAcq32(&pool->a_length);
+	return (count < length) ? count : length;
 }
 
-void task_context_init(struct arena *mem_persistent, const u32 thread_count)
+void task_context_init(struct arena *mem_persistent, const u32 thread_count, const u32 pin_workers)
 {
-	//TODO 
-	const u64 stack_size = 64*1024;
-	#define TASK_MAX_COUNT 1024
 	struct task_context ctx = 
 	{ 
 		.workers = NULL,
 		.worker_count = thread_count,
+		.a_sleeping = 0,
+		.pinned = pin_workers,
+		.fibers = NULL,
+		.blocked_word_count = (thread_count + 63) / 64,
 	};
 
 	Log(T_SYSTEM, S_NOTE, "Task system worker count: %u", thread_count);
 
+	ctx.a_blocked = ArenaPushAlignedZero(mem_persistent, ctx.blocked_word_count * sizeof(u64), DS_CACHE_LINE_UB);
+	if (!ctx.a_blocked)
+	{
+		LogString(T_SYSTEM, S_FATAL, "Failed to allocate task blocked waiter bitmap, exiting.");
+		FatalCleanupAndExit();
+	}
+
 	*g_task_ctx = ctx;
-	g_task_ctx->bundle = task_bundle_init();
-	g_task_ctx->workers = ArenaPush(mem_persistent, thread_count * sizeof(struct worker));	
-	g_task_ctx->tasks = FifoSpmcInit(mem_persistent, TASK_MAX_COUNT);
+	SemaphoreInit(&g_task_ctx->wake, 0);
+	g_task_ctx->workers = ArenaPushAligned(mem_persistent, thread_count * sizeof(struct worker), DS_CACHE_LINE_UB);	
 
 	for (u32 i = 0; i < thread_count; ++i)
 	{
-		worker_init(g_task_ctx->workers + i);
+		worker_init(mem_persistent, g_task_ctx->workers + i);
 	}
+	task_fiber_pool_init(mem_persistent, thread_count);
+	tl_worker = g_task_ctx->workers + 0;
+	ds_FiberThreadInit();
 
-	/* NOTE: worker 0: reserved for main thread */
+	/* NOTE: worker 0: reserved for main thread, which is never pinned as threads it creates inherit its mask */
 	for (u32 i = 1; i < thread_count; ++i)
 	{
-		ds_ThreadClone(mem_persistent, task_main, g_task_ctx->workers + i, stack_size);
+		ds_ThreadClone(mem_persistent, task_main, g_task_ctx->workers + i, TASK_WORKER_STACK_SIZE);
 	}
 
 	AtomicStoreRel32(&a_startup_complete, 1);
@@ -163,14 +501,52 @@ void task_context_frame_clear(void)
 	}
 }
 
+u32 task_locality(void)
+{
+	return tl_worker->cache_group;
+}
+
+u32 task_worker_index(void)
+{
+	return (u32) (tl_worker - g_task_ctx->workers);
+}
+
+struct task_queue_stats task_context_queue_stats(void)
+{
+	struct task_queue_stats stats = { 0 };
+	for (u32 i = 0; i < g_task_ctx->worker_count; ++i)
+	{
+		const struct worker *w = g_task_ctx->workers + i;
+		for (u32 p = 0; p < TASK_PRIORITY_COUNT; ++p)
+		{
+			const u64 peak = DequeWsPeak(w->tasks[p]);
+			const u64 capacity = DequeWsCapacity(w->tasks[p]);
+			stats.peak = (peak > stats.peak) ? peak : stats.peak;
+			stats.capacity = (capacity > stats.capacity) ? capacity : stats.capacity;
+		}
+		stats.inline_count += AtomicLoadRlx64(&w->a_inline_count);
+	}
+	stats.fiber_count = (g_task_ctx->fibers) ? task_fiber_pool_count(g_task_ctx->fibers) : 0;
+
+	return stats;
+}
+
 void task_context_destroy(struct task_context *ctx)
 {
 	struct task *exit_tasks = malloc(ctx->worker_count * sizeof(struct task));
 
+	/* every worker steals and runs exactly one exit task from the master's deque */
 	for (u32 i = 1; i < ctx->worker_count; ++i)
 	{
-		exit_tasks[i].task = &worker_exit;
-		FifoSpmcPush(ctx->tasks, exit_tasks + i);
+		exit_tasks[i] = (struct task)
+		{
+			.task = &worker_exit,
+			.priority = TASK_PRIORITY_NORMAL,
+			.locality = TASK_LOCALITY_ANY,
+			.batch_type = TASK_BATCH_NONE,
+		};
+		while (!DequeWsPush(ctx->workers[0].tasks[TASK_PRIORITY_NORMAL], exit_tasks + i));
+		task_wake_one();
 	}
 
 	for (u32 i = 1; i < ctx->worker_count; ++i)
@@ -178,14 +554,38 @@ void task_context_destroy(struct task_context *ctx)
 		ds_ThreadWait(ctx->workers[i].thr);
 	}
 
+	const struct task_queue_stats stats = task_context_queue_stats();
+	Log(T_SYSTEM, S_NOTE, "Task queue peak %lu, capacity %lu, tasks run inline %lu, fibers %lu", stats.peak, stats.capacity, stats.inline_count, stats.fiber_count);
+
+	if (ctx->fibers)
+	{
+		const u32 fiber_count = task_fiber_pool_count(ctx->fibers);
+		for (u32 i = 0; i < fiber_count; ++i)
+		{
+			struct task_fiber *fiber = task_fiberTPoolAddress(ctx->fibers, i);
+			if (fiber->initialized)
+			{
+				ds_FiberDestroy(&fiber->context);
+#ifndef DS_FIBER_NATIVE_STACK
+				ds_Free(&fiber->mem_stack);
+#endif
+			}
+		}
+		task_fiberTPoolDealloc(ctx->fibers);
+		ctx->fibers = NULL;
+	}
+
 	for (u32 i = 0; i < ctx->worker_count; ++i)
 	{
 		ArenaFree1MB(&ctx->workers[i].mem_frame);
+		SemaphoreDestroy(&ctx->workers[i].wait_wake);
+		for (u32 p = 0; p < TASK_PRIORITY_COUNT; ++p)
+		{
+			DequeWsFree(ctx->workers[i].tasks[p]);
+		}
 	}
 
-	
-	task_bundle_destroy(&ctx->bundle);
-	FifoSpmcDestroy(ctx->tasks);
+	SemaphoreDestroy(&ctx->wake);
 	free(exit_tasks);
 }
 
@@ -197,7 +597,7 @@ struct task_bundle *task_bundle_split_range(struct arena *mem_task_lifetime, TAS
 
 	if (!splits) { return NULL; }
 
-	struct task_bundle *bundle = &g_task_ctx->bundle;
+	struct task_bundle *bundle = ArenaPush(mem_task_lifetime, sizeof(struct task_bundle));
 	struct task_range *range = ArenaPush(mem_task_lifetime, splits * sizeof(struct task_range));
 	bundle->tasks = ArenaPush(mem_task_lifetime, splits * sizeof(struct task));
 	bundle->task_count = splits;
@@ -208,6 +608,8 @@ struct task_bundle *task_bundle_split_range(struct arena *mem_task_lifetime, TAS
 		bundle->tasks[i].task = task;
 		bundle->tasks[i].input = shared_arguments;
 		bundle->tasks[i].range = range + i;
+		bundle->tasks[i].locality = TASK_LOCALITY_ANY;
+		bundle->tasks[i].priority = tl_priority;
 		bundle->tasks[i].batch_type = TASK_BATCH_BUNDLE,
 		range[i].count = tasks_per_range; 
 		if (extra_tasks) 
@@ -225,50 +627,632 @@ struct task_bundle *task_bundle_split_range(struct arena *mem_task_lifetime, TAS
 	/* Sync points, we release tasks->data, threads aquire tasks->data => threads will see all previous writes */
 	for (u32 i = 0; i < splits; ++i)
 	{
-		FifoSpmcPush(g_task_ctx->tasks, bundle->tasks + i);
+		task_push(bundle->tasks + i);
 	}
 
 	return bundle;
 }
 
+u32 task_bundle_completed(const struct task_bundle *bundle)
+{
+	return AtomicLoadAcq32(&bundle->a_tasks_left) == 0;
+}
+
+static u32 task_bundle_completed_wait(const void *bundle)
+{
+	return task_bundle_completed(bundle);
+}
+
+/* a bundle waited on from a task may only ever complete by helping, so waits run available tasks */
 void task_bundle_wait(struct task_bundle *bundle)
 {
-	while (!SemaphoreWait(&bundle->bundle_completed));
+	task_wait(task_bundle_completed_wait, bundle);
+}
+
+void task_bundle_wait_all(struct task_bundle **bundles, const u32 count)
+{
+	for (u32 i = 0; i < count; ++i)
+	{
+		if (bundles[i])
+		{
+			task_bundle_wait(bundles[i]);
+		}
+	}
+}
+
+struct task_bundle_any
+{
+	struct task_bundle **	bundles;
+	u32			count;
+	u32			completed;	/* index of a completed bundle */
+};
+
+static u32 task_bundle_any_completed(const void *void_any)
+{
+	struct task_bundle_any *any = (struct task_bundle_any *) void_any;
+	for (u32 i = 0; i < any->count; ++i)
+	{
+		if (!any->bundles[i] || task_bundle_completed(any->bundles[i]))
+		{
+			any->completed = i;
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+u32 task_bundle_wait_any(struct task_bundle **bundles, const u32 count)
+{
+	ds_Assert(count > 0);
+	struct task_bundle_any any = { .bundles = bundles, .count = count, .completed = 0 };
+	task_wait(task_bundle_any_completed, &any);
+	return any.completed;
 }
 
 void task_bundle_release(struct task_bundle *bundle)
 {
-	AtomicStoreRel32(&bundle->a_tasks_left, 0);
+	ds_AssertString(task_bundle_completed(bundle), "Task bundle released before completion");
+	bundle->task_count = 0;
+	bundle->tasks = NULL;
+}
+
+/* claim the next chunk of the range, returning its size or 0 if the range is exhausted */
+static u64 task_parallel_for_claim(struct task_parallel_for *pf, u64 *first)
+{
+	u64 next = AtomicLoadRlx64(&pf->a_next);
+	while (next < pf->input_count)
+	{
+		const u64 remaining = pf->input_count - next;
+		u64 chunk = remaining / (2*g_task_ctx->worker_count);
+		chunk = (chunk < pf->min_chunk) ? pf->min_chunk : chunk;
+		chunk = (chunk < remaining) ? chunk : remaining;
+		if (AtomicCompareExchangeRlxRlx64(&pf->a_next, &next, next + chunk))
+		{
+			*first = next;
+			return chunk;
+		}
+	}
+
+	return 0;
+}
+
+static void task_parallel_for_run(struct task_parallel_for *pf)
+{
+	struct task_range range;
+	struct task chunk_task =
+	{
+		.executor = tl_worker,
+		.task = pf->task,
+		.input = pf->shared_arguments,
+		.range = &range,
+		.priority = tl_priority,
+		.locality = TASK_LOCALITY_ANY,
+	};
+
+	u64 first;
+	u64 count;
+	while ((count = task_parallel_for_claim(pf, &first)))
+	{
+		range.base = pf->inputs + first*pf->input_element_size;
+		range.count = count;
+		pf->task(&chunk_task);
+	}
+}
+
+static void ThreadParallelFor(void *task_addr)
+{
+	struct task *task = task_addr;
+	task_parallel_for_run(task->input);
+}
+
+void task_parallel_for(struct arena *mem_tmp, TASK task, void *inputs, const u64 input_count, const u64 input_element_size, const u64 min_chunk, void *shared_arguments)
+{
+	ds_Assert(min_chunk > 0);
+	if (!input_count) { return; }
+
+	ProfZone;
+	ArenaPushRecord(mem_tmp);
+
+	/* a helper per other worker, unless there are too few chunks to go around */
+	const u64 chunk_max = (input_count + min_chunk - 1) / min_chunk;
+	const u32 helpers = (u32) ((chunk_max - 1 < g_task_ctx->worker_count - 1) ? chunk_max - 1 : g_task_ctx->worker_count - 1);
+
+	struct task_parallel_for *pf = ArenaPush(mem_tmp, sizeof(struct task_parallel_for));
+	struct task *tasks = ArenaPush(mem_tmp, helpers*sizeof(struct task));
+	if (!pf || (helpers && !tasks))
+	{
+		LogString(T_SYSTEM, S_FATAL, "Arena OOM in task_parallel_for, increase size!");
+		FatalCleanupAndExit();
+	}
+
+	pf->task = task;
+	pf->shared_arguments = shared_arguments;
+	pf->inputs = inputs;
+	pf->input_count = input_count;
+	pf->input_element_size = input_element_size;
+	pf->min_chunk = min_chunk;
+	pf->bundle.tasks = tasks;
+	pf->bundle.task_count = helpers;
+	AtomicStoreRlx64(&pf->a_next, 0);
+	AtomicStoreRel32(&pf->bundle.a_tasks_left, helpers);
+
+	for (u32 i = 0; i < helpers; ++i)
+	{
+		tasks[i] = (struct task) 
+		{ 
+			.task = ThreadParallelFor, 
+			.input = pf, 
+			.priority = tl_priority, 
+			.locality = TASK_LOCALITY_ANY, 
+			.batch_type = TASK_BATCH_BUNDLE,
+		};
+		AtomicStoreRel64(&tasks[i].batch, &pf->bundle);
+		task_push(tasks + i);
+	}
+
+	/* 
+	 * Every claimed chunk completes before its claimer moves on, so once the range is exhausted here and every 
+	 * helper has returned, the whole range is done. Helpers which never got to run are popped and run by the 
+	 * wait, and find the range exhausted. 
+	 */
+	task_parallel_for_run(pf);
+	task_bundle_wait(&pf->bundle);
+
+	ArenaPopRecord(mem_tmp);
+	ProfZoneEnd;
 }
 
 struct task_stream *task_stream_init(struct arena *mem)
 {
 	struct task_stream *stream = ArenaPush(mem, sizeof(struct task_stream));
+	stream->owner = tl_worker;
+	stream->priority = tl_priority;
 	AtomicStoreRel32(&stream->a_completed, 0);
 	stream->task_count = 0;
 
 	return stream;
 }
 
+void task_stream_priority_set(struct task_stream *stream, const enum task_priority priority)
+{
+	stream->priority = priority;
+}
+
 void task_stream_dispatch(struct arena *mem, struct task_stream *stream, TASK func, void *args)
+{
+	task_stream_dispatch_local(mem, stream, func, args, TASK_LOCALITY_ANY);
+}
+
+void task_stream_dispatch_local(struct arena *mem, struct task_stream *stream, TASK func, void *args, const u32 locality)
 {
 	struct task *task = ArenaPush(mem, sizeof(struct task));
 	task->task = func;
 	task->input = args;
+	task->priority = stream->priority;
+	task->locality = locality;
 	task->batch_type = TASK_BATCH_STREAM;
 	task->batch = stream;
 	
 	stream->task_count += 1;
-	FifoSpmcPush(g_task_ctx->tasks, task);
+	task_push(task);
 }
 
 void task_stream_spin_wait(struct task_stream *stream)
 {
-	while ((u32) AtomicLoadAcq32(&stream->a_completed) < stream->task_count);
+	struct worker *w = tl_worker;
+	ds_AssertString(w == stream->owner, "Task streams may only be waited on by the dispatching thread");
+
+	u32 spins = 0;
+	while (((u32) AtomicLoadAcq32(&stream->a_completed) & ~TASK_STREAM_WAITING) < stream->task_count)
+	{
+		/* 
+		 * A task waiting on its own subtasks must keep running them, or workers waiting on each other's 
+		 * subtasks could deadlock. Our own deque is popped first, so the stream's remaining tasks go before 
+		 * any stolen work.
+		 */
+		struct task *task = task_acquire(w, 1);
+		if (task)
+		{
+			task_run(task, w);
+			spins = 0;
+			continue;
+		}
+
+		/* out of work: the rest of the stream is running elsewhere; back off before blocking */
+		if (!task_wait_spin(&spins))
+		{
+			continue;
+		}
+
+		/* 
+		 * Block until a stream task completes. The flag is set in the completion counter itself, so any 
+		 * completion after our check sees the flag and posts. Our deque is empty and only we push to it, so
+		 * no task can be stranded on it while we sleep. Stale posts from earlier waits only cause a recheck.
+		 */
+		const u32 completed = (u32) AtomicFetchOrSeqCst32(&stream->a_completed, TASK_STREAM_WAITING);
+		if ((completed & ~TASK_STREAM_WAITING) < stream->task_count)
+		{
+			while (!SemaphoreWait(&w->wait_wake));
+		}
+		AtomicFetchAndSeqCst32(&stream->a_completed, ~TASK_STREAM_WAITING);
+		spins = 0;
+	}
 }
 
 void task_stream_cleanup(struct task_stream *stream)
 {
-	const u32 finished = (AtomicLoadAcq32(&stream->a_completed) == stream->task_count);
+	const u32 finished = ((AtomicLoadAcq32(&stream->a_completed) & ~TASK_STREAM_WAITING) == stream->task_count);
 	ds_AssertString(finished, "Bad use of task stream, when (and only) the main thread enters task_stream_cleanup, all tasks must have been dispatched and completed.");
 }
+
+struct task_graph *task_graph_init(struct arena *mem)
+{
+	struct task_graph *graph = ArenaPush(mem, sizeof(struct task_graph));
+	graph->first = NULL;
+	graph->last = NULL;
+	graph->node_count = 0;
+	graph->dispatched = 0;
+	AtomicStoreRel32(&graph->a_nodes_left, 0);
+
+	return graph;
+}
+
+struct task_graph_node *task_graph_add(struct arena *mem, struct task_graph *graph, TASK func, void *args)
+{
+	ds_AssertString(!graph->dispatched, "Task graphs may not be modified after dispatch, use task_graph_fork");
+
+	struct task_graph_node *node = ArenaPush(mem, sizeof(struct task_graph_node));
+	node->task.task = func;
+	node->task.input = args;
+	node->task.output = NULL;
+	node->task.range = NULL;
+	node->task.priority = tl_priority;
+	node->task.locality = TASK_LOCALITY_ANY;
+	node->task.batch_type = TASK_BATCH_GRAPH;
+	node->task.batch = node;
+	node->graph = graph;
+	node->next = NULL;
+	node->successor = NULL;
+	node->dependency_count = 0;
+
+	if (graph->last)
+	{
+		graph->last->next = node;
+	}
+	else
+	{
+		graph->first = node;
+	}
+	graph->last = node;
+	graph->node_count += 1;
+
+	return node;
+}
+
+void task_graph_node_priority_set(struct task_graph_node *node, const enum task_priority priority)
+{
+	ds_AssertString(!node->graph->dispatched, "Task graphs may not be modified after dispatch");
+	node->task.priority = priority;
+}
+
+void task_graph_depend(struct arena *mem, struct task_graph_node *node, struct task_graph_node *dependency)
+{
+	ds_AssertString(!node->graph->dispatched, "Task graphs may not be modified after dispatch, use task_graph_fork");
+	ds_Assert(node->graph == dependency->graph && node != dependency);
+
+	struct task_graph_edge *edge = ArenaPush(mem, sizeof(struct task_graph_edge));
+	edge->node = node;
+	edge->next = dependency->successor;
+	dependency->successor = edge;
+	node->dependency_count += 1;
+}
+
+void task_graph_dispatch(struct task_graph *graph)
+{
+	ds_Assert(!graph->dispatched);
+	graph->dispatched = 1;
+	if (!graph->node_count)
+	{
+		return;
+	}
+
+	for (struct task_graph_node *node = graph->first; node; node = node->next)
+	{
+		AtomicStoreRlx32(&node->a_pending, node->dependency_count);
+		AtomicStoreRlx32(&node->a_unfinished, 1);
+	}
+	AtomicStoreRel32(&graph->a_nodes_left, graph->node_count);
+
+	/* Sync points, pushing releases the counters above to whichever thread acquires a node */
+	for (struct task_graph_node *node = graph->first; node; node = node->next)
+	{
+		if (node->dependency_count == 0)
+		{
+			task_push(&node->task);
+		}
+	}
+}
+
+void task_graph_fork(struct arena *mem, struct task *running, TASK func, void *args)
+{
+	task_graph_fork_local(mem, running, func, args, TASK_LOCALITY_ANY);
+}
+
+void task_graph_fork_local(struct arena *mem, struct task *running, TASK func, void *args, const u32 locality)
+{
+	ds_AssertString(running->batch_type == TASK_BATCH_GRAPH, "Only graph tasks may fork");
+
+	/* the running task holds a reference on the node, so it cannot complete before the fork is counted */
+	struct task_graph_node *node = running->batch;
+	AtomicFetchAddRlx32(&node->a_unfinished, 1);
+
+	struct task *task = ArenaPush(mem, sizeof(struct task));
+	task->task = func;
+	task->input = args;
+	task->output = NULL;
+	task->range = NULL;
+	task->priority = running->priority;
+	task->locality = locality;
+	task->batch_type = TASK_BATCH_GRAPH;
+	task->batch = node;
+	task_push(task);
+}
+
+static void task_graph_node_finish(struct task_graph_node *node)
+{
+	if (AtomicSubFetchSeqCst32(&node->a_unfinished, 1) != 0)
+	{
+		return;
+	}
+
+	struct task_graph *graph = node->graph;
+	for (struct task_graph_edge *edge = node->successor; edge; edge = edge->next)
+	{
+		if (AtomicSubFetchSeqCst32(&edge->node->a_pending, 1) == 0)
+		{
+			task_push(&edge->node->task);
+		}
+	}
+
+	/* last access, the waiting thread may release the graph memory as soon as it observes zero */
+	if (AtomicSubFetchSeqCst32(&graph->a_nodes_left, 1) == 0)
+	{
+		task_wait_wake();
+	}
+}
+
+static u32 task_graph_completed(const void *graph)
+{
+	return AtomicLoadAcq32(&((const struct task_graph *) graph)->a_nodes_left) == 0;
+}
+
+void task_graph_wait(struct task_graph *graph)
+{
+	task_wait(task_graph_completed, graph);
+}
+
+void task_counter_init(struct task_counter *counter)
+{
+	counter->waiter = NULL;
+	AtomicStoreRel32(&counter->a_state, 0);
+}
+
+u32 task_counter_completed(const struct task_counter *counter)
+{
+	/* the counter is done with once it is zero and unlocked, so any wake up in progress has let go of it */
+	return AtomicLoadAcq32(&counter->a_state) == 0;
+}
+
+static u32 task_counter_completed_wait(const void *counter)
+{
+	return task_counter_completed(counter);
+}
+
+/* 
+ * Count a finished task. The last task locks the counter while taking its waiters, and unlocks it by storing 
+ * zero, after which the owner may release the counter. Waiters are resumed by any worker picking up their 
+ * resume tasks.
+ */
+static void task_counter_decrement(struct task_counter *counter)
+{
+	u32 state = AtomicLoadAcq32(&counter->a_state);
+	while (1)
+	{
+		if ((state & ~TASK_COUNTER_LOCKED) > 1)
+		{
+			if (AtomicCompareExchangeSeqCst32(&counter->a_state, &state, state - 1))
+			{
+				return;
+			}
+		}
+		else if (state & TASK_COUNTER_LOCKED)
+		{
+			AtomicSpinPause();
+			state = AtomicLoadAcq32(&counter->a_state);
+		}
+		else if (AtomicCompareExchangeSeqCst32(&counter->a_state, &state, TASK_COUNTER_LOCKED))
+		{
+			break;
+		}
+	}
+
+	struct task_fiber *waiter = counter->waiter;
+	counter->waiter = NULL;
+	AtomicStoreRel32(&counter->a_state, 0);
+	task_wait_wake();
+
+	while (waiter)
+	{
+		struct task_fiber *next = waiter->next;
+		task_push(&waiter->resume);
+		waiter = next;
+	}
+}
+
+/* 
+ * Fiber loop: run the fiber's task, then switch back to the entering context, which releases the fiber. The
+ * fiber continues here once it is acquired for the next task.
+ */
+static void task_fiber_main(void *void_fiber)
+{
+	struct task_fiber *fiber = void_fiber;
+	while (1)
+	{
+		fiber->task->task(fiber->task);
+		fiber->waiting = NULL;
+		ds_FiberSwitch(&fiber->context, &fiber->resumer);
+	}
+}
+
+/* 
+ * Enter the fiber until its task waits or finishes. The fiber has switched out by the time we continue here, 
+ * so a waiting fiber's counter is unlocked from here; a finishing fiber is released before its task is counted.
+ */
+static void task_fiber_enter(struct task_fiber *fiber, struct worker *w)
+{
+	fiber->task->executor = w;
+	tl_fiber = fiber;
+	ds_FiberSwitch(&fiber->resumer, &fiber->context);
+	tl_fiber = NULL;
+
+	struct task_counter *counter = fiber->waiting;
+	if (counter)
+	{
+		AtomicFetchAndSeqCst32(&counter->a_state, ~TASK_COUNTER_LOCKED);
+		return;
+	}
+
+	counter = fiber->task->batch;
+#ifndef DS_FIBER_NATIVE_STACK
+	ds_AssertString(fiber->stack[0] == TASK_FIBER_STACK_CANARY, "Fiber task overflowed its stack");
+#endif
+	task_fiberTPoolRemove(g_task_ctx->fibers, fiber->index);
+	task_counter_decrement(counter);
+}
+
+static void ThreadFiberResume(void *task_addr)
+{
+	struct task *task = task_addr;
+	task_fiber_enter(task->input, task->executor);
+}
+
+/* 
+ * Acquire a fiber, growing the pool if every fiber is in use. Suspended fibers may only be resumed once the tasks 
+ * they wait on have run, and those tasks need fibers of their own, so running out of fibers is fatal rather than
+ * something to wait out.
+ */
+static struct task_fiber *task_fiber_acquire(void)
+{
+	const struct slot slot = task_fiberTPoolAdd(g_task_ctx->fibers);
+	struct task_fiber *fiber = slot.address;
+	if (!fiber)
+	{
+		LogString(T_SYSTEM, S_FATAL, "Failed to grow task fiber pool, exiting.");
+		FatalCleanupAndExit();
+	}
+
+	fiber->index = slot.index;
+	if (!fiber->initialized)
+	{
+		fiber->stack = NULL;
+#ifndef DS_FIBER_NATIVE_STACK
+		fiber->stack = ds_Alloc(&fiber->mem_stack, TASK_FIBER_STACK_SIZE, NO_HUGE_PAGES);
+		if (!fiber->stack)
+		{
+			LogString(T_SYSTEM, S_FATAL, "Failed to allocate task fiber stack, exiting.");
+			FatalCleanupAndExit();
+		}
+		fiber->stack[0] = TASK_FIBER_STACK_CANARY;
+#endif
+
+		if (!ds_FiberInit(&fiber->context, fiber->stack, TASK_FIBER_STACK_SIZE, task_fiber_main, fiber))
+		{
+			LogString(T_SYSTEM, S_FATAL, "Failed to init task fiber, exiting.");
+			FatalCleanupAndExit();
+		}
+		fiber->initialized = 1;
+	}
+
+	return fiber;
+}
+
+/* run fiber task on a pooled fiber, or as a plain task on platforms without fibers */
+static void task_fiber_run(struct task *task, struct worker *w)
+{
+	if (!g_task_ctx->fibers)
+	{
+		task->task(task);
+		task_counter_decrement(task->batch);
+		return;
+	}
+
+	struct task_fiber *fiber = task_fiber_acquire();
+	fiber->task = task;
+	fiber->waiting = NULL;
+	fiber->next = NULL;
+	fiber->resume = (struct task)
+	{
+		.task = ThreadFiberResume,
+		.input = fiber,
+		.priority = task->priority,
+		.locality = task->locality,
+		.batch_type = TASK_BATCH_NONE,
+	};
+	task_fiber_enter(fiber, w);
+}
+
+void task_counter_wait(struct task_counter *counter)
+{
+	struct task_fiber *fiber = tl_fiber;
+	if (!fiber)
+	{
+		task_wait(task_counter_completed_wait, counter);
+		return;
+	}
+
+	/* lock the waiter list, unless the count already is zero */
+	u32 state = AtomicLoadAcq32(&counter->a_state);
+	while (1)
+	{
+		if (state == 0)
+		{
+			return;
+		}
+		else if (state & TASK_COUNTER_LOCKED)
+		{
+			AtomicSpinPause();
+			state = AtomicLoadAcq32(&counter->a_state);
+		}
+		else if (AtomicCompareExchangeSeqCst32(&counter->a_state, &state, state | TASK_COUNTER_LOCKED))
+		{
+			break;
+		}
+	}
+
+	/* 
+	 * Suspend; the entering context unlocks the counter once we have switched out, so the last task cannot
+	 * resume us before our context is saved. We may continue on another thread, so no thread local state is
+	 * touched past the switch.
+	 */
+	fiber->next = counter->waiter;
+	counter->waiter = fiber;
+	fiber->waiting = counter;
+	ds_FiberSwitch(&fiber->context, &fiber->resumer);
+}
+
+void task_fiber_dispatch(struct arena *mem, struct task_counter *counter, TASK func, void *args)
+{
+	struct task *task = ArenaPush(mem, sizeof(struct task));
+	task->task = func;
+	task->input = args;
+	task->output = NULL;
+	task->range = NULL;
+	task->priority = tl_priority;
+	task->locality = TASK_LOCALITY_ANY;
+	task->batch_type = TASK_BATCH_FIBER;
+	task->batch = counter;
+
+	AtomicFetchAddRlx32(&counter->a_state, 1);
+	task_push(task);
+}
@@ -46,7 +46,11 @@ void ds_PlatformApiInit(struct arena *mem)
 		Log(T_SYSTEM, S_NOTE, "core %u tsc skew (reltive to core 0): %lu", i, g_tsc_skew[i]);
 	}
 #endif
-	task_context_init(mem, g_arch_config->logical_core_count);
+#ifdef DS_PIN_WORKERS
+	task_context_init(mem, g_arch_config->logical_core_count, 1);
+#else
+	task_context_init(mem, g_arch_config->logical_core_count, 0);
+#endif
 }
 
 void ds_PlatformApiShutdown(void)
@@ -29,6 +29,7 @@ extern "C" {
 #include "ds_base.h"
 #include "ds_math.h"
 #include "ds_job.h"
+#include "dynamics.h"
 
 /* Correctness Test framework entry point */
 void ds_TestMainCorrectness(void);
@@ -222,6 +223,28 @@ struct suite_Correctness
 #define TEST_FALSE(exp) if (exp) { TEST_FAILURE } else { output.success = 1; }
 #define TEST_TRUE(exp) if (!(exp)) { TEST_FAILURE } else { output.success = 1; }
 
+/********************************** Physics Testing  ************************************/
+
+/* shared scene of the physics tests: a static floor and stacks of dynamic boxes */
+struct test_PhysicsScene
+{
+	struct strdb			cshape_db;
+	struct ds_RigidBodyPrefab	body_dynamic;
+	struct ds_RigidBodyPrefab	body_static;
+	struct ds_ShapePrefab		shape_box;
+	struct ds_ShapePrefab		shape_floor;
+};
+
+void				test_PhysicsSceneAlloc(struct test_PhysicsScene *scene, struct arena *mem);
+void				test_PhysicsSceneFree(struct test_PhysicsScene *scene);
+/* empty pipeline in deterministic mode using the scene's collision shapes */
+struct ds_RigidBodyPipeline	test_PhysicsPipelineAlloc(struct arena *mem, struct test_PhysicsScene *scene);
+void				test_PhysicsPipelineFree(struct ds_RigidBodyPipeline *pipeline);
+/* add the scene's bodies to the pipeline, recording them into log if set */
+void				test_PhysicsSceneAdd(struct ds_RigidBodyPipeline *pipeline, struct ds_PhysicsInputLog *log, const struct test_PhysicsScene *scene);
+/* clear the worker frame arenas, tick the pipeline a single frame and flush its events */
+void				test_PhysicsTick(struct ds_RigidBodyPipeline *pipeline);
+
 #ifdef __cplusplus
 } 
 #endif
@@ -233,6 +256,8 @@ extern struct suite_Performance *rng_performance_suite;
 extern struct suite_Performance *serialize_performance_suite;
 extern struct suite_Performance *allocator_performance_suite;
 extern struct suite_Performance *THashMap_performance_suite;
+extern struct suite_Performance *job_performance_suite;
+extern struct suite_Performance *physics_performance_suite;
 
 //extern struct suite_Correctness *array_list_suite;
 //extern struct suite_Correctness *hierarchy_index_suite;
@@ -241,5 +266,7 @@ extern struct suite_Correctness *allocator_correctness_suite;
 extern struct suite_Correctness *kas_string_correctness_suite;
 extern struct suite_Correctness *serialize_correctness_suite;
 extern struct suite_Correctness *THashMap_correctness_suite;
+extern struct suite_Correctness *physics_correctness_suite;
+extern struct suite_Correctness *job_correctness_suite;
 
 #endif
@@ -68,7 +68,7 @@ void ds_StructTPoolIncrementTestReset(void *args)
         }
         first = 0;
 
-        ds_StructTPoolAlloc(pool, g_arch_config->logical_core_count, 1);
+        ds_StructTPoolAlloc(pool, g_arch_config->logical_core_count, 1, 1);
     }
 }
 
@@ -79,7 +79,7 @@ void ds_StructureTHashMapTestReset(void *args)
         {
             ds_Assert((AtomicLoadRlx64(g_tmap.a_hash + i) & THASH_NEXT_MASK) == THASH_NULL);
         }
-        ds_StructureTPoolAlloc(pool, g_arch_config->logical_core_count, 1);
+        ds_StructureTPoolAlloc(pool, g_arch_config->logical_core_count, 1, 1);
         ds_StructureTHashMapFlush(&g_tmap);
     }
 }
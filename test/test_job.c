@@ -0,0 +1,932 @@
+/*
+==========================================================================
+    Copyright (C) 2026 Axel Sandstedt
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+==========================================================================
+*/
+
+#include <stdlib.h>
+
+#include "ds_test.h"
+
+/*
+ * The layout tests run the per-worker access pattern of the scheduler on copies of the real struct worker and
+ * on a packed mirror holding the same fields without padding: every worker counts into its own a_inline_count
+ * while reading the deque pointers and cache group of its neighbour, as a thief does on every steal. The
+ * difference between the two is the cost of false sharing that the padding of struct worker removes. The
+ * deque test has every worker push and pop on its own struct dequeWs while peeking the deque of its
+ * neighbour, stressing the owner and thief cachelines of the queue. The task throughput test has every worker
+ * dispatch and wait on a stream of empty tasks, stressing the per-worker state (deques, frame clear flags) and
+ * the shared sleep counter. The fiber tree test has every worker run a tree of fiber tasks, where every inner
+ * node waits on its children, stressing fiber switches and counter wake ups. Every test checks that all of
+ * its work completed.
+ */
+
+#define G_WORKER_MAX		64
+#define G_LAYOUT_ITERATIONS	((u64) 1000000)
+#define G_DEQUE_ITERATIONS	((u64) 100000)
+#define G_DEQUE_BATCH		16
+#define G_TASK_COUNT		((u64) 4096)
+#define G_FIBER_DEPTH		5
+#define G_FIBER_BRANCHING	4
+
+static void job_TestCheck(const char *id, const u64 expected, const u64 actual)
+{
+	if (expected != actual)
+	{
+		Log(T_SYSTEM, S_FATAL, "%s: expected %lu completed, got %lu", id, expected, actual);
+		FatalCleanupAndExit();
+	}
+}
+
+/* struct worker without padding */
+struct worker_Packed
+{
+	struct arena	mem_frame;
+	dsThread *	thr;
+	struct dequeWs *tasks[TASK_PRIORITY_COUNT];
+	u32		cache_group;
+	u32 		a_mem_frame_clear;
+	u64		a_inline_count;
+};
+
+static struct worker g_worker_padded[G_WORKER_MAX];
+static struct worker_Packed g_worker_packed[G_WORKER_MAX];
+static u32 g_worker_next = 0;
+static u64 g_worker_sink = 0;
+
+struct worker_LayoutInput
+{
+	u32	self;
+	u32	neighbour;
+};
+
+void *worker_LayoutInit(void)
+{
+	struct worker_LayoutInput *input = malloc(sizeof(struct worker_LayoutInput));
+	input->self = g_worker_next++ % G_WORKER_MAX;
+	input->neighbour = (input->self + 1) % g_task_ctx->worker_count;
+	return input;
+}
+
+void worker_LayoutFree(void *args)
+{
+	g_worker_next = 0;
+	free(args);
+}
+
+void worker_PaddedReset(void *args)
+{
+	const struct worker_LayoutInput *input = args;
+	AtomicStoreRlx64(&g_worker_padded[input->self].a_inline_count, 0);
+}
+
+void worker_PackedReset(void *args)
+{
+	const struct worker_LayoutInput *input = args;
+	AtomicStoreRlx64(&g_worker_packed[input->self].a_inline_count, 0);
+}
+
+/* identical loop for both layouts */
+#define WORKER_LAYOUT_TEST(workers, input)							\
+{												\
+	u64 sink = 0;										\
+	for (u64 i = 0; i < G_LAYOUT_ITERATIONS; ++i)						\
+	{											\
+		sink += (u64) workers[input->neighbour].tasks[i % TASK_PRIORITY_COUNT]	\
+			+ workers[input->neighbour].cache_group				\
+			+ AtomicLoadRlx32(&workers[input->self].a_mem_frame_clear);		\
+		AtomicStoreRlx64(&workers[input->self].a_inline_count,			\
+			AtomicLoadRlx64(&workers[input->self].a_inline_count) + 1);		\
+	}											\
+	AtomicFetchAddRlx64(&g_worker_sink, sink);						\
+}
+
+void worker_PaddedTest(void *args)
+{
+	const struct worker_LayoutInput *input = args;
+	WORKER_LAYOUT_TEST(g_worker_padded, input);
+	job_TestCheck("worker layout", G_LAYOUT_ITERATIONS, AtomicLoadRlx64(&g_worker_padded[input->self].a_inline_count));
+}
+
+void worker_PackedTest(void *args)
+{
+	const struct worker_LayoutInput *input = args;
+	WORKER_LAYOUT_TEST(g_worker_packed, input);
+	job_TestCheck("worker layout", G_LAYOUT_ITERATIONS, AtomicLoadRlx64(&g_worker_packed[input->self].a_inline_count));
+}
+
+static struct dequeWs *g_deque[G_WORKER_MAX];
+
+struct deque_Input
+{
+	struct arena	mem;
+	u32		self;
+	u32		neighbour;
+	u64		value[G_DEQUE_BATCH];
+};
+
+void *deque_Init(void)
+{
+	struct deque_Input *input = malloc(sizeof(struct deque_Input));
+	input->mem = ArenaAlloc(sizeof(struct dequeWs) + G_DEQUE_BATCH*sizeof(void *) + 4096);
+	input->self = g_worker_next++ % G_WORKER_MAX;
+	input->neighbour = (input->self + 1) % g_task_ctx->worker_count;
+	g_deque[input->self] = DequeWsInit(&input->mem, G_DEQUE_BATCH);
+	return input;
+}
+
+void deque_Free(void *args)
+{
+	struct deque_Input *input = args;
+	DequeWsFree(g_deque[input->self]);
+	g_deque[input->self] = NULL;
+	g_worker_next = 0;
+	ArenaFree(&input->mem);
+	free(input);
+}
+
+void deque_Test(void *args)
+{
+	struct deque_Input *input = args;
+	struct dequeWs *own = g_deque[input->self];
+	const struct dequeWs *neighbour = g_deque[input->neighbour];
+	u64 popped = 0;
+	for (u64 i = 0; i < G_DEQUE_ITERATIONS; ++i)
+	{
+		for (u32 k = 0; k < G_DEQUE_BATCH; ++k)
+		{
+			DequeWsPush(own, input->value + k);
+		}
+		DequeWsPeek(neighbour);
+		while (DequeWsPop(own))
+		{
+			popped += 1;
+		}
+	}
+	job_TestCheck("deque", G_DEQUE_ITERATIONS*G_DEQUE_BATCH, popped);
+}
+
+struct task_ThroughputInput
+{
+	struct arena	mem;
+	u64		a_completed;
+};
+
+void *task_ThroughputInit(void)
+{
+	struct task_ThroughputInput *input = malloc(sizeof(struct task_ThroughputInput));
+	input->mem = ArenaAlloc(G_TASK_COUNT*sizeof(struct task) + 4096);
+	return input;
+}
+
+void task_ThroughputReset(void *args)
+{
+	struct task_ThroughputInput *input = args;
+	ArenaFlush(&input->mem);
+	AtomicStoreRlx64(&input->a_completed, 0);
+}
+
+void task_ThroughputFree(void *args)
+{
+	struct task_ThroughputInput *input = args;
+	ArenaFree(&input->mem);
+	free(input);
+}
+
+static void task_Empty(void *task_addr)
+{
+	struct task *task = task_addr;
+	struct task_ThroughputInput *input = task->input;
+	AtomicFetchAddRlx64(&input->a_completed, 1);
+}
+
+void task_ThroughputTest(void *args)
+{
+	struct task_ThroughputInput *input = args;
+	struct task_stream *stream = task_stream_init(&input->mem);
+	for (u64 i = 0; i < G_TASK_COUNT; ++i)
+	{
+		task_stream_dispatch(&input->mem, stream, task_Empty, input);
+	}
+	task_stream_spin_wait(stream);
+	task_stream_cleanup(stream);
+	job_TestCheck("task throughput", G_TASK_COUNT, AtomicLoadAcq64(&input->a_completed));
+}
+
+struct fiber_TreeInput
+{
+	struct arena	mem;
+	u64		a_leaves;
+};
+
+void *fiber_TreeInit(void)
+{
+	struct fiber_TreeInput *input = malloc(sizeof(struct fiber_TreeInput));
+	input->mem = ArenaAlloc(G_FIBER_BRANCHING*sizeof(struct task) + 4096);
+	return input;
+}
+
+void fiber_TreeReset(void *args)
+{
+	struct fiber_TreeInput *input = args;
+	ArenaFlush(&input->mem);
+	AtomicStoreRlx64(&input->a_leaves, 0);
+}
+
+void fiber_TreeFree(void *args)
+{
+	struct fiber_TreeInput *input = args;
+	ArenaFree(&input->mem);
+	free(input);
+}
+
+struct fiber_TreeNode
+{
+	struct fiber_TreeInput *input;
+	u32			depth;
+};
+
+/* inner nodes keep their children and task memory on the fiber stack, which stays valid while they wait */
+static void fiber_TreeNode(void *task_addr)
+{
+	struct task *task = task_addr;
+	const struct fiber_TreeNode *node = task->input;
+	if (node->depth == 0)
+	{
+		AtomicFetchAddRlx64(&node->input->a_leaves, 1);
+		return;
+	}
+
+	u8 buf[G_FIBER_BRANCHING*(sizeof(struct task) + 64)];
+	struct arena mem = { .stack_ptr = buf, .mem_size = sizeof(buf), .mem_left = sizeof(buf), .record = NULL };
+	struct fiber_TreeNode child[G_FIBER_BRANCHING];
+	struct task_counter counter;
+	task_counter_init(&counter);
+	for (u32 i = 0; i < G_FIBER_BRANCHING; ++i)
+	{
+		child[i].input = node->input;
+		child[i].depth = node->depth - 1;
+		task_fiber_dispatch(&mem, &counter, fiber_TreeNode, child + i);
+	}
+	task_counter_wait(&counter);
+}
+
+void fiber_TreeTest(void *args)
+{
+	struct fiber_TreeInput *input = args;
+	struct fiber_TreeNode root = { .input = input, .depth = G_FIBER_DEPTH };
+	struct task_counter counter;
+	task_counter_init(&counter);
+	task_fiber_dispatch(&input->mem, &counter, fiber_TreeNode, &root);
+	task_counter_wait(&counter);
+	u64 leaves = 1;
+	for (u32 i = 0; i < G_FIBER_DEPTH; ++i)
+	{
+		leaves *= G_FIBER_BRANCHING;
+	}
+	job_TestCheck("fiber tree", leaves, AtomicLoadAcq64(&input->a_leaves));
+}
+
+struct test_PerformanceParallel job_parallel_test[] =
+{
+	{
+		.id = "parallel_worker_packed_test",
+		.size = G_LAYOUT_ITERATIONS * sizeof(u64),
+		.test = &worker_PackedTest,
+		.test_init = &worker_LayoutInit,
+		.test_reset = &worker_PackedReset,
+		.test_free = &worker_LayoutFree,
+	},
+
+	{
+		.id = "parallel_worker_padded_test",
+		.size = G_LAYOUT_ITERATIONS * sizeof(u64),
+		.test = &worker_PaddedTest,
+		.test_init = &worker_LayoutInit,
+		.test_reset = &worker_PaddedReset,
+		.test_free = &worker_LayoutFree,
+	},
+
+	{
+		.id = "parallel_deque_test",
+		.size = G_DEQUE_ITERATIONS * G_DEQUE_BATCH * sizeof(void *),
+		.test = &deque_Test,
+		.test_init = &deque_Init,
+		.test_reset = NULL,
+		.test_free = &deque_Free,
+	},
+
+	{
+		.id = "parallel_task_throughput_test",
+		.size = G_TASK_COUNT * sizeof(struct task),
+		.test = &task_ThroughputTest,
+		.test_init = &task_ThroughputInit,
+		.test_reset = &task_ThroughputReset,
+		.test_free = &task_ThroughputFree,
+	},
+
+	{
+		.id = "parallel_fiber_tree_test",
+		.size = (1 << (2*G_FIBER_DEPTH)) * sizeof(struct task),
+		.test = &fiber_TreeTest,
+		.test_init = &fiber_TreeInit,
+		.test_reset = &fiber_TreeReset,
+		.test_free = &fiber_TreeFree,
+	},
+};
+
+struct suite_Performance storage_job_performance_suite =
+{
+	.id = "Job Performance",
+	.parallel_test = job_parallel_test,
+	.parallel_test_count = sizeof(job_parallel_test) / sizeof(job_parallel_test[0]),
+	.serial_test = NULL,
+	.serial_test_count = 0,
+};
+
+struct suite_Performance *job_performance_suite = &storage_job_performance_suite;
+
+/*
+ * The correctness tests check the scheduler's guarantees rather than its speed: work handed between threads
+ * is taken exactly once, dependencies and joins are respected, and suspended work resumes where it can.
+ */
+
+#define G_STEAL_ITEMS		((u64) 1 << 15)
+#define G_STEAL_DEQUE_SIZE	8
+#define G_STEAL_BATCH		1024
+
+struct deque_StealInput
+{
+	struct dequeWs *q;
+	u64 *		item;		/* pushed as &item[i] */
+	u32 *		a_taken;	/* times item i was taken */
+	u32		a_started;	/* thieves running */
+	u32		a_stolen;	/* items stolen */
+	u32		a_done;
+};
+
+/* steal until the owner is done and the deque is empty, counting every stolen item */
+static void deque_Thief(void *task_addr)
+{
+	struct task *task = task_addr;
+	struct deque_StealInput *input = task->input;
+	AtomicFetchAddRel32(&input->a_started, 1);
+	for (;;)
+	{
+		const u32 done = AtomicLoadAcq32(&input->a_done);
+		u64 *item = DequeWsSteal(input->q);
+		if (item)
+		{
+			AtomicFetchAddRlx32(input->a_taken + (item - input->item), 1);
+			AtomicFetchAddRel32(&input->a_stolen, 1);
+		}
+		else if (done && DequeWsCount(input->q) == 0)
+		{
+			break;
+		}
+	}
+}
+
+/*
+ * The master owns a small deque and pushes every item, popping one item every third push, while a thief per 
+ * worker steals. The deque outgrows its initial buffer while thieves steal from it. Every item must be taken 
+ * exactly once, either by the owner or by a single thief.
+ */
+static struct test_Output job_deque_steal(struct test_Environment *env)
+{
+	struct test_Output output = { .success = 1, .id = __func__ };
+
+	ArenaPushRecord(env->mem_3);
+	struct deque_StealInput input = 
+	{ 
+		.q = DequeWsInit(env->mem_3, G_STEAL_DEQUE_SIZE),
+		.item = ArenaPush(env->mem_3, G_STEAL_ITEMS*sizeof(u64)),
+		.a_taken = ArenaPushZero(env->mem_3, G_STEAL_ITEMS*sizeof(u32)),
+		.a_started = 0,
+		.a_stolen = 0,
+		.a_done = 0,
+	};
+
+	/* start stealing before the first push */
+	struct task_stream *stream = task_stream_init(env->mem_3);
+	const u32 thief_count = g_task_ctx->worker_count - 1;
+	for (u32 i = 0; i < thief_count; ++i)
+	{
+		task_stream_dispatch(env->mem_3, stream, deque_Thief, &input);
+	}
+	while (AtomicLoadAcq32(&input.a_started) != thief_count)
+	{
+		AtomicSpinPause();
+	}
+
+	/* after every batch, wait for a steal, so that thieves race the owner even on a single core */
+	u64 *item;
+	for (u64 i = 0; i < G_STEAL_ITEMS; ++i)
+	{
+		TEST_TRUE(DequeWsPush(input.q, input.item + i));
+		if (i % 3 == 2 && (item = DequeWsPop(input.q)))
+		{
+			AtomicFetchAddRlx32(input.a_taken + (item - input.item), 1);
+		}
+
+		if (thief_count && i % G_STEAL_BATCH == G_STEAL_BATCH - 1)
+		{
+			const u32 stolen = AtomicLoadAcq32(&input.a_stolen);
+			while (AtomicLoadAcq32(&input.a_stolen) == stolen)
+			{
+				AtomicSpinPause();
+			}
+		}
+	}
+
+	while ((item = DequeWsPop(input.q)))
+	{
+		AtomicFetchAddRlx32(input.a_taken + (item - input.item), 1);
+	}
+	AtomicStoreRel32(&input.a_done, 1);
+	task_stream_spin_wait(stream);
+	task_stream_cleanup(stream);
+
+	TEST_TRUE(DequeWsCapacity(input.q) > G_STEAL_DEQUE_SIZE);
+	for (u64 i = 0; i < G_STEAL_ITEMS; ++i)
+	{
+		TEST_EQUAL(AtomicLoadAcq32(input.a_taken + i), 1);
+	}
+
+	DequeWsFree(input.q);
+	ArenaPopRecord(env->mem_3);
+	return output;
+}
+
+#define G_GRAPH_LAYERS		6
+#define G_GRAPH_WIDTH		8
+#define G_GRAPH_FORKS		4
+#define G_GRAPH_SPIN		1000
+
+struct graph_Input
+{
+	u32	a_run;		/* node tasks run */
+	u32	a_violation;	/* set if a node started before its dependencies had joined their forks */
+};
+
+struct graph_Fork
+{
+	struct graph_Node *	node;
+	struct arena		mem;
+	u8			buf[sizeof(struct task) + 64];
+};
+
+struct graph_Node
+{
+	struct graph_Input *	input;
+	struct graph_Node *	dependency[2];
+	u32			dependency_count;
+	u32			a_done;		/* node task, forks and forks of forks finished */
+	struct arena		mem;
+	u8			buf[G_GRAPH_FORKS*(sizeof(struct task) + 64)];
+	struct graph_Fork	fork[G_GRAPH_FORKS];
+};
+
+static void graph_Spin(void)
+{
+	for (u32 i = 0; i < G_GRAPH_SPIN; ++i)
+	{
+		AtomicSpinPause();
+	}
+}
+
+static void graph_ForkLeaf(void *task_addr)
+{
+	struct task *task = task_addr;
+	struct graph_Fork *fork = task->input;
+	graph_Spin();
+	AtomicFetchAddRel32(&fork->node->a_done, 1);
+}
+
+/* forks one more level, which the node must also join */
+static void graph_Fork(void *task_addr)
+{
+	struct task *task = task_addr;
+	struct graph_Fork *fork = task->input;
+	task_graph_fork(&fork->mem, task, graph_ForkLeaf, fork);
+	graph_Spin();
+	AtomicFetchAddRel32(&fork->node->a_done, 1);
+}
+
+static void graph_Node(void *task_addr)
+{
+	struct task *task = task_addr;
+	struct graph_Node *node = task->input;
+	for (u32 i = 0; i < node->dependency_count; ++i)
+	{
+		if (AtomicLoadAcq32(&node->dependency[i]->a_done) != 1 + 2*G_GRAPH_FORKS)
+		{
+			AtomicStoreRel32(&node->input->a_violation, 1);
+		}
+	}
+
+	for (u32 i = 0; i < G_GRAPH_FORKS; ++i)
+	{
+		task_graph_fork(&node->mem, task, graph_Fork, node->fork + i);
+	}
+	AtomicFetchAddRlx32(&node->input->a_run, 1);
+	AtomicFetchAddRel32(&node->a_done, 1);
+}
+
+/*
+ * A layered graph where every node depends on two nodes of the previous layer. Every node forks subtasks which 
+ * fork once more. When a node starts, each of its dependencies must have finished, along with all of its forks 
+ * and their forks.
+ */
+static struct test_Output job_graph_dependency_order(struct test_Environment *env)
+{
+	struct test_Output output = { .success = 1, .id = __func__ };
+
+	ArenaPushRecord(env->mem_3);
+	struct graph_Input input = { .a_run = 0, .a_violation = 0 };
+	struct graph_Node *node = ArenaPush(env->mem_3, G_GRAPH_LAYERS*G_GRAPH_WIDTH*sizeof(struct graph_Node));
+	struct task_graph_node **graph_node = ArenaPush(env->mem_3, G_GRAPH_LAYERS*G_GRAPH_WIDTH*sizeof(struct task_graph_node *));
+	struct task_graph *graph = task_graph_init(env->mem_3);
+	for (u32 l = 0; l < G_GRAPH_LAYERS; ++l)
+	{
+		for (u32 k = 0; k < G_GRAPH_WIDTH; ++k)
+		{
+			const u32 i = l*G_GRAPH_WIDTH + k;
+			node[i].input = &input;
+			node[i].dependency_count = 0;
+			node[i].a_done = 0;
+			node[i].mem = (struct arena) { .stack_ptr = node[i].buf, .mem_size = sizeof(node[i].buf), .mem_left = sizeof(node[i].buf), .record = NULL };
+			for (u32 f = 0; f < G_GRAPH_FORKS; ++f)
+			{
+				struct graph_Fork *fork = node[i].fork + f;
+				fork->node = node + i;
+				fork->mem = (struct arena) { .stack_ptr = fork->buf, .mem_size = sizeof(fork->buf), .mem_left = sizeof(fork->buf), .record = NULL };
+			}
+
+			graph_node[i] = task_graph_add(env->mem_3, graph, graph_Node, node + i);
+			if (l)
+			{
+				const u32 dependency[2] = { i - G_GRAPH_WIDTH, (l-1)*G_GRAPH_WIDTH + (k + 1) % G_GRAPH_WIDTH };
+				for (u32 d = 0; d < 2; ++d)
+				{
+					node[i].dependency[node[i].dependency_count++] = node + dependency[d];
+					task_graph_depend(env->mem_3, graph_node[i], graph_node[dependency[d]]);
+				}
+			}
+		}
+	}
+
+	task_graph_dispatch(graph);
+	task_graph_wait(graph);
+
+	TEST_EQUAL(AtomicLoadAcq32(&input.a_run), G_GRAPH_LAYERS*G_GRAPH_WIDTH);
+	TEST_EQUAL(AtomicLoadAcq32(&input.a_violation), 0);
+	for (u32 i = 0; i < G_GRAPH_LAYERS*G_GRAPH_WIDTH; ++i)
+	{
+		TEST_EQUAL(AtomicLoadAcq32(&node[i].a_done), 1 + 2*G_GRAPH_FORKS);
+	}
+
+	ArenaPopRecord(env->mem_3);
+	return output;
+}
+
+#define G_BUNDLE_COUNT		3
+#define G_BUNDLE_INPUTS		1000
+#define G_BUNDLE_OUTER		16
+#define G_BUNDLE_INNER		100
+#define G_BUNDLE_INNER_SPLITS	4
+
+/* count every element of the task's range once */
+static void bundle_Count(void *task_addr)
+{
+	struct task *task = task_addr;
+	u32 *count = task->range->base;
+	for (u64 i = 0; i < task->range->count; ++i)
+	{
+		AtomicFetchAddRlx32(count + i, 1);
+	}
+}
+
+/* for every outer element, split a bundle over its inner elements from within the task and wait on it */
+static void bundle_Outer(void *task_addr)
+{
+	struct task *task = task_addr;
+	u32 *count = task->input;
+	const u32 *outer = task->range->base;
+	for (u64 i = 0; i < task->range->count; ++i)
+	{
+		u8 buf[sizeof(struct task_bundle) + G_BUNDLE_INNER_SPLITS*(sizeof(struct task) + sizeof(struct task_range)) + 256];
+		struct arena mem = { .stack_ptr = buf, .mem_size = sizeof(buf), .mem_left = sizeof(buf), .record = NULL };
+		struct task_bundle *inner = task_bundle_split_range(&mem, bundle_Count, G_BUNDLE_INNER_SPLITS, count + outer[i]*G_BUNDLE_INNER, G_BUNDLE_INNER, sizeof(u32), NULL);
+		task_bundle_wait(inner);
+		task_bundle_release(inner);
+	}
+}
+
+/*
+ * Split several bundles of different sizes at once. task_bundle_wait_any must return a completed bundle, with a 
+ * NULL bundle counting as completed, and task_bundle_wait_all must complete every bundle. Then split a bundle 
+ * whose tasks split and wait on bundles of their own. Every element must be counted exactly once.
+ */
+static struct test_Output job_bundle_wait(struct test_Environment *env)
+{
+	struct test_Output output = { .success = 1, .id = __func__ };
+
+	ArenaPushRecord(env->mem_3);
+	u32 *count = ArenaPushZero(env->mem_3, G_BUNDLE_COUNT*G_BUNDLE_INPUTS*sizeof(u32));
+	struct task_bundle *bundle[G_BUNDLE_COUNT + 1];
+	for (u32 i = 0; i < G_BUNDLE_COUNT; ++i)
+	{
+		bundle[i] = task_bundle_split_range(env->mem_3, bundle_Count, (i + 1)*g_task_ctx->worker_count, count + i*G_BUNDLE_INPUTS, G_BUNDLE_INPUTS >> i, sizeof(u32), NULL);
+	}
+	bundle[G_BUNDLE_COUNT] = NULL;
+
+	const u32 any = task_bundle_wait_any(bundle, G_BUNDLE_COUNT);
+	TEST_TRUE(any < G_BUNDLE_COUNT);
+	TEST_TRUE(task_bundle_completed(bundle[any]));
+	TEST_EQUAL(task_bundle_wait_any(bundle + G_BUNDLE_COUNT, 1), 0);
+
+	task_bundle_wait_all(bundle, G_BUNDLE_COUNT + 1);
+	for (u32 i = 0; i < G_BUNDLE_COUNT; ++i)
+	{
+		TEST_TRUE(task_bundle_completed(bundle[i]));
+		task_bundle_release(bundle[i]);
+		const u32 input_count = G_BUNDLE_INPUTS >> i;
+		for (u32 k = 0; k < G_BUNDLE_INPUTS; ++k)
+		{
+			TEST_EQUAL(AtomicLoadAcq32(count + i*G_BUNDLE_INPUTS + k), (k < input_count) ? 1u : 0u);
+		}
+	}
+
+	u32 *outer = ArenaPush(env->mem_3, G_BUNDLE_OUTER*sizeof(u32));
+	u32 *nested_count = ArenaPushZero(env->mem_3, G_BUNDLE_OUTER*G_BUNDLE_INNER*sizeof(u32));
+	for (u32 i = 0; i < G_BUNDLE_OUTER; ++i)
+	{
+		outer[i] = i;
+	}
+	struct task_bundle *nested = task_bundle_split_range(env->mem_3, bundle_Outer, g_task_ctx->worker_count, outer, G_BUNDLE_OUTER, sizeof(u32), nested_count);
+	task_bundle_wait(nested);
+	task_bundle_release(nested);
+	for (u32 i = 0; i < G_BUNDLE_OUTER*G_BUNDLE_INNER; ++i)
+	{
+		TEST_EQUAL(AtomicLoadAcq32(nested_count + i), 1);
+	}
+
+	ArenaPopRecord(env->mem_3);
+	return output;
+}
+
+#define G_PARALLEL_FOR_MIN_CHUNK	64
+
+/*
+ * Run task_parallel_for over ranges shorter than, equal to and well beyond the minimum chunk, all but one of 
+ * them of a length that is not a multiple of it, and check that every element is processed exactly once.
+ */
+static struct test_Output job_parallel_for_coverage(struct test_Environment *env)
+{
+	struct test_Output output = { .success = 1, .id = __func__ };
+
+	const u64 input_count[] = { 1, G_PARALLEL_FOR_MIN_CHUNK - 1, G_PARALLEL_FOR_MIN_CHUNK, G_PARALLEL_FOR_MIN_CHUNK + 1, 1000, 65537 };
+	for (u32 i = 0; i < sizeof(input_count) / sizeof(input_count[0]); ++i)
+	{
+		ArenaPushRecord(env->mem_3);
+		u32 *count = ArenaPushZero(env->mem_3, input_count[i]*sizeof(u32));
+		task_parallel_for(env->mem_3, bundle_Count, count, input_count[i], sizeof(u32), G_PARALLEL_FOR_MIN_CHUNK, NULL);
+		for (u64 k = 0; k < input_count[i]; ++k)
+		{
+			TEST_EQUAL(AtomicLoadAcq32(count + k), 1);
+		}
+		ArenaPopRecord(env->mem_3);
+	}
+
+	return output;
+}
+
+#define G_PRIORITY_TASKS	64
+
+struct priority_Input
+{
+	semaphore	release;
+	u32		a_parked;
+	u32		a_normal_run;
+	u32		a_high_run;
+	u32		a_violation;	/* set if a high priority task ran after a normal priority one */
+};
+
+/* occupy the executing worker until released */
+static void priority_Park(void *task_addr)
+{
+	struct task *task = task_addr;
+	struct priority_Input *input = task->input;
+	AtomicFetchAddRel32(&input->a_parked, 1);
+	SemaphoreWait(&input->release);
+}
+
+static void priority_Normal(void *task_addr)
+{
+	struct task *task = task_addr;
+	struct priority_Input *input = task->input;
+	AtomicFetchAddRel32(&input->a_normal_run, 1);
+}
+
+static void priority_High(void *task_addr)
+{
+	struct task *task = task_addr;
+	struct priority_Input *input = task->input;
+	if (AtomicLoadAcq32(&input->a_normal_run))
+	{
+		AtomicStoreRel32(&input->a_violation, 1);
+	}
+	AtomicFetchAddRel32(&input->a_high_run, 1);
+}
+
+/*
+ * Park every worker but the master, queue high priority tasks and then normal priority tasks on the master, and 
+ * let the master run them. The master pops its own tasks newest first, yet every high priority task must run 
+ * before any of the queued normal priority tasks.
+ */
+static struct test_Output job_priority_order(struct test_Environment *env)
+{
+	struct test_Output output = { .success = 1, .id = __func__ };
+
+	ArenaPushRecord(env->mem_3);
+	struct priority_Input input = { .a_parked = 0, .a_normal_run = 0, .a_high_run = 0, .a_violation = 0 };
+	SemaphoreInit(&input.release, 0);
+
+	const u32 park_count = g_task_ctx->worker_count - 1;
+	struct task_stream *park = task_stream_init(env->mem_3);
+	for (u32 i = 0; i < park_count; ++i)
+	{
+		task_stream_dispatch(env->mem_3, park, priority_Park, &input);
+	}
+	while (AtomicLoadAcq32(&input.a_parked) != park_count)
+	{
+		AtomicSpinPause();
+	}
+
+	struct task_stream *normal = task_stream_init(env->mem_3);
+	struct task_stream *high = task_stream_init(env->mem_3);
+	task_stream_priority_set(high, TASK_PRIORITY_HIGH);
+	for (u32 i = 0; i < G_PRIORITY_TASKS; ++i)
+	{
+		task_stream_dispatch(env->mem_3, high, priority_High, &input);
+	}
+	for (u32 i = 0; i < G_PRIORITY_TASKS; ++i)
+	{
+		task_stream_dispatch(env->mem_3, normal, priority_Normal, &input);
+	}
+
+	task_main_master_run_available_jobs();
+	task_stream_spin_wait(high);
+	task_stream_spin_wait(normal);
+
+	for (u32 i = 0; i < park_count; ++i)
+	{
+		SemaphorePost(&input.release);
+	}
+	task_stream_spin_wait(park);
+	task_stream_cleanup(high);
+	task_stream_cleanup(normal);
+	task_stream_cleanup(park);
+	SemaphoreDestroy(&input.release);
+
+	TEST_EQUAL(AtomicLoadAcq32(&input.a_high_run), G_PRIORITY_TASKS);
+	TEST_EQUAL(AtomicLoadAcq32(&input.a_normal_run), G_PRIORITY_TASKS);
+	TEST_EQUAL(AtomicLoadAcq32(&input.a_violation), 0);
+
+	ArenaPopRecord(env->mem_3);
+	return output;
+}
+
+#define G_FIBER_TRIES	16
+
+struct fiber_ResumeInput
+{
+	struct task_counter	child;		/* counter the fiber suspends on */
+	struct task_counter	occupy;
+	struct arena		mem;
+	u8			buf[2*(sizeof(struct task) + 64)];
+	u32			a_occupied;
+	u32			a_resumed;
+	u32			suspend_worker;
+	u32			resume_worker;
+	u32			occupy_worker;
+};
+
+/* complete only once the occupying task has started, so that the fiber cannot skip its wait */
+static void fiber_ResumeChild(void *task_addr)
+{
+	struct task *task = task_addr;
+	struct fiber_ResumeInput *input = task->input;
+	while (!AtomicLoadAcq32(&input->a_occupied))
+	{
+		AtomicSpinPause();
+	}
+}
+
+/* occupy the executing worker until the fiber has resumed */
+static void fiber_ResumeOccupy(void *task_addr)
+{
+	struct task *task = task_addr;
+	struct fiber_ResumeInput *input = task->input;
+	input->occupy_worker = task_worker_index();
+	AtomicStoreRel32(&input->a_occupied, 1);
+	while (!AtomicLoadAcq32(&input->a_resumed))
+	{
+		AtomicSpinPause();
+	}
+}
+
+/* 
+ * Dispatch a child and then a task occupying the worker, and suspend on the child. The worker pops the newest 
+ * task first, so it is normally occupied until the fiber has resumed, and the child is stolen and completed by 
+ * another worker, which then resumes the fiber. If the occupying task runs on the fiber's worker, it started 
+ * after the fiber suspended, and the child completes only after that.
+ */
+static void fiber_Resume(void *task_addr)
+{
+	struct task *task = task_addr;
+	struct fiber_ResumeInput *input = task->input;
+	task_counter_init(&input->child);
+	task_fiber_dispatch(&input->mem, &input->child, fiber_ResumeChild, input);
+	task_fiber_dispatch(&input->mem, &input->occupy, fiber_ResumeOccupy, input);
+	input->suspend_worker = task_worker_index();
+	task_counter_wait(&input->child);
+	input->resume_worker = task_worker_index();
+	AtomicStoreRel32(&input->a_resumed, 1);
+}
+
+/*
+ * A fiber task suspends on a counter while its worker is kept busy. Whenever the worker it suspended on was
+ * still occupied once the counter completed, the fiber must have resumed on another worker. Needs fibers and 
+ * more than one worker.
+ */
+static struct test_Output job_fiber_resume_other_worker(struct test_Environment *env)
+{
+	struct test_Output output = { .success = 1, .id = __func__ };
+
+	if (!g_task_ctx->fibers || g_task_ctx->worker_count < 2)
+	{
+		Log(T_SYSTEM, S_WARNING, "%s: skipped, needs fibers and at least 2 workers", __func__);
+		return output;
+	}
+
+	u32 occupied = 0;
+	for (u32 i = 0; i < G_FIBER_TRIES; ++i)
+	{
+		ArenaPushRecord(env->mem_3);
+		struct fiber_ResumeInput *input = ArenaPush(env->mem_3, sizeof(struct fiber_ResumeInput));
+		input->mem = (struct arena) { .stack_ptr = input->buf, .mem_size = sizeof(input->buf), .mem_left = sizeof(input->buf), .record = NULL };
+		input->a_occupied = 0;
+		input->a_resumed = 0;
+		task_counter_init(&input->occupy);
+
+		struct task_counter counter;
+		task_counter_init(&counter);
+		task_fiber_dispatch(env->mem_3, &counter, fiber_Resume, input);
+		task_counter_wait(&counter);
+		task_counter_wait(&input->occupy);
+
+		if (input->occupy_worker == input->suspend_worker)
+		{
+			occupied += 1;
+			TEST_NOT_EQUAL(input->suspend_worker, input->resume_worker);
+		}
+		ArenaPopRecord(env->mem_3);
+	}
+	TEST_TRUE(occupied);
+
+	return output;
+}
+
+static struct test_Output(*job_tests[])(struct test_Environment *) =
+{
+	job_deque_steal,
+	job_graph_dependency_order,
+	job_bundle_wait,
+	job_parallel_for_coverage,
+	job_priority_order,
+	job_fiber_resume_other_worker,
+};
+
+struct suite_Correctness m_job_suite =
+{
+	.id = "Job",
+	.unit_test = job_tests,
+	.unit_test_count = sizeof(job_tests) / sizeof(job_tests[0]),
+};
+
+struct suite_Correctness *job_correctness_suite = &m_job_suite;
@@ -225,6 +225,8 @@ void ds_TestMainCorrectness(void)
 	run_suite(allocator_correctness_suite, &env, 1);
 	run_suite(kas_string_correctness_suite, &env, 1);
 	run_suite(serialize_correctness_suite, &env, 1);
+	run_suite(physics_correctness_suite, &env, 1);
+	run_suite(job_correctness_suite, &env, 1);
 	//run_suite(array_list_correctness_suite, &env, 1);
 	//run_suite(hierarchy_correctness_index_suite, &env, 1);
 	//run_suite(math_correctness_suite, &env, 1);
@@ -233,6 +235,8 @@ void ds_TestMainCorrectness(void)
 void ds_TestMainPerformance(void)
 {
 	run_performance_suite(THashMap_performance_suite);
+	run_performance_suite(job_performance_suite);
+	run_performance_suite(physics_performance_suite);
 	//run_performance_suite(allocator_performance_suite);
 	//run_performance_suite(hash_performance_suite);
 	//run_performance_suite(rng_performance_suite);
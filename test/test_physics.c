@@ -0,0 +1,892 @@
+/*
+==========================================================================
+    Copyright (C) 2026 Axel Sandstedt
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+==========================================================================
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "ds_test.h"
+
+#define G_PHYSICS_FRAME_COUNT	120
+#define G_PHYSICS_GRID		4
+#define G_PHYSICS_HEIGHT	3
+
+static u32 test_PhysicsBoxAdd(struct strdb *cshape_db, struct arena *mem, const utf8 id, const f32 x, const f32 y, const f32 z)
+{
+	const vec3 hw = { x, y, z };
+	struct slot slot = strdb_AddAndAlias(cshape_db, id);
+	struct c_Shape *shape = slot.address;
+	shape->type = C_SHAPE_CONVEX_HULL;
+	shape->hull = DcelBox(mem, hw);
+	c_ShapeUpdateMassProperties(shape);
+	return slot.index;
+}
+
+void test_PhysicsSceneAlloc(struct test_PhysicsScene *scene, struct arena *mem)
+{
+	scene->cshape_db = strdb_Alloc(NULL, 32, 32, struct c_Shape, GROWABLE);
+
+	memset(&scene->body_dynamic, 0, sizeof(scene->body_dynamic));
+	memset(&scene->body_static, 0, sizeof(scene->body_static));
+	memset(&scene->shape_box, 0, sizeof(scene->shape_box));
+	memset(&scene->shape_floor, 0, sizeof(scene->shape_floor));
+
+	scene->body_dynamic.dynamic = 1;
+	scene->body_static.dynamic = 0;
+
+	scene->shape_box.cshape = test_PhysicsBoxAdd(&scene->cshape_db, mem, Utf8Inline("c_box"), 0.5f, 0.5f, 0.5f);
+	scene->shape_box.density = 1.0f;
+	scene->shape_box.friction = 0.8f;
+	scene->shape_box.margin = 0.1f;
+
+	scene->shape_floor.cshape = test_PhysicsBoxAdd(&scene->cshape_db, mem, Utf8Inline("c_floor"), 100.0f, 0.5f, 100.0f);
+	scene->shape_floor.density = 1.0f;
+	scene->shape_floor.friction = 0.8f;
+	scene->shape_floor.margin = 0.1f;
+}
+
+void test_PhysicsSceneFree(struct test_PhysicsScene *scene)
+{
+	strdb_Dealloc(&scene->cshape_db);
+}
+
+struct ds_RigidBodyPipeline test_PhysicsPipelineAlloc(struct arena *mem, struct test_PhysicsScene *scene)
+{
+	struct ds_RigidBodyPipeline pipeline = PhysicsPipelineAlloc(mem, 256, NSEC_PER_SEC / (u64) 60, 16*1024*1024, &scene->cshape_db, NULL);
+	pipeline.config.pending_deterministic = 1;
+	return pipeline;
+}
+
+void test_PhysicsPipelineFree(struct ds_RigidBodyPipeline *pipeline)
+{
+	PhysicsPipelineFree(pipeline);
+	/* the frame arena is not owned by the pipeline's containers */
+	ArenaFree(&pipeline->frame);
+}
+
+static ds_RigidBodyId test_PhysicsBodyAdd(struct ds_RigidBodyPipeline *pipeline, struct ds_PhysicsInputLog *log, const struct ds_RigidBodyPrefab *body_prefab, const struct ds_ShapePrefab *shape_prefab, const ds_Transform *t_world, const u32 entity)
+{
+	const ds_Transform t_local = ds_TransformIdentity();
+	if (log)
+	{
+		const ds_RigidBodyId body = PhysicsInputBodyAdd(log, pipeline, body_prefab, t_world, entity);
+		PhysicsInputShapeAdd(log, pipeline, shape_prefab, &t_local, body);
+		return body;
+	}
+
+	const ds_RigidBodyId body = ds_RigidBodyAdd(pipeline, body_prefab, t_world, entity);
+	ds_ShapeAdd(pipeline, shape_prefab, &t_local, body);
+	return body;
+}
+
+/* the boxes are slightly rotated and offset so that the stacks topple and islands merge and split */
+void test_PhysicsSceneAdd(struct ds_RigidBodyPipeline *pipeline, struct ds_PhysicsInputLog *log, const struct test_PhysicsScene *scene)
+{
+	ds_Transform t = ds_TransformIdentity();
+	Vec3Set(t.position, 0.0f, -0.5f, 0.0f);
+	test_PhysicsBodyAdd(pipeline, log, &scene->body_static, &scene->shape_floor, &t, 0);
+
+	u32 entity = 1;
+	for (u32 y = 0; y < G_PHYSICS_HEIGHT; ++y)
+	for (u32 x = 0; x < G_PHYSICS_GRID; ++x)
+	for (u32 z = 0; z < G_PHYSICS_GRID; ++z)
+	{
+		const f32 angle = 0.3f*(f32) ((x*7 + y*13 + z*5) % 11) / 11.0f;
+		QuatSet(t.rotation, f32_sin(angle)*0.6f, f32_sin(angle)*0.8f, 0.0f, f32_cos(angle));
+		Vec3Set(t.position, 1.3f*x + 0.05f*(y % 3), 1.0f + 1.6f*y, 1.3f*z + 0.03f*(x % 2));
+		test_PhysicsBodyAdd(pipeline, log, &scene->body_dynamic, &scene->shape_box, &t, entity++);
+	}
+}
+
+void test_PhysicsTick(struct ds_RigidBodyPipeline *pipeline)
+{
+	/* island solves push onto the worker frame arenas, which the application clears every frame */
+	task_context_frame_clear();
+	PhysicsPipelineTick(pipeline);
+	PhysicsPipelineEventFlush(pipeline);
+}
+
+/* run the scene using the given island builder, storing the state hash of every frame */
+static void test_PhysicsSceneRun(u64 *hash, struct arena *mem, struct test_PhysicsScene *scene, const u32 builder)
+{
+	struct ds_RigidBodyPipeline pipeline = test_PhysicsPipelineAlloc(mem, scene);
+	pipeline.config.pending_island_builder = builder;
+	test_PhysicsSceneAdd(&pipeline, NULL, scene);
+	for (u32 i = 0; i < G_PHYSICS_FRAME_COUNT; ++i)
+	{
+		test_PhysicsTick(&pipeline);
+		hash[i] = pipeline.state_hash;
+	}
+	test_PhysicsPipelineFree(&pipeline);
+}
+
+struct test_PhysicsPark
+{
+	semaphore	release;
+	u32		a_parked;
+};
+
+/* occupy the executing worker until released */
+static void test_PhysicsPark(void *task_addr)
+{
+	struct task *task = task_addr;
+	struct test_PhysicsPark *park = task->input;
+	AtomicFetchAddRel32(&park->a_parked, 1);
+	SemaphoreWait(&park->release);
+}
+
+/*
+ * Run the scene with 1, 4 and 16 workers active and compare the state hash of every frame against a run on
+ * every worker, using either island builder. Workers are taken out of the run by parking them on a semaphore; 
+ * counts at or above the worker count of the machine would compare a run against itself, so they are skipped.
+ */
+static struct test_Output physics_worker_count_determinism(struct test_Environment *env)
+{
+	struct test_Output output = { .success = 1, .id = __func__ };
+
+	struct test_PhysicsScene scene;
+	test_PhysicsSceneAlloc(&scene, env->mem_1);
+
+	u64 *hash_expected = ArenaPush(env->mem_2, G_PHYSICS_FRAME_COUNT*sizeof(u64));
+	u64 *hash = ArenaPush(env->mem_2, G_PHYSICS_FRAME_COUNT*sizeof(u64));
+	const u32 active_count[] = { 1, 4, 16 };
+	for (u32 builder = 0; builder < ISLAND_BUILDER_COUNT; ++builder)
+	{
+		test_PhysicsSceneRun(hash_expected, env->mem_1, &scene, builder);
+		for (u32 i = 0; i < sizeof(active_count) / sizeof(active_count[0]); ++i)
+		{
+			if (active_count[i] >= g_task_ctx->worker_count)
+			{
+				Log(T_PHYSICS, S_WARNING, "%s: skipping %u active workers (island builder %u), only %u workers", 
+						__func__, active_count[i], builder, g_task_ctx->worker_count);
+				continue;
+			}
+
+			const u32 park_count = g_task_ctx->worker_count - active_count[i];
+			struct test_PhysicsPark park = { .a_parked = 0 };
+			SemaphoreInit(&park.release, 0);
+			ArenaPushRecord(env->mem_3);
+			struct task_stream *stream = task_stream_init(env->mem_3);
+			for (u32 k = 0; k < park_count; ++k)
+			{
+				task_stream_dispatch(env->mem_3, stream, test_PhysicsPark, &park);
+			}
+			while (AtomicLoadAcq32(&park.a_parked) != park_count)
+			{
+				AtomicSpinPause();
+			}
+
+			test_PhysicsSceneRun(hash, env->mem_1, &scene, builder);
+
+			for (u32 k = 0; k < park_count; ++k)
+			{
+				SemaphorePost(&park.release);
+			}
+			task_stream_spin_wait(stream);
+			task_stream_cleanup(stream);
+			ArenaPopRecord(env->mem_3);
+			SemaphoreDestroy(&park.release);
+
+			for (u32 f = 0; f < G_PHYSICS_FRAME_COUNT; ++f)
+			{
+				TEST_EQUAL(hash_expected[f], hash[f]);
+			}
+		}
+	}
+
+	test_PhysicsSceneFree(&scene);
+	return output;
+}
+
+#define G_PHYSICS_REMOVE_FRAME	30
+#define G_PHYSICS_CONFIG_FRAME	45
+#define G_PHYSICS_ADD_FRAME	60
+
+/*
+ * Record a run with body removals, additions and a config change in between ticks, replay the log on an
+ * empty pipeline and compare the state hash of every frame.
+ */
+static struct test_Output physics_input_log_replay(struct test_Environment *env)
+{
+	struct test_Output output = { .success = 1, .id = __func__ };
+
+	struct test_PhysicsScene scene;
+	test_PhysicsSceneAlloc(&scene, env->mem_1);
+	struct ds_PhysicsInputLog log = PhysicsInputLogAlloc(64);
+	u64 *hash_expected = ArenaPush(env->mem_2, G_PHYSICS_FRAME_COUNT*sizeof(u64));
+
+	struct ds_RigidBodyPipeline recorded = test_PhysicsPipelineAlloc(env->mem_1, &scene);
+	test_PhysicsSceneAdd(&recorded, &log, &scene);
+	for (u32 i = 0; i < G_PHYSICS_FRAME_COUNT; ++i)
+	{
+		if (recorded.frames_completed == G_PHYSICS_REMOVE_FRAME)
+		{
+			for (u32 k = 0; k < recorded.body_pool.count_max; ++k)
+			{
+				const struct ds_RigidBody *body = ds_PoolAddress(&recorded.body_pool, k);
+				if (PoolSlotAllocated(body) && body->entity % 5 == 1)
+				{
+					PhysicsInputBodyRemove(&log, env->mem_3, &recorded, ((u64) body->tag << 32) | k);
+				}
+			}
+		}
+
+		if (recorded.frames_completed == G_PHYSICS_CONFIG_FRAME)
+		{
+			struct solverConfig config = recorded.config;
+			config.pending_pgs_iteration_count = 4;
+			config.pending_substep_count = 2;
+			PhysicsInputConfig(&log, &recorded, &config);
+		}
+
+		if (recorded.frames_completed == G_PHYSICS_ADD_FRAME)
+		{
+			ds_Transform t = ds_TransformIdentity();
+			Vec3Set(t.position, 2.0f, 8.0f, 2.0f);
+			test_PhysicsBodyAdd(&recorded, &log, &scene.body_dynamic, &scene.shape_box, &t, 1000);
+		}
+
+		test_PhysicsTick(&recorded);
+		hash_expected[i] = recorded.state_hash;
+	}
+	test_PhysicsPipelineFree(&recorded);
+
+	struct ds_RigidBodyPipeline replayed = test_PhysicsPipelineAlloc(env->mem_1, &scene);
+	PhysicsInputLogSeek(&log, 0);
+	for (u32 i = 0; i < G_PHYSICS_FRAME_COUNT; ++i)
+	{
+		TEST_TRUE(PhysicsInputLogReplay(env->mem_3, &replayed, &log));
+		test_PhysicsTick(&replayed);
+		TEST_EQUAL(hash_expected[i], replayed.state_hash);
+	}
+	TEST_EQUAL(log.next, log.input.next);
+	test_PhysicsPipelineFree(&replayed);
+
+	PhysicsInputLogFree(&log);
+	test_PhysicsSceneFree(&scene);
+	return output;
+}
+
+#define G_PHYSICS_ROLLBACK_SLOTS	8
+#define G_PHYSICS_ROLLBACK_FRAMES	5
+
+/*
+ * Save every frame, restore a frame several saves back and compare its state hash, both restored and
+ * recomputed, against a run without rollback, then resimulate and compare the state hash of every frame.
+ */
+static struct test_Output physics_rollback(struct test_Environment *env, const u32 delta)
+{
+	struct test_Output output = { .success = 1, .id = __func__ };
+
+	struct test_PhysicsScene scene;
+	test_PhysicsSceneAlloc(&scene, env->mem_1);
+	u64 *hash_expected = ArenaPush(env->mem_2, G_PHYSICS_FRAME_COUNT*sizeof(u64));
+
+	struct ds_PhysicsRollback rollback = PhysicsRollbackAlloc(G_PHYSICS_ROLLBACK_SLOTS, 4*1024*1024, delta);
+	struct ds_RigidBodyPipeline pipeline = test_PhysicsPipelineAlloc(env->mem_1, &scene);
+	test_PhysicsSceneAdd(&pipeline, NULL, &scene);
+
+	for (u32 i = 0; i < G_PHYSICS_FRAME_COUNT; ++i)
+	{
+		test_PhysicsTick(&pipeline);
+		hash_expected[i] = pipeline.state_hash;
+	}
+	test_PhysicsPipelineFree(&pipeline);
+
+	/* restore at several points, so that contacts, islands and sleeping bodies all change in between */
+	const u64 restore_frame[] = { 20, 60, G_PHYSICS_FRAME_COUNT };
+	u32 r = 0;
+	pipeline = test_PhysicsPipelineAlloc(env->mem_1, &scene);
+	test_PhysicsSceneAdd(&pipeline, NULL, &scene);
+	PhysicsPipelineSave(&rollback, &pipeline);
+	while (pipeline.frames_completed < G_PHYSICS_FRAME_COUNT)
+	{
+		test_PhysicsTick(&pipeline);
+		TEST_EQUAL(hash_expected[pipeline.frames_completed-1], pipeline.state_hash);
+		PhysicsPipelineSave(&rollback, &pipeline);
+
+		if (r < sizeof(restore_frame) / sizeof(restore_frame[0]) && pipeline.frames_completed == restore_frame[r])
+		{
+			r += 1;
+			const u64 frame = pipeline.frames_completed - G_PHYSICS_ROLLBACK_FRAMES;
+			TEST_TRUE(PhysicsPipelineRestore(&pipeline, &rollback, frame));
+			TEST_EQUAL(frame, pipeline.frames_completed);
+			TEST_EQUAL(hash_expected[frame-1], pipeline.state_hash);
+			TEST_EQUAL(hash_expected[frame-1], PhysicsPipelineStateHash(&pipeline));
+		}
+	}
+	TEST_EQUAL(r, sizeof(restore_frame) / sizeof(restore_frame[0]));
+	test_PhysicsPipelineFree(&pipeline);
+
+	PhysicsRollbackFree(&rollback);
+	test_PhysicsSceneFree(&scene);
+	return output;
+}
+
+static struct test_Output physics_rollback_full(struct test_Environment *env)
+{
+	struct test_Output output = physics_rollback(env, 0);
+	output.id = __func__;
+	return output;
+}
+
+static struct test_Output physics_rollback_delta(struct test_Environment *env)
+{
+	struct test_Output output = physics_rollback(env, 1);
+	output.id = __func__;
+	return output;
+}
+
+#define G_PHYSICS_SLEEP_FRAMES	600
+
+/* return 1 if every proxy of the body bounds its shape */
+static u32 test_PhysicsProxyBoundsBody(const struct ds_RigidBodyPipeline *pipeline, const ds_RigidBodyId id)
+{
+	const struct ds_RigidBody *body = ds_RigidBodyLookup(pipeline, id).address;
+	const struct ds_Shape *shape = NULL;
+	for (u32 i = body->shape_list.first; i != DLL_NULL; i = shape->dll_next)
+	{
+		shape = ds_PoolAddress(&pipeline->shape_pool, i);
+		const struct bvhNode *node = ds_PoolAddress(&pipeline->shape_bvh.tree.pool, shape->proxy);
+		const struct aabb bbox = ds_ShapeWorldBbox(pipeline, shape);
+		if (!AabbContains(&node->bbox, &bbox))
+		{
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+/* tick until the body's island has fallen asleep; return 1 if it did */
+static u32 test_PhysicsTickUntilAsleep(struct ds_RigidBodyPipeline *pipeline, const ds_RigidBodyId id)
+{
+	for (u32 i = 0; i < G_PHYSICS_SLEEP_FRAMES; ++i)
+	{
+		test_PhysicsTick(pipeline);
+		const struct ds_RigidBody *body = ds_RigidBodyLookup(pipeline, id).address;
+		if (body->awake_index == U32_MAX)
+		{
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Teleport a sleeping dynamic body and a static body; both proxies must be refit, the sleeping body's by the 
+ * next broadphase and the static body's at once.
+ */
+static struct test_Output physics_set_transform_refit(struct test_Environment *env)
+{
+	struct test_Output output = { .success = 1, .id = __func__ };
+
+	struct test_PhysicsScene scene;
+	test_PhysicsSceneAlloc(&scene, env->mem_1);
+	struct ds_RigidBodyPipeline pipeline = test_PhysicsPipelineAlloc(env->mem_1, &scene);
+
+	ds_Transform t = ds_TransformIdentity();
+	Vec3Set(t.position, 0.0f, -0.5f, 0.0f);
+	const ds_RigidBodyId floor = test_PhysicsBodyAdd(&pipeline, NULL, &scene.body_static, &scene.shape_floor, &t, 0);
+	Vec3Set(t.position, 0.0f, 0.6f, 0.0f);
+	const ds_RigidBodyId box = test_PhysicsBodyAdd(&pipeline, NULL, &scene.body_dynamic, &scene.shape_box, &t, 1);
+	TEST_TRUE(test_PhysicsTickUntilAsleep(&pipeline, box));
+
+	Vec3Set(t.position, 10.0f, 3.0f, 10.0f);
+	ds_RigidBodySetTransform(&pipeline, box, &t);
+	test_PhysicsTick(&pipeline);
+	TEST_TRUE(test_PhysicsProxyBoundsBody(&pipeline, box));
+
+	Vec3Set(t.position, 0.0f, -0.75f, 0.0f);
+	ds_RigidBodySetTransform(&pipeline, floor, &t);
+	TEST_TRUE(test_PhysicsProxyBoundsBody(&pipeline, floor));
+
+	test_PhysicsPipelineFree(&pipeline);
+	test_PhysicsSceneFree(&scene);
+	return output;
+}
+
+/* return 1 if no contact is linked into more than one island slot */
+static u32 test_PhysicsIslandContactsUnique(struct arena *mem_tmp, const struct ds_RigidBodyPipeline *pipeline)
+{
+	ArenaPushRecord(mem_tmp);
+	u8 *linked = ArenaPushZero(mem_tmp, pipeline->cdb->contact_net.pool.count_max);
+	u32 unique = 1;
+
+	const struct ds_Island *is = NULL;
+	for (u32 i = pipeline->is_db.island_list.first; i != DLL_NULL && unique; i = dll_Next(is))
+	{
+		is = ds_PoolAddress(&pipeline->is_db.island_pool, i);
+		u32 k = is->contact_list.first;
+		for (u32 j = 0; j < is->contact_list.count; ++j)
+		{
+			if (k == DLL_NULL || linked[k])
+			{
+				unique = 0;
+				break;
+			}
+			linked[k] = 1;
+			const struct ds_Contact *c = nll_Address(&pipeline->cdb->contact_net, k);
+			k = c->dll_next;
+		}
+	}
+
+	ArenaPopRecord(mem_tmp);
+	return unique;
+}
+
+/*
+ * In one frame, a sleeping body is moved onto a static ledge, giving a new contact within its sleeping island,
+ * and a new body lands on it, waking the island. The new contact must be linked into the island exactly once,
+ * with either island builder.
+ */
+static struct test_Output physics_sleeping_island_new_contacts(struct test_Environment *env)
+{
+	struct test_Output output = { .success = 1, .id = __func__ };
+
+	struct test_PhysicsScene scene;
+	test_PhysicsSceneAlloc(&scene, env->mem_1);
+
+	for (u32 builder = 0; builder < ISLAND_BUILDER_COUNT; ++builder)
+	{
+		struct ds_RigidBodyPipeline pipeline = test_PhysicsPipelineAlloc(env->mem_1, &scene);
+		pipeline.config.pending_island_builder = builder;
+
+		/* body indices order the new contacts (box, ledge) before (box, top) */
+		ds_Transform t = ds_TransformIdentity();
+		Vec3Set(t.position, 0.0f, -0.5f, 0.0f);
+		test_PhysicsBodyAdd(&pipeline, NULL, &scene.body_static, &scene.shape_floor, &t, 0);
+		Vec3Set(t.position, 0.0f, 0.5f, 0.0f);
+		const ds_RigidBodyId box = test_PhysicsBodyAdd(&pipeline, NULL, &scene.body_dynamic, &scene.shape_box, &t, 1);
+		Vec3Set(t.position, 10.0f, 2.0f, 10.0f);
+		test_PhysicsBodyAdd(&pipeline, NULL, &scene.body_static, &scene.shape_box, &t, 2);
+		TEST_TRUE(test_PhysicsTickUntilAsleep(&pipeline, box));
+
+		Vec3Set(t.position, 10.0f, 3.0f, 10.0f);
+		ds_RigidBodySetTransform(&pipeline, box, &t);
+		Vec3Set(t.position, 10.0f, 4.0f, 10.0f);
+		test_PhysicsBodyAdd(&pipeline, NULL, &scene.body_dynamic, &scene.shape_box, &t, 3);
+
+		for (u32 i = 0; i < 10; ++i)
+		{
+			test_PhysicsTick(&pipeline);
+			TEST_TRUE(test_PhysicsIslandContactsUnique(env->mem_3, &pipeline));
+		}
+
+		test_PhysicsPipelineFree(&pipeline);
+	}
+
+	test_PhysicsSceneFree(&scene);
+	return output;
+}
+
+/* store, for every body slot, the lowest body index in its island, or U32_MAX if it is static or unallocated */
+static void test_PhysicsIslandLabels(u32 *label, const struct ds_RigidBodyPipeline *pipeline)
+{
+	for (u32 i = 0; i < pipeline->body_pool.count_max; ++i)
+	{
+		label[i] = U32_MAX;
+	}
+
+	const struct ds_Island *is = NULL;
+	for (u32 i = pipeline->is_db.island_list.first; i != DLL_NULL; i = dll_Next(is))
+	{
+		is = ds_PoolAddress(&pipeline->is_db.island_pool, i);
+		u32 min = U32_MAX;
+		const struct ds_RigidBody *b = NULL;
+		for (u32 j = is->body_list.first; j != DLL_NULL; j = dll2_Next(b))
+		{
+			b = ds_PoolAddress(&pipeline->body_pool, j);
+			min = (j < min) ? j : min;
+		}
+
+		for (u32 j = is->body_list.first; j != DLL_NULL; j = dll2_Next(b))
+		{
+			b = ds_PoolAddress(&pipeline->body_pool, j);
+			label[j] = min;
+		}
+	}
+}
+
+/* aligned stacks of boxes that land on each other and do not topple */
+static void test_PhysicsStacksAdd(struct ds_RigidBodyPipeline *pipeline, const struct test_PhysicsScene *scene)
+{
+	ds_Transform t = ds_TransformIdentity();
+	Vec3Set(t.position, 0.0f, -0.5f, 0.0f);
+	test_PhysicsBodyAdd(pipeline, NULL, &scene->body_static, &scene->shape_floor, &t, 0);
+
+	u32 entity = 1;
+	for (u32 x = 0; x < G_PHYSICS_GRID; ++x)
+	for (u32 z = 0; z < G_PHYSICS_GRID; ++z)
+	for (u32 y = 0; y < G_PHYSICS_HEIGHT; ++y)
+	{
+		Vec3Set(t.position, 1.5f*x, 0.5f + 1.2f*y, 1.5f*z);
+		test_PhysicsBodyAdd(pipeline, NULL, &scene->body_dynamic, &scene->shape_box, &t, entity++);
+	}
+}
+
+/*
+ * Run aligned stacks with the incremental and the union-find island builder side by side. The stacks merge
+ * into islands as the boxes land, and split when the middle box of every other stack is removed. Solve order 
+ * within islands differs between the builders, so the state hashes differ, but every frame both must 
+ * partition the bodies into the same islands with the same sleep state, and the stacks must come to rest at 
+ * the same place.
+ */
+static struct test_Output physics_island_builder_equivalence(struct test_Environment *env)
+{
+	struct test_Output output = { .success = 1, .id = __func__ };
+
+	struct test_PhysicsScene scene;
+	test_PhysicsSceneAlloc(&scene, env->mem_1);
+
+	struct ds_RigidBodyPipeline pipeline[ISLAND_BUILDER_COUNT];
+	for (u32 builder = 0; builder < ISLAND_BUILDER_COUNT; ++builder)
+	{
+		pipeline[builder] = test_PhysicsPipelineAlloc(env->mem_1, &scene);
+		pipeline[builder].config.pending_island_builder = builder;
+		test_PhysicsStacksAdd(pipeline + builder, &scene);
+	}
+
+	const u32 body_count = pipeline[0].body_pool.count_max;
+	u32 *label_expected = ArenaPush(env->mem_2, body_count*sizeof(u32));
+	u32 *label = ArenaPush(env->mem_2, body_count*sizeof(u32));
+	for (u32 i = 0; i < G_PHYSICS_SLEEP_FRAMES; ++i)
+	{
+		if (i == G_PHYSICS_REMOVE_FRAME)
+		{
+			for (u32 builder = 0; builder < ISLAND_BUILDER_COUNT; ++builder)
+			{
+				for (u32 k = 0; k < pipeline[builder].body_pool.count_max; ++k)
+				{
+					/* entity 0 is the floor, stack s holds entities [1 + s*height, 1 + (s+1)*height) */
+					const struct ds_RigidBody *body = ds_PoolAddress(&pipeline[builder].body_pool, k);
+					if (PoolSlotAllocated(body) && body->entity 
+							&& ((body->entity - 1) / G_PHYSICS_HEIGHT) % 2 == 1
+							&& (body->entity - 1) % G_PHYSICS_HEIGHT == 1)
+					{
+						ds_RigidBodyRemove(env->mem_3, pipeline + builder, ((u64) body->tag << 32) | k);
+					}
+				}
+			}
+		}
+
+		for (u32 builder = 0; builder < ISLAND_BUILDER_COUNT; ++builder)
+		{
+			test_PhysicsTick(pipeline + builder);
+		}
+
+		test_PhysicsIslandLabels(label_expected, pipeline + ISLAND_BUILDER_INCREMENTAL);
+		test_PhysicsIslandLabels(label, pipeline + ISLAND_BUILDER_UNION_FIND);
+		for (u32 k = 0; k < body_count; ++k)
+		{
+			const struct ds_RigidBody *b0 = ds_PoolAddress(&pipeline[ISLAND_BUILDER_INCREMENTAL].body_pool, k);
+			const struct ds_RigidBody *b1 = ds_PoolAddress(&pipeline[ISLAND_BUILDER_UNION_FIND].body_pool, k);
+			TEST_EQUAL(label_expected[k], label[k]);
+			TEST_EQUAL(b0->awake_index == U32_MAX, b1->awake_index == U32_MAX);
+		}
+	}
+
+	for (u32 k = 0; k < body_count; ++k)
+	{
+		const struct ds_RigidBody *b0 = ds_PoolAddress(&pipeline[ISLAND_BUILDER_INCREMENTAL].body_pool, k);
+		const struct ds_RigidBody *b1 = ds_PoolAddress(&pipeline[ISLAND_BUILDER_UNION_FIND].body_pool, k);
+		if (PoolSlotAllocated(b0) && b0->island_index != ISLAND_STATIC)
+		{
+			TEST_TRUE(b0->awake_index == U32_MAX);
+			TEST_TRUE(Vec3Distance(b0->t_world.position, b1->t_world.position) < 1e-3f);
+		}
+	}
+
+	for (u32 builder = 0; builder < ISLAND_BUILDER_COUNT; ++builder)
+	{
+		test_PhysicsPipelineFree(pipeline + builder);
+	}
+	test_PhysicsSceneFree(&scene);
+	return output;
+}
+
+/* return 1 if the contacts of every island connect all of its bodies */
+static u32 test_PhysicsIslandsConnected(struct arena *mem_tmp, const struct ds_RigidBodyPipeline *pipeline)
+{
+	ArenaPushRecord(mem_tmp);
+	u32 *parent = ArenaPush(mem_tmp, pipeline->body_pool.count_max*sizeof(u32));
+	u32 connected = 1;
+
+	const struct ds_Island *is = NULL;
+	for (u32 i = pipeline->is_db.island_list.first; i != DLL_NULL && connected; i = dll_Next(is))
+	{
+		is = ds_PoolAddress(&pipeline->is_db.island_pool, i);
+		const struct ds_RigidBody *b = NULL;
+		for (u32 j = is->body_list.first; j != DLL_NULL; j = dll2_Next(b))
+		{
+			b = ds_PoolAddress(&pipeline->body_pool, j);
+			parent[j] = j;
+		}
+
+		const struct ds_Contact *c = NULL;
+		for (u32 j = is->contact_list.first; j != DLL_NULL; j = dll_Next(c))
+		{
+			c = nll_Address(&pipeline->cdb->contact_net, j);
+			const struct ds_RigidBody *b0 = ds_PoolAddress(&pipeline->body_pool, c->key.body0);
+			const struct ds_RigidBody *b1 = ds_PoolAddress(&pipeline->body_pool, c->key.body1);
+			if (b0->island_index == ISLAND_STATIC || b1->island_index == ISLAND_STATIC)
+			{
+				continue;
+			}
+
+			u32 r0 = c->key.body0;
+			u32 r1 = c->key.body1;
+			while (parent[r0] != r0) { r0 = parent[r0]; }
+			while (parent[r1] != r1) { r1 = parent[r1]; }
+			parent[r1] = r0;
+		}
+
+		u32 root = U32_MAX;
+		for (u32 j = is->body_list.first; j != DLL_NULL; j = dll2_Next(b))
+		{
+			b = ds_PoolAddress(&pipeline->body_pool, j);
+			u32 r = j;
+			while (parent[r] != r) { r = parent[r]; }
+			root = (root == U32_MAX) ? r : root;
+			connected = connected && (r == root);
+		}
+	}
+
+	ArenaPopRecord(mem_tmp);
+	return connected;
+}
+
+/*
+ * Run the toppling scene with deferred splitting and a split budget of zero and of a single body per frame, 
+ * so that pending splits are deferred; with no budget, until the island tries to sleep. Deferred islands must 
+ * still split: the scene must come to rest with every dynamic body asleep, no split pending, and every island 
+ * connected.
+ */
+static struct test_Output physics_split_deferred(struct test_Environment *env)
+{
+	struct test_Output output = { .success = 1, .id = __func__ };
+
+	struct test_PhysicsScene scene;
+	test_PhysicsSceneAlloc(&scene, env->mem_1);
+
+	for (u32 budget = 0; budget <= 1; ++budget)
+	{
+		struct ds_RigidBodyPipeline pipeline = test_PhysicsPipelineAlloc(env->mem_1, &scene);
+		pipeline.config.pending_split_deferred = 1;
+		pipeline.config.pending_split_body_budget = budget;
+		test_PhysicsSceneAdd(&pipeline, NULL, &scene);
+
+		u32 deferred = 0;
+		u32 asleep = 0;
+		for (u32 i = 0; i < G_PHYSICS_SLEEP_FRAMES && !asleep; ++i)
+		{
+			test_PhysicsTick(&pipeline);
+			deferred = deferred || pipeline.is_db.possible_splits.next;
+			asleep = (pipeline.body_awake_list.next == 0);
+		}
+
+		TEST_TRUE(deferred);
+		TEST_TRUE(asleep);
+		TEST_EQUAL(pipeline.is_db.possible_splits.next, 0);
+		TEST_TRUE(test_PhysicsIslandsConnected(env->mem_3, &pipeline));
+
+		test_PhysicsPipelineFree(&pipeline);
+	}
+
+	test_PhysicsSceneFree(&scene);
+	return output;
+}
+
+#define G_PHYSICS_STACK_HEIGHT	20
+
+/*
+ * Drop a single stack of boxes, each slightly rotated and offset, with one and with four sub-steps, and measure 
+ * the height of the top box after the stack has had time to settle or topple. The sub-stepped solver must keep 
+ * the stack upright, and the top box must end up at least as high as with the single step solver.
+ */
+static struct test_Output physics_substep_stack(struct test_Environment *env)
+{
+	struct test_Output output = { .success = 1, .id = __func__ };
+
+	struct test_PhysicsScene scene;
+	test_PhysicsSceneAlloc(&scene, env->mem_1);
+
+	const u32 substep_count[] = { 1, 4 };
+	f32 height[2];
+	for (u32 i = 0; i < 2; ++i)
+	{
+		struct ds_RigidBodyPipeline pipeline = test_PhysicsPipelineAlloc(env->mem_1, &scene);
+		pipeline.config.pending_substep_count = substep_count[i];
+
+		ds_Transform t = ds_TransformIdentity();
+		Vec3Set(t.position, 0.0f, -0.5f, 0.0f);
+		test_PhysicsBodyAdd(&pipeline, NULL, &scene.body_static, &scene.shape_floor, &t, 0);
+		ds_RigidBodyId top = 0;
+		for (u32 y = 0; y < G_PHYSICS_STACK_HEIGHT; ++y)
+		{
+			const f32 angle = 0.02f*(f32) (y % 3);
+			QuatSet(t.rotation, 0.0f, f32_sin(angle), 0.0f, f32_cos(angle));
+			Vec3Set(t.position, 0.02f*(f32) (y % 2), 0.5f + 1.01f*y, 0.0f);
+			top = test_PhysicsBodyAdd(&pipeline, NULL, &scene.body_dynamic, &scene.shape_box, &t, y + 1);
+		}
+
+		for (u32 f = 0; f < G_PHYSICS_SLEEP_FRAMES; ++f)
+		{
+			test_PhysicsTick(&pipeline);
+		}
+
+		const struct ds_RigidBody *body = ds_RigidBodyLookup(&pipeline, top).address;
+		height[i] = body->t_world.position[1];
+
+		test_PhysicsPipelineFree(&pipeline);
+	}
+
+	TEST_TRUE(height[1] > (f32) G_PHYSICS_STACK_HEIGHT - 1.0f);
+	TEST_TRUE(height[1] >= height[0]);
+
+	test_PhysicsSceneFree(&scene);
+	return output;
+}
+
+static struct test_Output(*physics_tests[])(struct test_Environment *) =
+{
+	physics_worker_count_determinism,
+	physics_input_log_replay,
+	physics_rollback_full,
+	physics_rollback_delta,
+	physics_set_transform_refit,
+	physics_sleeping_island_new_contacts,
+	physics_island_builder_equivalence,
+	physics_split_deferred,
+	physics_substep_stack,
+};
+
+struct suite_Correctness m_physics_suite =
+{
+	.id = "Physics",
+	.unit_test = physics_tests,
+	.unit_test_count = sizeof(physics_tests) / sizeof(physics_tests[0]),
+};
+
+struct suite_Correctness *physics_correctness_suite = &m_physics_suite;
+
+/*
+ * The island builder tests tick the toppling scene from the start, where boxes continuously land on, slide off
+ * and fall between the stacks, so islands merge and split every frame. Both tests are identical except for
+ * the island builder of the pipeline.
+ */
+struct physics_BuilderInput
+{
+	struct arena			mem_scene;
+	struct arena			mem_pipeline;
+	struct test_PhysicsScene	scene;
+	struct ds_RigidBodyPipeline	pipeline;
+	u32				builder;
+	u32				allocated;
+};
+
+static void *physics_BuilderInit(const u32 builder)
+{
+	struct physics_BuilderInput *input = malloc(sizeof(struct physics_BuilderInput));
+	input->mem_scene = ArenaAlloc(1024*1024);
+	input->mem_pipeline = ArenaAlloc(1024*1024);
+	input->builder = builder;
+	input->allocated = 0;
+	test_PhysicsSceneAlloc(&input->scene, &input->mem_scene);
+	return input;
+}
+
+void *physics_BuilderIncrementalInit(void)
+{
+	return physics_BuilderInit(ISLAND_BUILDER_INCREMENTAL);
+}
+
+void *physics_BuilderUnionFindInit(void)
+{
+	return physics_BuilderInit(ISLAND_BUILDER_UNION_FIND);
+}
+
+void physics_BuilderReset(void *args)
+{
+	struct physics_BuilderInput *input = args;
+	if (input->allocated)
+	{
+		test_PhysicsPipelineFree(&input->pipeline);
+		ArenaFlush(&input->mem_pipeline);
+	}
+
+	input->pipeline = test_PhysicsPipelineAlloc(&input->mem_pipeline, &input->scene);
+	input->pipeline.config.pending_island_builder = input->builder;
+	test_PhysicsSceneAdd(&input->pipeline, NULL, &input->scene);
+	input->allocated = 1;
+}
+
+void physics_BuilderFree(void *args)
+{
+	struct physics_BuilderInput *input = args;
+	if (input->allocated)
+	{
+		test_PhysicsPipelineFree(&input->pipeline);
+	}
+	test_PhysicsSceneFree(&input->scene);
+	ArenaFree(&input->mem_pipeline);
+	ArenaFree(&input->mem_scene);
+	free(input);
+}
+
+void physics_BuilderTest(void *args)
+{
+	struct physics_BuilderInput *input = args;
+	for (u32 i = 0; i < G_PHYSICS_FRAME_COUNT; ++i)
+	{
+		test_PhysicsTick(&input->pipeline);
+	}
+}
+
+struct test_PerformanceSerial physics_serial_test[] =
+{
+	{
+		.id = "island_builder_incremental_churn",
+		.size = G_PHYSICS_FRAME_COUNT * G_PHYSICS_GRID * G_PHYSICS_GRID * G_PHYSICS_HEIGHT * sizeof(struct ds_RigidBody),
+		.test = &physics_BuilderTest,
+		.test_init = &physics_BuilderIncrementalInit,
+		.test_reset = &physics_BuilderReset,
+		.test_free = &physics_BuilderFree,
+	},
+
+	{
+		.id = "island_builder_union_find_churn",
+		.size = G_PHYSICS_FRAME_COUNT * G_PHYSICS_GRID * G_PHYSICS_GRID * G_PHYSICS_HEIGHT * sizeof(struct ds_RigidBody),
+		.test = &physics_BuilderTest,
+		.test_init = &physics_BuilderUnionFindInit,
+		.test_reset = &physics_BuilderReset,
+		.test_free = &physics_BuilderFree,
+	},
+};
+
+struct suite_Performance storage_physics_performance_suite =
+{
+	.id = "Physics Performance",
+	.serial_test = physics_serial_test,
+	.serial_test_count = sizeof(physics_serial_test) / sizeof(physics_serial_test[0]),
+	.parallel_test = NULL,
+	.parallel_test_count = 0,
+};
+
+struct suite_Performance *physics_performance_suite = &storage_physics_performance_suite;
@@ -545,6 +545,55 @@ static void ss_write_read_u32_partial(void *args)
 	}
 }
 
+#define G_PHYSICS_SERIALIZE_FRAME	60
+#define G_PHYSICS_SERIALIZE_TAIL	60
+
+static struct test_Output physics_pipeline_round_trip(struct test_Environment *env)
+{
+	struct test_Output output = { .success = 1, .id = __func__ };
+
+	struct test_PhysicsScene scene;
+	test_PhysicsSceneAlloc(&scene, env->mem_1);
+
+	/* serialize mid-scene, so that contacts, islands and sleep timers are all in flight */
+	struct ds_RigidBodyPipeline pipeline = test_PhysicsPipelineAlloc(env->mem_1, &scene);
+	test_PhysicsSceneAdd(&pipeline, NULL, &scene);
+	for (u32 i = 0; i < G_PHYSICS_SERIALIZE_FRAME; ++i)
+	{
+		test_PhysicsTick(&pipeline);
+	}
+
+	const u64 size = PhysicsPipelineSerializeSize(&pipeline);
+	struct ss ss_out = ss_Alloc(env->mem_1, size);
+	TEST_TRUE(ss_out.buf != NULL);
+	TEST_TRUE(PhysicsPipelineSerialize(&ss_out, &pipeline));
+
+	struct ds_RigidBodyPipeline copy = test_PhysicsPipelineAlloc(env->mem_1, &scene);
+	struct ss ss_in = ss_Buffered(ss_out.buf, size);
+	TEST_TRUE(PhysicsPipelineDeserialize(&copy, &ss_in));
+	TEST_EQUAL(pipeline.frames_completed, copy.frames_completed);
+	TEST_EQUAL(pipeline.state_hash, copy.state_hash);
+	TEST_EQUAL(PhysicsPipelineStateHash(&pipeline), PhysicsPipelineStateHash(&copy));
+
+	/* the loaded pipeline must also simulate on identically */
+	for (u32 i = 0; i < G_PHYSICS_SERIALIZE_TAIL; ++i)
+	{
+		test_PhysicsTick(&pipeline);
+		test_PhysicsTick(&copy);
+		TEST_EQUAL(pipeline.state_hash, copy.state_hash);
+	}
+
+	test_PhysicsPipelineFree(&copy);
+	test_PhysicsPipelineFree(&pipeline);
+	test_PhysicsSceneFree(&scene);
+	return output;
+}
+
+static struct test_Output(*serialize_tests[])(struct test_Environment *) =
+{
+	physics_pipeline_round_trip,
+};
+
 struct test_CorrectnessRepetition repetition_test[] =
 {
 	{ .test =  &ss_randomized_aligned, .count = 100, },
@@ -557,6 +606,8 @@ struct test_CorrectnessRepetition repetition_test[] =
 struct suite_Correctness m_serialize_suite =
 {
 	.id = "Serialize",
+	.unit_test = serialize_tests,
+	.unit_test_count = sizeof(serialize_tests) / sizeof(serialize_tests[0]),
 	.repetition_test = repetition_test,
 	.repetition_test_count = sizeof(repetition_test) / sizeof(repetition_test[0]),
 };